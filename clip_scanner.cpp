@@ -0,0 +1,206 @@
+#include "clip_scanner.h"
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include "demuxer.h"
+#include "ffmpeg.h"
+#include "frame_sync.h"
+#include "side_aware_logger.h"
+#include "video_decoder.h"
+#include "video_filterer.h"
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+}
+
+using ScannedFramePtr = std::unique_ptr<AVFrame, std::function<void(AVFrame*)>>;
+
+static auto avframe_deleter = [](AVFrame* frame) { av_frame_free(&frame); };
+
+static ScannedFramePtr alloc_frame() {
+  ScannedFramePtr frame{av_frame_alloc(), avframe_deleter};
+
+  if (frame == nullptr) {
+    throw std::runtime_error("Allocating frame for scanning");
+  }
+
+  return frame;
+}
+
+static AVDictionary* copy_dictionary(const AVDictionary* dictionary) {
+  AVDictionary* copy = nullptr;
+  av_dict_copy(&copy, dictionary, 0);
+
+  return copy;
+}
+
+ScanInput::ScanInput(const InputVideo& video) : video_(video) {
+  video_.demuxer_options = copy_dictionary(video.demuxer_options);
+  video_.decoder_options = copy_dictionary(video.decoder_options);
+  video_.hw_accel_options = copy_dictionary(video.hw_accel_options);
+}
+
+ScanInput::~ScanInput() {
+  av_dict_free(&video_.demuxer_options);
+  av_dict_free(&video_.decoder_options);
+  av_dict_free(&video_.hw_accel_options);
+}
+
+// Single-threaded demux -> decode -> filter chain which produces filtered frames on demand
+class ClipScanner::Source {
+ public:
+  Source(const ScanInput& input, const VideoFilterContext* video_filter_context, const bool disable_auto_filters) {
+    const InputVideo& video = input.video();
+    ScopedLogSide scoped_log_side(video.side);
+
+    // the constructors below consume the option dictionaries handed to them
+    demuxer_ = std::make_unique<Demuxer>(video.side, video.demuxer, video.file_name, copy_dictionary(video.demuxer_options), video.decoder_options);
+
+    AVDictionary* hw_accel_options = copy_dictionary(video.hw_accel_options);
+    video_decoder_ = std::make_unique<VideoDecoder>(video.side, video.decoder, video.hw_accel_spec, demuxer_->video_codec_parameters(), video.peak_luminance_nits, hw_accel_options, copy_dictionary(video.decoder_options));
+    av_dict_free(&hw_accel_options);
+
+    video_filterer_ = std::make_unique<VideoFilterer>(video.side, demuxer_.get(), video_decoder_.get(), video.tone_mapping_mode, video.boost_tone, video.video_filters, video.color_space, video.color_range, video.color_primaries,
+                                                      video.color_trc, video_filter_context, disable_auto_filters);
+
+    packet_ = av_packet_alloc();
+
+    if (packet_ == nullptr) {
+      throw std::runtime_error("Allocating packet for scanning");
+    }
+  }
+
+  ~Source() { av_packet_free(&packet_); }
+
+  // Returns false once the input is exhausted
+  bool read(ScannedFramePtr& frame) {
+    while (filtered_frames_.empty() && !end_of_input_) {
+      if (!(*demuxer_)(*packet_)) {
+        // flush the decoder, then the filter graph
+        decode(nullptr);
+
+        video_filterer_->close_src();
+        receive_filtered_frames();
+
+        end_of_input_ = true;
+      } else {
+        if (packet_->stream_index == demuxer_->video_stream_index()) {
+          decode(packet_);
+        }
+
+        av_packet_unref(packet_);
+      }
+    }
+
+    if (filtered_frames_.empty()) {
+      return false;
+    }
+
+    frame = std::move(filtered_frames_.front());
+    filtered_frames_.pop_front();
+
+    return true;
+  }
+
+ private:
+  void decode(AVPacket* packet) {
+    bool sent;
+
+    // if the packet was not accepted, receive more frames and try again
+    do {
+      sent = video_decoder_->send(packet);
+
+      for (ScannedFramePtr frame_decoded = alloc_frame(); video_decoder_->receive(frame_decoded.get(), demuxer_.get()); frame_decoded = alloc_frame()) {
+        if (frame_decoded->format == video_decoder_->hw_pixel_format()) {
+          ScannedFramePtr sw_frame_decoded = alloc_frame();
+
+          // Transfer data from GPU to CPU
+          if (av_hwframe_transfer_data(sw_frame_decoded.get(), frame_decoded.get(), 0) < 0) {
+            throw std::runtime_error("Error transferring frame from GPU to CPU");
+          }
+          if (av_frame_copy_props(sw_frame_decoded.get(), frame_decoded.get()) < 0) {
+            throw std::runtime_error("Copying SW frame properties");
+          }
+
+          frame_decoded = std::move(sw_frame_decoded);
+        }
+
+        if (!video_filterer_->send(frame_decoded.get())) {
+          throw std::runtime_error("Error while feeding the filter graph");
+        }
+
+        receive_filtered_frames();
+      }
+    } while (!sent && packet != nullptr);
+  }
+
+  void receive_filtered_frames() {
+    for (ScannedFramePtr frame_filtered = alloc_frame(); video_filterer_->receive(frame_filtered.get()); frame_filtered = alloc_frame()) {
+      filtered_frames_.push_back(std::move(frame_filtered));
+    }
+  }
+
+ private:
+  std::unique_ptr<Demuxer> demuxer_;
+  std::unique_ptr<VideoDecoder> video_decoder_;
+  std::unique_ptr<VideoFilterer> video_filterer_;
+
+  AVPacket* packet_{nullptr};
+
+  std::deque<ScannedFramePtr> filtered_frames_;
+  bool end_of_input_{false};
+};
+
+ClipScanner::ClipScanner(const ScanInput& left_input,
+                         const ScanInput& right_input,
+                         const VideoFilterContext* video_filter_context,
+                         const bool disable_auto_filters,
+                         const AVRational& time_shift_multiplier,
+                         const int64_t right_time_shift)
+    : left_source_(std::make_unique<Source>(left_input, video_filter_context, disable_auto_filters)),
+      right_source_(std::make_unique<Source>(right_input, video_filter_context, disable_auto_filters)),
+      time_shift_multiplier_(time_shift_multiplier),
+      right_time_shift_(right_time_shift) {}
+
+ClipScanner::~ClipScanner() = default;
+
+bool ClipScanner::run(const PairCallback& on_pair, const std::atomic_bool& cancel) {
+  ScannedFramePtr left_frame{nullptr, avframe_deleter};
+  ScannedFramePtr right_frame{nullptr, avframe_deleter};
+
+  bool has_left = left_source_->read(left_frame);
+  bool has_right = right_source_->read(right_frame);
+
+  while (has_left && has_right) {
+    if (cancel.load(std::memory_order_relaxed)) {
+      return false;
+    }
+
+    // same tolerance and time shift handling as the main loop, which treats the left side as the master
+    const int64_t effective_right_time_shift = right_time_shift_ + calculate_dynamic_time_shift(time_shift_multiplier_, right_frame->pts, true);
+    const int64_t right_pts = right_frame->pts - effective_right_time_shift;
+    const int64_t min_delta = compute_min_delta(ffmpeg::frame_duration(left_frame.get()), ffmpeg::frame_duration(right_frame.get()));
+
+    if (is_behind(left_frame->pts, right_pts, min_delta)) {
+      has_left = left_source_->read(left_frame);
+    } else if (is_behind(right_pts, left_frame->pts, min_delta)) {
+      has_right = right_source_->read(right_frame);
+    } else {
+      if (!on_pair(left_frame.get(), right_frame.get())) {
+        return false;
+      }
+
+      has_left = left_source_->read(left_frame);
+      has_right = right_source_->read(right_frame);
+    }
+  }
+
+  return true;
+}
+
+int get_clip_scan_thread_count() {
+  const unsigned int hardware_concurrency = std::thread::hardware_concurrency();
+
+  return std::max(1, static_cast<int>(hardware_concurrency / 4));
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "config.h"
+#include "core_types.h"
+#include "video_filter_context.h"
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+
+// A private copy of an input's settings. The option dictionaries of VideoCompareConfig are
+// consumed when the main pipeline opens its inputs, so this has to be taken beforehand.
+class ScanInput {
+ public:
+  explicit ScanInput(const InputVideo& video);
+  ~ScanInput();
+
+  ScanInput(const ScanInput&) = delete;
+  ScanInput& operator=(const ScanInput&) = delete;
+
+  const InputVideo& video() const { return video_; }
+
+ private:
+  InputVideo video_;
+};
+
+// Decodes and filters a left/right pair of inputs from the start on its own demuxers, decoders
+// and filterers, pairing frames by PTS the same way the main loop does. Meant for whole-clip
+// analyses which run on a background thread without disturbing playback.
+class ClipScanner {
+ public:
+  // Called for each aligned pair of filtered (pre-conversion) frames in presentation order, with
+  // PTS in microseconds from the start of each input. Frames are only valid during the call.
+  // Return false to stop the scan.
+  using PairCallback = std::function<bool(const AVFrame* left_frame, const AVFrame* right_frame)>;
+
+  ClipScanner(const ScanInput& left_input,
+              const ScanInput& right_input,
+              const VideoFilterContext* video_filter_context,
+              const bool disable_auto_filters,
+              const AVRational& time_shift_multiplier,
+              const int64_t right_time_shift);
+  ~ClipScanner();
+
+  // Returns true if the end of either input was reached, false if stopped early
+  bool run(const PairCallback& on_pair, const std::atomic_bool& cancel);
+
+ private:
+  class Source;
+
+  std::unique_ptr<Source> left_source_;
+  std::unique_ptr<Source> right_source_;
+
+  const AVRational time_shift_multiplier_;
+  const int64_t right_time_shift_;
+};
+
+// Creates a scanner for the left input and the given right input
+using ClipScannerFactory = std::function<std::unique_ptr<ClipScanner>(const Side& right_side, const int64_t right_time_shift)>;
+
+// Threads for the per-frame analysis of a scan, leaving most cores to playback
+int get_clip_scan_thread_count();
@@ -17,12 +17,15 @@ struct ScopesConfig {
   bool histogram{false};
   bool vectorscope{false};
   bool waveform{false};
+  bool difference{false};
   std::string histogram_options;
   std::string vectorscope_options;
   std::string waveform_options;
+  bool difference_per_channel{false};  // else the largest channel difference of each pixel
   int width{1024};  // total scope window width (two panes side-by-side)
   int height{256};  // scope window height
   bool always_on_top{true};
+  int max_samples{2000000};  // per side and frame, above which the ROI is subsampled; 0 for every pixel
 };
 
 struct InputVideo {
@@ -57,6 +60,7 @@ struct VideoCompareConfig {
   float ui_scale{1.0F};
   bool use_10_bpc{false};
   bool fast_input_alignment{false};
+  bool adaptive_preview{false};
   bool bilinear_texture_filtering{false};
   bool disable_auto_filters{false};
   bool start_in_subtraction_mode{false};
@@ -68,6 +72,7 @@ struct VideoCompareConfig {
   std::tuple<int, int> window_size{-1, -1};
 
   Display::Mode display_mode{Display::Mode::Split};
+  std::vector<size_t> mosaic_right_indices;  // zero-based, all right videos if empty
   Display::Loop auto_loop_mode{Display::Loop::Off};
 
   size_t frame_buffer_size{50};
@@ -76,6 +81,8 @@ struct VideoCompareConfig {
 
   float wheel_sensitivity{1};
 
+  int png_compression_level{3};
+
   InputVideo left{LEFT, "Left"};
   std::vector<InputVideo> right_videos;
 
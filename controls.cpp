@@ -44,10 +44,14 @@ static const std::vector<ControlSection> control_sections{
       {"T", "Toggle nearest-neighbor/bilinear video texture filtering"},
       {"Y", "Cycle through subtraction modes"},
       {"U", "Toggle luminance-only subtraction mode"},
-      {"X", "Show the current video frame and UI update rates (FPS)"},
+      {"X", "Show the current video frame and UI update rates (FPS) and playback pacing"},
       {"F1", "Toggle Histogram window"},
       {"F2", "Toggle Vectorscope window"},
       {"F3", "Toggle Waveform window"},
+      {"F4", "Toggle metrics timeline window (click to seek)"},
+      {"F5", "Toggle Difference distribution window"},
+      {"]", "Jump to the next worst frame (lowest PSNR, from the metrics timeline's background scan)"},
+      {"[", "Jump to the previous worst frame"},
       {"Alt+Enter", "Toggle fullscreen"},
       {"Backspace", "Clear crop(s)"},
       {"Shift+L", "Crop left video interactively"},
@@ -62,6 +66,8 @@ static const std::vector<ControlSection> control_sections{
       {"Shift+W", "Restore saved window size"},
       {"Ctrl+W", "Restore startup window size"},
       {"Ctrl+Shift+W", "Save current window size"},
+      {"Ctrl+M", "Print VMAF for the frames in the buffer to console"},
+      {"Alt+M", "Cycle live metrics on the HUD (off, PSNR/SSIM, PSNR/SSIM/VMAF)"},
       {"Ctrl+Shift+1..0", "Switch directly to right video 1-10"},
       {"Ctrl+C / Cmd+C", "Copy the current timestamp of the left video to the clipboard"},
       {"Ctrl+V / Cmd+V", "Paste a timestamp from the clipboard and seek to that position"},
@@ -5,6 +5,7 @@
 #include <functional>
 #include <string>
 extern "C" {
+#include <libavutil/buffer.h>
 #include <libavutil/dict.h>
 #include <libavutil/frame.h>
 }
@@ -82,3 +83,41 @@ inline std::string get_frame_key(const AVFrame* frame) {
 inline void set_frame_key(AVFrame* frame, const std::string& frame_key) {
   av_dict_set(&frame->metadata, "frame_key", frame_key.c_str(), 0);
 }
+
+// The filtered (pre-conversion) frame travels with the display frame via opaque_ref, so that
+// consumers such as the quality metrics can work on the native planes without keeping a
+// second frame queue in sync. Buffers are shared with the filtered frame, not copied.
+inline bool attach_source_frame(AVFrame* frame, const AVFrame* source) {
+  AVFrame* source_ref = av_frame_clone(source);
+
+  if (source_ref == nullptr) {
+    return false;
+  }
+
+  AVBufferRef* buffer_ref = av_buffer_create(
+      reinterpret_cast<uint8_t*>(source_ref), sizeof(AVFrame),
+      [](void*, uint8_t* data) {
+        AVFrame* frame_to_free = reinterpret_cast<AVFrame*>(data);
+        av_frame_free(&frame_to_free);
+      },
+      nullptr, AV_BUFFER_FLAG_READONLY);
+
+  if (buffer_ref == nullptr) {
+    av_frame_free(&source_ref);
+    return false;
+  }
+
+  av_buffer_unref(&frame->opaque_ref);
+  frame->opaque_ref = buffer_ref;
+
+  return true;
+}
+
+// Drops the reference taken by attach_source_frame, leaving consumers to the display frame
+inline void release_source_frame(AVFrame* frame) {
+  av_buffer_unref(&frame->opaque_ref);
+}
+
+inline const AVFrame* get_source_frame(const AVFrame* frame) {
+  return frame->opaque_ref != nullptr ? reinterpret_cast<const AVFrame*>(frame->opaque_ref->data) : nullptr;
+}
@@ -15,7 +15,8 @@
 #include "controls.h"
 #include "ffmpeg.h"
 #include "format_converter.h"
-#include "png_saver.h"
+#include "histogram_utils.h"
+#include "quality_metrics.h"
 #include "scope_window.h"
 #include "source_code_pro_regular_ttf.h"
 #include "version.h"
@@ -40,6 +41,7 @@ static const SDL_Color TARGET_COLOR = {200, 200, 140, 0};
 static const SDL_Color ZOOM_COLOR = {255, 165, 0, 0};
 static const SDL_Color PLAYBACK_SPEED_COLOR = {0, 192, 160, 0};
 static const SDL_Color BUFFER_COLOR = {160, 225, 192, 0};
+static const SDL_Color LIVE_METRICS_COLOR = {200, 180, 255, 0};
 static const int BACKGROUND_ALPHA = 100;
 
 static const int MOUSE_WHEEL_SCROLL_STEPS_TO_DOUBLE = 12;
@@ -52,9 +54,21 @@ static const float PLAYBACK_SPEED_SLOWDOWN_RATIO = 5.0F;
 
 static const float RELATIVE_SEEK_SLOWDOWN_RATIO = 4.0F;
 
+static const size_t LIVE_METRICS_HISTORY_SIZE = 120;
+
+// relative deviation of the previous frame's difference scale that is reused without remapping
+static const float DIFFERENCE_SCALE_TOLERANCE = 0.02F;
+
+// coarsest reduction of the adaptive playback preview
+static const int MAX_PREVIEW_SCALE_DIVISOR = 8;
+
 static const int HELP_TEXT_LINE_SPACING = 1;
 static const int HELP_TEXT_HORIZONTAL_MARGIN = 26;
 
+// the images of a save are written in parallel, and a few saves may be pending at once
+static const size_t IMAGE_SAVE_THREAD_COUNT = 3;
+static const size_t MAX_PENDING_SAVED_IMAGES = 12;
+
 static const int MIN_WINDOW_WIDTH = 4;
 static const int MIN_WINDOW_HEIGHT = 1;
 
@@ -158,6 +172,22 @@ static std::string format_right_file_label(const std::string& left_file_name, co
   return right_file_name;
 }
 
+// of the RGB frames (and difference and mosaic buffers) shown in the video texture
+static int get_packed_rgb_bytes_per_pixel(const int format, const bool use_10_bpc) {
+  return ffmpeg::is_packed_10_bpc_rgb(format) ? 4 : (use_10_bpc ? 6 : 3);
+}
+
+// pixels between the mosaic tiles
+static constexpr int MOSAIC_TILE_GAP = 2;
+
+// the most square grid holding the given number of mosaic tiles, as columns and rows
+static std::pair<int, int> get_mosaic_grid(const size_t tile_count) {
+  const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(tile_count)))));
+  const int rows = std::max(1, static_cast<int>((tile_count + columns - 1) / columns));
+
+  return {columns, rows};
+}
+
 std::string format_window_title(const std::string& left_file_name, const std::string& right_file_name) {
   return string_sprintf("%s  |  %s", get_file_name_and_extension(left_file_name).c_str(), get_file_name_and_extension(right_file_name).c_str());
 }
@@ -409,22 +439,25 @@ Display::Display(const int display_number,
   if (start_in_fullscreen_) {
     set_fullscreen(true);
   }
+
+  difference_worker_ = std::thread([this]() { run_difference_worker(); });
 }
 
 Display::~Display() {
-  SDL_DestroyTexture(video_texture_linear_);
-  SDL_DestroyTexture(video_texture_nn_);
+  stop_difference_worker();
+
+  video_texture_linear_.reset();
+  video_texture_nn_.reset();
+  SDL_DestroyTexture(loupe_texture_);
   SDL_DestroyTexture(side_ui_[LEFT.as_simple_index()].text_texture);
   SDL_DestroyTexture(side_ui_[RIGHT.as_simple_index()].text_texture);
 
-  if (message_texture_ != nullptr) {
-    SDL_DestroyTexture(message_texture_);
-  }
-
   for (auto help_texture : help_textures_) {
     SDL_DestroyTexture(help_texture);
   }
 
+  small_glyph_atlas_.reset();
+  big_glyph_atlas_.reset();
   TTF_CloseFont(small_font_);
   TTF_CloseFont(big_font_);
 
@@ -432,34 +465,24 @@ Display::~Display() {
   SDL_FreeCursor(pan_mode_cursor_);
   SDL_FreeCursor(selection_mode_cursor_);
 
-  delete[] diff_buffer_;
-
-  if (left_buffer_ != nullptr) {
-    delete[] left_buffer_;
-  }
-  if (right_buffer_ != nullptr) {
-    delete[] right_buffer_;
-  }
+  delete[] left_buffer_;
+  delete[] right_buffer_;
 
   SDL_DestroyRenderer(renderer_);
   SDL_DestroyWindow(window_);
 }
 
 void Display::recreate_video_textures_for_current_mode() {
-  if (video_texture_linear_ != nullptr) {
-    SDL_DestroyTexture(video_texture_linear_);
-    video_texture_linear_ = nullptr;
-  }
-  if (video_texture_nn_ != nullptr) {
-    SDL_DestroyTexture(video_texture_nn_);
-    video_texture_nn_ = nullptr;
-  }
+  video_texture_state_ = VideoTextureState{};
+
+  video_texture_linear_.reset();
+  video_texture_nn_.reset();
 
+  // tiled, so that layouts beyond the maximum texture size of the renderer can be shown
   auto create_video_texture = [&](const std::string& scale_quality) {
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, scale_quality.c_str());
-    return check_sdl(SDL_CreateTexture(renderer_, use_10_bpc_ ? SDL_PIXELFORMAT_ARGB2101010 : SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING, mode_ == Mode::HStack ? video_width_ * 2 : video_width_,
-                                       mode_ == Mode::VStack ? video_height_ * 2 : video_height_),
-                     "video texture " + scale_quality);
+    return std::make_unique<TiledTexture>(renderer_, use_10_bpc_ ? SDL_PIXELFORMAT_ARGB2101010 : SDL_PIXELFORMAT_RGB24, mode_ == Mode::HStack ? video_width_ * 2 : video_width_,
+                                          mode_ == Mode::VStack ? video_height_ * 2 : video_height_);
   };
 
   video_texture_linear_ = create_video_texture("linear");
@@ -609,14 +632,17 @@ void Display::reinitialize_video_dimensions(const unsigned width, const unsigned
 
   recreate_video_textures_for_current_mode();
 
-  if (diff_buffer_ != nullptr) {
-    delete[] diff_buffer_;
-    diff_buffer_ = nullptr;
+  // the buffers below are shared with the difference worker
+  wait_for_difference_worker_idle();
+
+  difference_pitch_ = video_width_ * 3 * (use_10_bpc_ ? sizeof(uint16_t) : sizeof(uint8_t));
+
+  for (auto& buffer : difference_buffers_) {
+    buffer.data.resize(difference_pitch_ * video_height_);
+    buffer.key.clear();
   }
-  diff_buffer_ = new uint8_t[video_width_ * video_height_ * 3 * (use_10_bpc_ ? sizeof(uint16_t) : sizeof(uint8_t))];
-  diff_planes_ = {diff_buffer_, nullptr, nullptr};
-  diff_pitches_ = {video_width_ * 3 * (use_10_bpc_ ? sizeof(uint16_t) : sizeof(uint8_t)), 0, 0};
 
+  // frames in the packed texture format are expanded into these for the difference
   if (left_buffer_ != nullptr) {
     delete[] left_buffer_;
     left_buffer_ = nullptr;
@@ -625,8 +651,10 @@ void Display::reinitialize_video_dimensions(const unsigned width, const unsigned
     delete[] right_buffer_;
     right_buffer_ = nullptr;
   }
-  left_planes_ = {nullptr, nullptr, nullptr};
-  right_planes_ = {nullptr, nullptr, nullptr};
+  if (use_10_bpc_) {
+    left_buffer_ = new uint8_t[video_width_ * video_height_ * 3 * sizeof(uint16_t)];
+    right_buffer_ = new uint8_t[video_width_ * video_height_ * 3 * sizeof(uint16_t)];
+  }
 
   move_offset_ = Vector2D((global_center_.x() - 0.5F) * static_cast<float>(video_width_), (global_center_.y() - 0.5F) * static_cast<float>(video_height_));
 
@@ -676,9 +704,8 @@ void Display::print_verbose_info() {
   Uint32 window_pixel_format = SDL_GetWindowPixelFormat(window_);
   std::cout << "SDL window px format:  " << stringify_format_and_bpp(window_pixel_format) << std::endl;
 
-  Uint32 video_pixel_format;
-  SDL_QueryTexture(video_texture_linear_, &video_pixel_format, nullptr, nullptr, nullptr);
-  std::cout << "SDL video px format:   " << stringify_format_and_bpp(video_pixel_format) << std::endl;
+  std::cout << "SDL video px format:   " << stringify_format_and_bpp(video_texture_linear_->get_format()) << std::endl;
+  std::cout << "SDL video tiles:       " << video_texture_linear_->get_tile_count() << std::endl;
 
   std::cout << "FFmpeg version:        " << av_version_info() << std::endl;
   std::cout << "libavutil version:     " << format_libav_version(avutil_version()) << std::endl;
@@ -714,6 +741,9 @@ void Display::rebuild_fonts() {
 
   small_font_ = check_sdl(TTF_OpenFontRW(embedded_font_small, 1, small_font_size), "font open");
   big_font_ = check_sdl(TTF_OpenFontRW(embedded_font_big, 1, big_font_size), "font open");
+
+  small_glyph_atlas_ = std::make_unique<GlyphAtlas>(renderer_, small_font_);
+  big_glyph_atlas_ = std::make_unique<GlyphAtlas>(renderer_, big_font_);
 }
 
 void Display::update_hud_text_layout() {
@@ -994,12 +1024,12 @@ void Display::handle_window_resize(const bool reset_forced_size_guard, const boo
   }
 }
 
-void Display::convert_to_packed_10_bpc(std::array<uint8_t*, 3> in_planes, std::array<size_t, 3> in_pitches, std::array<uint32_t*, 3> out_planes, std::array<size_t, 3> out_pitches, const SDL_Rect& roi) {
+void Display::convert_to_packed_10_bpc(std::array<uint8_t*, 3> in_planes, std::array<size_t, 3> in_pitches, uint32_t* out_plane, const size_t out_pitch, const SDL_Rect& roi) {
   row_workers_.run_dynamic(
       roi.h,
       [=](const int start_row, const int end_row) {
         uint16_t* p_in = reinterpret_cast<uint16_t*>(in_planes[0] + roi.x * 6 + in_pitches[0] * (roi.y + start_row));
-        uint32_t* p_out = out_planes[0] + roi.x + out_pitches[0] * (roi.y + start_row) / sizeof(uint32_t);
+        uint32_t* p_out = out_plane + out_pitch * start_row / sizeof(uint32_t);
 
         for (int y = start_row; y < end_row; y++) {
           for (int in_x = 0, out_x = 0; out_x < roi.w; in_x += 3, out_x++) {
@@ -1011,190 +1041,108 @@ void Display::convert_to_packed_10_bpc(std::array<uint8_t*, 3> in_planes, std::a
           }
 
           p_in += in_pitches[0] / sizeof(uint16_t);
-          p_out += out_pitches[0] / sizeof(uint32_t);
+          p_out += out_pitch / sizeof(uint32_t);
         }
       },
       suggest_block_rows_by_bytes(roi.w, roi.h, sizeof(uint16_t), 3));
 }
 
-template <int Bpc>
-inline void process_difference_scanline(const typename BitDepthTraits<Bpc>::P* plane_left,
-                                        const typename BitDepthTraits<Bpc>::P* plane_right,
-                                        typename BitDepthTraits<Bpc>::P* plane_difference,
-                                        const int pixels,
-                                        const Display::DiffMode mode,
-                                        const bool luma_only,
-                                        const std::vector<uint32_t>& mag_u,
-                                        const std::vector<uint32_t>& mag_s) {
-  using T = BitDepthTraits<Bpc>;
-  constexpr uint32_t MAX = T::MaxCode;
-  constexpr uint32_t MID = MAX >> 1;
-
-  auto load = [](typename T::P v) -> int { return (int)(v >> T::PackShift); };
-
-  for (int i = 0; i < pixels; i++) {
-    const int idx = i * 3;
-    const int rl = load(plane_left[idx]), gl = load(plane_left[idx + 1]), bl = load(plane_left[idx + 2]);
-    const int rr = load(plane_right[idx]), gr = load(plane_right[idx + 1]), br = load(plane_right[idx + 2]);
-
-    if (mode == Display::DiffMode::LegacyAbs) {
-      // Original: per-channel abs * AMPLIFICATION, clamped to bit depth
-      constexpr int AMPLIFICATION = 2;
-
-      if (luma_only) {
-        const int dl = luma709(rl, gl, bl) - luma709(rr, gr, br);
-        const uint32_t Y = clamp_u32(std::abs(dl) * AMPLIFICATION, MAX);
-        auto y_p = T::from10(Y);
-
-        plane_difference[idx] = y_p;
-        plane_difference[idx + 1] = y_p;
-        plane_difference[idx + 2] = y_p;
-      } else {
-        const uint32_t R = clamp_u32(std::abs(rl - rr) * AMPLIFICATION, MAX);
-        const uint32_t G = clamp_u32(std::abs(gl - gr) * AMPLIFICATION, MAX);
-        const uint32_t B = clamp_u32(std::abs(bl - br) * AMPLIFICATION, MAX);
-
-        plane_difference[idx + 0] = T::from10(R);
-        plane_difference[idx + 1] = T::from10(G);
-        plane_difference[idx + 2] = T::from10(B);
-      }
-      continue;
-    }
-
-    // Adaptive mapping with optional sign and luma-only
-    if (luma_only) {
-      const int dl = luma709(rl, gl, bl) - luma709(rr, gr, br);
-      const uint32_t a = (uint32_t)std::min<int>(MAX, std::abs(dl));
-
-      if (mode == Display::DiffMode::SignedDiverging) {
-        const uint32_t m = mag_s[a];
-        const uint32_t Y = (dl >= 0) ? (MID + m) : (MID - m);
-        auto y_p = T::from10(Y);
-        plane_difference[idx + 0] = plane_difference[idx + 1] = plane_difference[idx + 2] = y_p;
-      } else {
-        const uint32_t Y = mag_u[a];
-        auto y_p = T::from10(Y);
-        plane_difference[idx + 0] = plane_difference[idx + 1] = plane_difference[idx + 2] = y_p;
-      }
-    } else {
-      const int dr = rl - rr, dg = gl - gr, db = bl - br;
-
-      if (mode == Display::DiffMode::SignedDiverging) {
-        const uint32_t ar = (uint32_t)std::min<int>(MAX, std::abs(dr));
-        const uint32_t ag = (uint32_t)std::min<int>(MAX, std::abs(dg));
-        const uint32_t ab = (uint32_t)std::min<int>(MAX, std::abs(db));
-
-        plane_difference[idx + 0] = T::from10(dr >= 0 ? (MID + mag_s[ar]) : (MID - mag_s[ar]));
-        plane_difference[idx + 1] = T::from10(dg >= 0 ? (MID + mag_s[ag]) : (MID - mag_s[ag]));
-        plane_difference[idx + 2] = T::from10(db >= 0 ? (MID + mag_s[ab]) : (MID - mag_s[ab]));
-      } else {
-        const uint32_t ar = (uint32_t)std::min<int>(MAX, std::abs(dr));
-        const uint32_t ag = (uint32_t)std::min<int>(MAX, std::abs(dg));
-        const uint32_t ab = (uint32_t)std::min<int>(MAX, std::abs(db));
+// expands ARGB2101010 to RGB48, replicating the top bits into the low ones as a full-range conversion would
+static inline void unpack_10_bpc_scanline(const uint32_t* in, uint16_t* out, const int pixels) {
+  for (int x = 0; x < pixels; x++) {
+    const uint32_t r = (in[x] >> 20) & 0x3FF;
+    const uint32_t g = (in[x] >> 10) & 0x3FF;
+    const uint32_t b = in[x] & 0x3FF;
 
-        plane_difference[idx + 0] = T::from10(mag_u[ar]);
-        plane_difference[idx + 1] = T::from10(mag_u[ag]);
-        plane_difference[idx + 2] = T::from10(mag_u[ab]);
-      }
-    }
+    out[x * 3] = static_cast<uint16_t>((r << 6) | (r >> 4));
+    out[x * 3 + 1] = static_cast<uint16_t>((g << 6) | (g >> 4));
+    out[x * 3 + 2] = static_cast<uint16_t>((b << 6) | (b >> 4));
   }
 }
 
-template <int Bpc>
-float Display::calculate_frame_p99(const typename BitDepthTraits<Bpc>::P* plane_left, const typename BitDepthTraits<Bpc>::P* plane_right, const size_t pitch_left, const size_t pitch_right, const int width_right) const {
-  using T = BitDepthTraits<Bpc>;
-  static_assert(Bpc == 8 || Bpc == 10, "Bpc must be 8 or 10");
-  constexpr int CHANNELS = 3;
-
-  const size_t stride_l = pitch_left / sizeof(typename T::P);
-  const size_t stride_r = pitch_right / sizeof(typename T::P);
+void Display::convert_from_packed_10_bpc(const uint8_t* in_plane, const size_t in_pitch, uint8_t* out_plane, const size_t out_pitch, const SDL_Rect& roi) {
+  difference_row_workers_.run_dynamic(
+      roi.h,
+      [=](const int start_row, const int end_row) {
+        for (int y = roi.y + start_row; y < roi.y + end_row; y++) {
+          const uint32_t* p_in = reinterpret_cast<const uint32_t*>(in_plane + in_pitch * y) + roi.x;
+          uint16_t* p_out = reinterpret_cast<uint16_t*>(out_plane + out_pitch * y) + roi.x * 3;
 
-  const int bins = static_cast<int>(T::MaxCode) + 1;
-  const int num_threads = row_workers_.size();
+          unpack_10_bpc_scanline(p_in, p_out, roi.w);
+        }
+      },
+      suggest_block_rows_by_bytes(roi.w, roi.h, sizeof(uint16_t), 3));
+}
 
-  std::vector<std::vector<uint32_t>> thread_histograms(num_threads, std::vector<uint32_t>(bins, 0u));
+static AVFramePtr expand_packed_10_bpc_frame(const AVFrame* frame) {
+  AVFramePtr expanded(av_frame_alloc(), frame_deleter);
 
-  // Use RowWorkers to compute histograms for different row ranges
-  auto histograms_ptr = std::make_shared<std::vector<std::vector<uint32_t>>>(std::move(thread_histograms));
+  if (expanded == nullptr || av_frame_copy_props(expanded.get(), frame) < 0 || av_image_alloc(expanded->data, expanded->linesize, frame->width, frame->height, AV_PIX_FMT_RGB48LE, 64) < 0) {
+    throw std::runtime_error("Unable to allocate an RGB48 frame for expanding packed 10 bpc pixels");
+  }
 
-  row_workers_.run_dynamic_indexed(
-      video_height_,
-      [=](const int start_row, const int end_row, const int worker_index) {
-        auto& hist = (*histograms_ptr)[worker_index];
+  expanded->format = AV_PIX_FMT_RGB48LE;
+  expanded->width = frame->width;
+  expanded->height = frame->height;
 
-        for (int y = start_row; y < end_row; y++) {
-          const typename T::P* row_l = plane_left + y * stride_l;
-          const typename T::P* row_r = plane_right + y * stride_r;
+  for (int y = 0; y < frame->height; y++) {
+    unpack_10_bpc_scanline(reinterpret_cast<const uint32_t*>(frame->data[0] + frame->linesize[0] * y), reinterpret_cast<uint16_t*>(expanded->data[0] + expanded->linesize[0] * y), frame->width);
+  }
 
-          for (int x = 0; x < width_right; x++) {
-            const int idx = x * CHANNELS;
+  return expanded;
+}
 
-            const int rl = row_l[idx + 0] >> T::PackShift;
-            const int gl = row_l[idx + 1] >> T::PackShift;
-            const int bl = row_l[idx + 2] >> T::PackShift;
+// Specialized per bit depth, luma-only and histogram collection at compile time. The difference
+// mode is resolved once per frame in make_difference_mapping, so the inner loops are a subtraction
+// and a table lookup. The histogram (for the adaptive scale) counts the absolute luma difference,
+// or else the largest absolute channel difference, of each pixel.
+template <int Bpc, bool LumaOnly, bool CollectHistogram>
+void process_difference_scanline(const typename BitDepthTraits<Bpc>::P* plane_left,
+                                 const typename BitDepthTraits<Bpc>::P* plane_right,
+                                 typename BitDepthTraits<Bpc>::P* plane_difference,
+                                 const int pixels,
+                                 const typename BitDepthTraits<Bpc>::P* mapping,
+                                 uint32_t* histogram) {
+  using T = BitDepthTraits<Bpc>;
+  constexpr int MAX = T::MaxCode;
 
-            const int rr = row_r[idx + 0] >> T::PackShift;
-            const int gr = row_r[idx + 1] >> T::PackShift;
-            const int br = row_r[idx + 2] >> T::PackShift;
+  auto load = [](typename T::P v) -> int { return (int)(v >> T::PackShift); };
 
-            int d;
-            if (diff_luma_only_) {
-              const int yl = luma709(rl, gl, bl);
-              const int yr = luma709(rr, gr, br);
-              d = std::abs(yl - yr);
-            } else {
-              const int dr = std::abs(rl - rr);
-              const int dg = std::abs(gl - gr);
-              const int db = std::abs(bl - br);
-              d = dr > dg ? (dr > db ? dr : db) : (dg > db ? dg : db);
-            }
+  if (LumaOnly) {
+    for (int i = 0; i < pixels; i++) {
+      const int idx = i * 3;
+      const int dl = luma709(load(plane_left[idx]), load(plane_left[idx + 1]), load(plane_left[idx + 2])) - luma709(load(plane_right[idx]), load(plane_right[idx + 1]), load(plane_right[idx + 2]));
+      const auto y_p = mapping[dl + MAX];
 
-            const int bin = clamp_range(d, 0, bins - 1);
-            hist[static_cast<size_t>(bin)]++;
-          }
-        }
-      },
-      suggest_block_rows_by_bytes(video_width_, video_height_, sizeof(typename BitDepthTraits<Bpc>::P), 3));
+      plane_difference[idx + 0] = y_p;
+      plane_difference[idx + 1] = y_p;
+      plane_difference[idx + 2] = y_p;
 
-  // Merge histograms
-  std::vector<uint32_t> hist(bins, 0u);
-  for (const auto& thread_hist : *histograms_ptr) {
-    for (size_t i = 0; i < bins; ++i) {
-      hist[i] += thread_hist[i];
+      if (CollectHistogram) {
+        histogram[std::abs(dl)]++;
+      }
     }
-  }
-
-  // Sum of histogram counts
-  uint64_t total = std::accumulate(hist.begin(), hist.end(), 0);
-
-  if (total == 0) {
-    return 1.f;
-  }
-
-  // Linear-interpolated 99th percentile
-  const double target_f = 0.99 * (double)(total - 1);
-  const uint64_t r0 = (uint64_t)std::floor(target_f);
-  const uint64_t r1 = (uint64_t)std::ceil(target_f);
-  const double frac = target_f - (double)r0;
-
-  int v0 = bins - 1, v1 = bins - 1;
-  uint64_t acc = 0;
-
-  // Find the values at ranks r0 and r1
-  for (int k = 0; k < bins; k++) {
-    const uint64_t next = acc + hist[static_cast<size_t>(k)];
-    if (acc <= r0 && r0 < next) {
-      v0 = k;
+  } else if (CollectHistogram) {
+    for (int i = 0; i < pixels; i++) {
+      const int idx = i * 3;
+      const int dr = load(plane_left[idx]) - load(plane_right[idx]);
+      const int dg = load(plane_left[idx + 1]) - load(plane_right[idx + 1]);
+      const int db = load(plane_left[idx + 2]) - load(plane_right[idx + 2]);
+
+      plane_difference[idx + 0] = mapping[dr + MAX];
+      plane_difference[idx + 1] = mapping[dg + MAX];
+      plane_difference[idx + 2] = mapping[db + MAX];
+
+      histogram[std::max(std::abs(dr), std::max(std::abs(dg), std::abs(db)))]++;
     }
-    if (acc <= r1 && r1 < next) {
-      v1 = k;
-      break;
+  } else {
+    // channels are mapped independently, so the scanline is a single run of samples
+    const int samples = pixels * 3;
+
+    for (int i = 0; i < samples; i++) {
+      plane_difference[i] = mapping[load(plane_left[i]) - load(plane_right[i]) + MAX];
     }
-    acc = next;
   }
-
-  const float p = (float)v0 + frac * (float)(v1 - v0);
-  return p;
 }
 
 std::pair<std::vector<uint32_t>, std::vector<uint32_t>> make_diff_lut(uint32_t max_code, Display::DiffMode mode, uint32_t scale_max) {
@@ -1242,6 +1190,55 @@ std::pair<std::vector<uint32_t>, std::vector<uint32_t>> make_diff_lut(uint32_t m
   return std::pair<std::vector<uint32_t>, std::vector<uint32_t>>(std::move(mag_u), std::move(mag_s));
 };
 
+// Output sample for every signed difference in [-MAX, MAX] (indexed by difference + MAX)
+template <int Bpc>
+std::vector<typename BitDepthTraits<Bpc>::P> make_difference_mapping(const Display::DiffMode mode, const uint32_t scale_max) {
+  using T = BitDepthTraits<Bpc>;
+  constexpr int MAX = T::MaxCode;
+  constexpr uint32_t MID = MAX >> 1;
+
+  // Original: per-channel abs * AMPLIFICATION, clamped to bit depth
+  constexpr uint32_t AMPLIFICATION = 2;
+
+  // LUTs for the adaptive mappings
+  const auto luts = make_diff_lut(MAX, mode, scale_max);
+  const std::vector<uint32_t>& mag_u = luts.first;
+  const std::vector<uint32_t>& mag_s = luts.second;
+
+  std::vector<typename T::P> mapping(2 * MAX + 1);
+
+  for (int d = -MAX; d <= MAX; d++) {
+    const uint32_t a = static_cast<uint32_t>(std::abs(d));
+    uint32_t value;
+
+    switch (mode) {
+      case Display::DiffMode::LegacyAbs:
+        value = std::min<uint32_t>(a * AMPLIFICATION, MAX);
+        break;
+      case Display::DiffMode::SignedDiverging:
+        value = d >= 0 ? (MID + mag_s[a]) : (MID - mag_s[a]);
+        break;
+      default:
+        value = mag_u[a];
+        break;
+    }
+
+    mapping[d + MAX] = T::from10(value);
+  }
+
+  return mapping;
+}
+
+// Integerized/clipped scale of the adaptive mappings for a given frame p99
+template <int Bpc>
+uint32_t p99_to_difference_scale(const float p99) {
+  constexpr uint32_t MAX = BitDepthTraits<Bpc>::MaxCode;
+
+  const float scale_max = clamp_range(p99, 4.f, (float)MAX);
+
+  return (uint32_t)std::max<double>(1.0, std::min<double>(double(MAX), std::round(std::fabs(scale_max))));
+}
+
 template <int Bpc>
 void Display::process_difference_planes(const typename BitDepthTraits<Bpc>::P* plane_left0,
                                         const typename BitDepthTraits<Bpc>::P* plane_right0,
@@ -1250,90 +1247,238 @@ void Display::process_difference_planes(const typename BitDepthTraits<Bpc>::P* p
                                         const size_t pitch_right,
                                         const size_t pitch_difference,
                                         const int width_right,
-                                        const float diff_max) const {
+                                        const int height,
+                                        const DiffMode mode,
+                                        const bool luma_only,
+                                        const uint32_t scale_max,
+                                        std::vector<uint32_t>* histogram) const {
   using T = BitDepthTraits<Bpc>;
-  constexpr uint32_t MAX = T::MaxCode;
 
-  const float scale_max = (diff_mode_ == Display::DiffMode::LegacyAbs) ? -1.f : clamp_range(diff_max, 4.f, (float)MAX);
+  const auto mapping = make_difference_mapping<Bpc>(mode, scale_max);
+  const typename T::P* mapping_data = mapping.data();
 
-  // Integerize/clip scale once
-  const uint32_t scale_max_i = (uint32_t)std::max<double>(1.0, std::min<double>(double(MAX), std::round(std::fabs(scale_max))));
+  using ScanlineKernel = void (*)(const typename T::P*, const typename T::P*, typename T::P*, const int, const typename T::P*, uint32_t*);
 
-  // Build LUTs (only for adaptive mapping)
-  auto luts = make_diff_lut(MAX, diff_mode_, scale_max_i);
-  const std::vector<uint32_t> mag_u = std::move(luts.first);
-  const std::vector<uint32_t> mag_s = std::move(luts.second);
+  ScanlineKernel process_scanline;
+  if (histogram != nullptr) {
+    process_scanline = luma_only ? &process_difference_scanline<Bpc, true, true> : &process_difference_scanline<Bpc, false, true>;
+  } else {
+    process_scanline = luma_only ? &process_difference_scanline<Bpc, true, false> : &process_difference_scanline<Bpc, false, false>;
+  }
 
-  row_workers_.run_dynamic(
-      video_height_,
-      [=](const int start_row, const int end_row) {
+  // one histogram per worker, merged below
+  const size_t bins = static_cast<size_t>(T::MaxCode) + 1;
+  std::vector<uint32_t> worker_histograms(histogram != nullptr ? bins * difference_row_workers_.size() : 0, 0u);
+  uint32_t* worker_histograms_data = worker_histograms.data();
+
+  difference_row_workers_.run_dynamic_indexed(
+      height,
+      [=](const int start_row, const int end_row, const int worker_index) {
         auto plane_left = plane_left0 + start_row * (pitch_left / sizeof(typename T::P));
         auto plane_right = plane_right0 + start_row * (pitch_right / sizeof(typename T::P));
         auto plane_difference = plane_difference0 + start_row * (pitch_difference / sizeof(typename T::P));
+        uint32_t* worker_histogram = worker_histograms_data != nullptr ? worker_histograms_data + bins * worker_index : nullptr;
 
         for (int y = start_row; y < end_row; y++) {
-          process_difference_scanline<Bpc>(plane_left, plane_right, plane_difference, width_right, diff_mode_, diff_luma_only_, mag_u, mag_s);
+          process_scanline(plane_left, plane_right, plane_difference, width_right, mapping_data, worker_histogram);
           plane_left += pitch_left / sizeof(typename T::P);
           plane_right += pitch_right / sizeof(typename T::P);
           plane_difference += pitch_difference / sizeof(typename T::P);
         }
       },
-      suggest_block_rows_by_bytes(video_width_, video_height_, sizeof(typename BitDepthTraits<Bpc>::P), 3));
-}
+      suggest_block_rows_by_bytes(width_right, height, sizeof(typename BitDepthTraits<Bpc>::P), 3));
 
-void Display::update_difference(std::array<uint8_t*, 3> planes_left, std::array<size_t, 3> pitches_left, std::array<uint8_t*, 3> planes_right, std::array<size_t, 3> pitches_right, int split_x) {
-  constexpr int CHANNELS = 3;
+  if (histogram != nullptr) {
+    histogram->assign(bins, 0u);
 
-  const int width_right = (video_width_ - split_x);
-  if (width_right <= 0) {
+    for (size_t i = 0; i < worker_histograms.size(); i++) {
+      (*histogram)[i % bins] += worker_histograms[i];
+    }
+  }
+}
+
+template <int Bpc>
+void Display::update_difference_planes(const typename BitDepthTraits<Bpc>::P* plane_left0,
+                                       const typename BitDepthTraits<Bpc>::P* plane_right0,
+                                       typename BitDepthTraits<Bpc>::P* plane_difference0,
+                                       const size_t pitch_left,
+                                       const size_t pitch_right,
+                                       const size_t pitch_difference,
+                                       const int width_right,
+                                       const int height,
+                                       const DiffMode mode,
+                                       const bool luma_only) {
+  if (mode == DiffMode::LegacyAbs) {
+    process_difference_planes<Bpc>(plane_left0, plane_right0, plane_difference0, pitch_left, pitch_right, pitch_difference, width_right, height, mode, luma_only, std::max(difference_scale_, 1U), nullptr);
     return;
   }
 
-  const bool update_frame_max = diff_mode_ != DiffMode::LegacyAbs;
-  float frame_max = 1.f;
+  // The adaptive modes scale by the p99 of the frame itself. Rather than reading both frames once
+  // for the histogram and again for the mapping, map with the previous scale while collecting the
+  // histogram, and only map again if the frame's own scale turns out to differ noticeably.
+  const uint32_t speculative_scale = difference_scale_ > 0 ? difference_scale_ : BitDepthTraits<Bpc>::MaxCode;
 
-  // row starts after split_x pixels, i.e., split_x * 3 samples
-  if (use_10_bpc_) {
-    auto plane_left0 = reinterpret_cast<uint16_t*>(planes_left[0]) + split_x * CHANNELS;
-    auto plane_right0 = reinterpret_cast<uint16_t*>(planes_right[0]) + split_x * CHANNELS;
-    auto plane_difference0 = reinterpret_cast<uint16_t*>(diff_planes_[0]) + split_x * CHANNELS;
+  std::vector<uint32_t> histogram;
+  process_difference_planes<Bpc>(plane_left0, plane_right0, plane_difference0, pitch_left, pitch_right, pitch_difference, width_right, height, mode, luma_only, speculative_scale, &histogram);
 
-    if (update_frame_max) {
-      frame_max = calculate_frame_p99<10>(plane_left0, plane_right0, pitches_left[0], pitches_right[0], width_right);
-    }
+  difference_scale_ = p99_to_difference_scale<Bpc>(calculate_histogram_percentile(histogram.data(), static_cast<int>(histogram.size()), 0.99));
+
+  const uint32_t scale_error = difference_scale_ > speculative_scale ? difference_scale_ - speculative_scale : speculative_scale - difference_scale_;
 
-    process_difference_planes<10>(plane_left0, plane_right0, plane_difference0, pitches_left[0], pitches_right[0], diff_pitches_[0], width_right, frame_max);
+  if (static_cast<float>(scale_error) > static_cast<float>(difference_scale_) * DIFFERENCE_SCALE_TOLERANCE) {
+    process_difference_planes<Bpc>(plane_left0, plane_right0, plane_difference0, pitch_left, pitch_right, pitch_difference, width_right, height, mode, luma_only, difference_scale_, nullptr);
+  }
+}
+
+void Display::update_difference(const DifferenceJob& job, uint8_t* plane_difference, const size_t pitch_difference) {
+  const int width = job.right_frame->width;
+  const int height = job.right_frame->height;
+
+  const uint8_t* plane_left = job.left_frame->data[0];
+  const uint8_t* plane_right = job.right_frame->data[0];
+  size_t pitch_left = job.left_frame->linesize[0];
+  size_t pitch_right = job.right_frame->linesize[0];
+
+  // the difference kernels work on RGB48, so frames in the packed texture format are expanded first
+  if (ffmpeg::is_packed_10_bpc_rgb(job.left_frame->format)) {
+    const SDL_Rect roi = {0, 0, width, height};
+
+    convert_from_packed_10_bpc(plane_left, pitch_left, left_buffer_, pitch_difference, roi);
+    convert_from_packed_10_bpc(plane_right, pitch_right, right_buffer_, pitch_difference, roi);
+
+    plane_left = left_buffer_;
+    plane_right = right_buffer_;
+    pitch_left = pitch_difference;
+    pitch_right = pitch_difference;
+  }
+
+  if (use_10_bpc_) {
+    update_difference_planes<10>(reinterpret_cast<const uint16_t*>(plane_left), reinterpret_cast<const uint16_t*>(plane_right), reinterpret_cast<uint16_t*>(plane_difference), pitch_left, pitch_right, pitch_difference, width,
+                                 height, job.mode, job.luma_only);
   } else {
-    auto plane_left0 = planes_left[0] + split_x * CHANNELS;
-    auto plane_right0 = planes_right[0] + split_x * CHANNELS;
-    auto plane_difference0 = diff_planes_[0] + split_x * CHANNELS;
+    update_difference_planes<8>(plane_left, plane_right, plane_difference, pitch_left, pitch_right, pitch_difference, width, height, job.mode, job.luma_only);
+  }
+}
 
-    if (update_frame_max) {
-      frame_max = calculate_frame_p99<8>(plane_left0, plane_right0, pitches_left[0], pitches_right[0], width_right);
-    }
+void Display::submit_difference(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& key) {
+  if (key == submitted_difference_key_) {
+    return;
+  }
+
+  // converted frames are reference-counted, so this does not copy any pixels
+  AVFrame* left_ref = av_frame_clone(left_frame);
+  AVFrame* right_ref = av_frame_clone(right_frame);
 
-    process_difference_planes<8>(plane_left0, plane_right0, plane_difference0, pitches_left[0], pitches_right[0], diff_pitches_[0], width_right, frame_max);
+  if (left_ref == nullptr || right_ref == nullptr) {
+    av_frame_free(&left_ref);
+    av_frame_free(&right_ref);
+    throw std::runtime_error("av_frame_clone failed");
   }
+
+  {
+    std::lock_guard<std::mutex> lock(difference_mutex_);
+
+    // latest wins: a job the worker has not picked up yet is superseded
+    av_frame_free(&pending_difference_job_.left_frame);
+    av_frame_free(&pending_difference_job_.right_frame);
+
+    pending_difference_job_ = DifferenceJob{left_ref, right_ref, key, diff_mode_, diff_luma_only_};
+  }
+  difference_cv_.notify_all();
+
+  submitted_difference_key_ = key;
 }
 
-void write_png(const AVFrame* frame, const std::string& filename, std::atomic_bool& error_occurred) {
-  try {
-    PngSaver::save(frame, filename);
-  } catch (const PngSaver::IOException& e) {
-    std::cerr << "Error saving video PNG image to file: " << filename << std::endl;
-    error_occurred = true;
-  } catch (const std::runtime_error& e) {
-    std::cerr << "Unexpected while error saving PNG: " << e.what() << std::endl;
-    error_occurred = true;
+bool Display::consume_prepared_difference() {
+  std::lock_guard<std::mutex> lock(difference_mutex_);
+
+  if (!has_ready_difference_) {
+    return false;
   }
-};
+
+  std::swap(difference_reading_index_, difference_ready_index_);
+  has_ready_difference_ = false;
+
+  return true;
+}
+
+void Display::wait_for_difference_worker_idle() {
+  std::unique_lock<std::mutex> lock(difference_mutex_);
+
+  av_frame_free(&pending_difference_job_.left_frame);
+  av_frame_free(&pending_difference_job_.right_frame);
+  pending_difference_job_ = DifferenceJob{};
+
+  difference_cv_.wait(lock, [this]() { return !difference_worker_busy_; });
+
+  submitted_difference_key_.clear();
+}
+
+void Display::stop_difference_worker() {
+  {
+    std::lock_guard<std::mutex> lock(difference_mutex_);
+    quit_difference_worker_ = true;
+  }
+  difference_cv_.notify_all();
+
+  if (difference_worker_.joinable()) {
+    difference_worker_.join();
+  }
+
+  av_frame_free(&pending_difference_job_.left_frame);
+  av_frame_free(&pending_difference_job_.right_frame);
+}
+
+void Display::run_difference_worker() {
+  for (;;) {
+    DifferenceJob job;
+    int writing_index;
+    {
+      std::unique_lock<std::mutex> lock(difference_mutex_);
+      difference_cv_.wait(lock, [this]() { return quit_difference_worker_ || pending_difference_job_.left_frame != nullptr; });
+
+      if (quit_difference_worker_) {
+        return;
+      }
+
+      job = pending_difference_job_;
+      pending_difference_job_ = DifferenceJob{};
+
+      difference_worker_busy_ = true;
+      writing_index = difference_writing_index_;
+    }
+
+    DifferenceBuffer& buffer = difference_buffers_[writing_index];
+
+    update_difference(job, buffer.data.data(), difference_pitch_);
+    buffer.key = job.key;
+
+    av_frame_free(&job.left_frame);
+    av_frame_free(&job.right_frame);
+
+    {
+      std::lock_guard<std::mutex> lock(difference_mutex_);
+
+      std::swap(difference_writing_index_, difference_ready_index_);
+      has_ready_difference_ = true;
+      difference_worker_busy_ = false;
+    }
+    difference_cv_.notify_all();
+  }
+}
 
 void Display::save_image_frames(const AVFrame* left_frame, const AVFrame* right_frame) {
-  std::atomic_bool error_occurred(false);
+  // reference-counted, so that the save queue takes it over without a copy
+  const auto create_onscreen_display_avframe = [&]() -> AVFrame* {
+    AVFrame* renderer_frame = av_frame_alloc();
+    renderer_frame->format = use_10_bpc_ ? AV_PIX_FMT_RGB48LE : AV_PIX_FMT_RGB24;
+    renderer_frame->width = drawable_width_;
+    renderer_frame->height = drawable_height_;
 
-  const auto create_onscreen_display_avframe = [&]() -> AVFramePtr {
-    const size_t pitch = use_10_bpc_ ? drawable_width_ * 3 * sizeof(uint16_t) : drawable_width_ * 3;
-    uint8_t* pixels = reinterpret_cast<uint8_t*>(av_malloc(pitch * drawable_height_));
+    if (av_frame_get_buffer(renderer_frame, 0) < 0) {
+      av_frame_free(&renderer_frame);
+      throw std::runtime_error("Unable to allocate a frame for the on-screen content");
+    }
 
     if (use_10_bpc_) {
       const size_t temp_pitch = drawable_width_ * sizeof(uint32_t);
@@ -1342,33 +1487,29 @@ void Display::save_image_frames(const AVFrame* left_frame, const AVFrame* right_
       SDL_RenderReadPixels(renderer_, nullptr, SDL_PIXELFORMAT_ARGB2101010, temp_pixels.data(), temp_pitch);
 
       const uint32_t* src = reinterpret_cast<const uint32_t*>(temp_pixels.data());
-      uint16_t* dest = reinterpret_cast<uint16_t*>(pixels);
 
-      for (int i = 0; i < drawable_width_ * drawable_height_; i++) {
-        const uint32_t argb = *(src++);
-        const uint32_t r10 = (argb >> 20) & 0x3FF;
-        const uint32_t g10 = (argb >> 10) & 0x3FF;
-        const uint32_t b10 = argb & 0x3FF;
+      for (int y = 0; y < drawable_height_; y++) {
+        uint16_t* dest = reinterpret_cast<uint16_t*>(renderer_frame->data[0] + static_cast<size_t>(y) * renderer_frame->linesize[0]);
+
+        for (int x = 0; x < drawable_width_; x++) {
+          const uint32_t argb = *(src++);
+          const uint32_t r10 = (argb >> 20) & 0x3FF;
+          const uint32_t g10 = (argb >> 10) & 0x3FF;
+          const uint32_t b10 = argb & 0x3FF;
 
-        *(dest++) = static_cast<uint16_t>(r10 << 6);
-        *(dest++) = static_cast<uint16_t>(g10 << 6);
-        *(dest++) = static_cast<uint16_t>(b10 << 6);
+          *(dest++) = static_cast<uint16_t>(r10 << 6);
+          *(dest++) = static_cast<uint16_t>(g10 << 6);
+          *(dest++) = static_cast<uint16_t>(b10 << 6);
+        }
       }
     } else {
-      SDL_RenderReadPixels(renderer_, nullptr, SDL_PIXELFORMAT_RGB24, pixels, pitch);
+      SDL_RenderReadPixels(renderer_, nullptr, SDL_PIXELFORMAT_RGB24, renderer_frame->data[0], renderer_frame->linesize[0]);
     }
 
-    AVFrame* renderer_frame = av_frame_alloc();
-    renderer_frame->format = use_10_bpc_ ? AV_PIX_FMT_RGB48LE : AV_PIX_FMT_RGB24;
-    renderer_frame->width = drawable_width_;
-    renderer_frame->height = drawable_height_;
-    renderer_frame->data[0] = pixels;
-    renderer_frame->linesize[0] = pitch;
-
-    return AVFramePtr(renderer_frame, frame_deleter);
+    return renderer_frame;
   };
 
-  const auto osd_frame = create_onscreen_display_avframe();
+  AVFrame* osd_frame = create_onscreen_display_avframe();
 
   const std::string& left_stem = side_ui_[displayed_left_side_.as_simple_index()].file_stem;
   const std::string& right_stem = side_ui_[displayed_right_side_.as_simple_index()].file_stem;
@@ -1377,21 +1518,27 @@ void Display::save_image_frames(const AVFrame* left_frame, const AVFrame* right_
   const std::string right_filename = string_sprintf("%s%s_%04d.png", right_stem.c_str(), stems_equal ? "_right" : "", saved_image_number_);
   const std::string osd_filename = string_sprintf("%s_%s_osd_%04d.png", left_stem.c_str(), right_stem.c_str(), saved_image_number_);
 
-  auto save_frame = [&](const AVFrame* frame, const std::string& filename) { return write_png(frame, filename, error_occurred); };
+  const bool queued = queue_image_save({left_frame, right_frame, osd_frame}, {left_filename, right_filename, osd_filename});
 
-  std::thread save_left_frame_thread(save_frame, left_frame, left_filename);
-  std::thread save_right_frame_thread(save_frame, right_frame, right_filename);
-  std::thread save_osd_frame_thread(save_frame, osd_frame.get(), osd_filename);
+  av_frame_free(&osd_frame);
 
-  save_left_frame_thread.join();
-  save_right_frame_thread.join();
-  save_osd_frame_thread.join();
+  // numbered as queued, so that a save still in progress is not overwritten by the next one
+  if (queued) {
+    saved_image_number_++;
+  }
+}
 
-  if (!error_occurred) {
-    notify_user(string_sprintf("Saved %s, %s and %s", left_filename.c_str(), right_filename.c_str(), osd_filename.c_str()));
+bool Display::queue_image_save(const std::vector<const AVFrame*>& frames, const std::vector<std::string>& filenames) {
+  if (image_save_queue_ == nullptr) {
+    image_save_queue_ = std::make_unique<ImageSaveQueue>(IMAGE_SAVE_THREAD_COUNT, MAX_PENDING_SAVED_IMAGES, png_compression_level_);
+  }
 
-    saved_image_number_++;
+  if (!image_save_queue_->submit(frames, filenames)) {
+    notify_user("Still saving earlier images, please try again shortly");
+    return false;
   }
+
+  return true;
 }
 
 void Display::render_text(const int x, const int y, SDL_Texture* texture, const int texture_width, const int texture_height, const int border_extension, const bool left_adjust) {
@@ -1445,6 +1592,26 @@ void Display::render_text(const int x, const int y, SDL_Texture* texture, const
   }
 }
 
+void Display::render_atlas_text(const int x, const int y, const std::string& text, const SDL_Color& color, const bool left_adjust) {
+  const int text_width = small_glyph_atlas_->get_text_width(text);
+  const int text_height = small_glyph_atlas_->get_height();
+
+  // overlong text loses its leading characters, like the clipped part of a rendered texture
+  size_t first = 0;
+  int shown_width = text_width;
+
+  while (first < text.size() && shown_width + double_border_extension_ > max_text_width_) {
+    shown_width -= small_glyph_atlas_->get_advance(text[first++]);
+  }
+
+  const int shown_x = (!left_adjust && (mode_ != Mode::VStack)) ? x + text_width - shown_width : x;
+
+  const SDL_Rect fill_rect = {shown_x - border_extension_, y - border_extension_, shown_width + double_border_extension_, text_height + double_border_extension_};
+  SDL_RenderFillRect(renderer_, &fill_rect);
+
+  small_glyph_atlas_->queue_text(shown_x, y, text.substr(first), color);
+}
+
 void Display::render_progress_dots(const float position, const float progress, const bool is_top) {
   if (duration_ > 0) {
     const float dot_size = 2.f;
@@ -1475,12 +1642,29 @@ void Display::render_progress_dots(const float position, const float progress, c
   }
 }
 
-SDL_Texture* Display::get_video_texture() const {
-  return bilinear_texture_filtering_ ? video_texture_linear_ : video_texture_nn_;
+TiledTexture* Display::get_video_texture() const {
+  return bilinear_texture_filtering_ ? video_texture_linear_.get() : video_texture_nn_.get();
+}
+
+std::string Display::get_texture_content_key(const AVFrame* frame) {
+  // the buffer address tells apart frames of different inputs that share a frame key
+  return string_sprintf("%s@%p", get_frame_key(frame).c_str(), static_cast<const void*>(frame->data[0]));
 }
 
 void Display::update_texture(const SDL_Rect* rect, const void* pixels, int pitch, const std::string& message) {
-  check_sdl(SDL_UpdateTexture(get_video_texture(), rect, pixels, pitch) == 0, "video texture - " + message);
+  check_sdl(get_video_texture()->update(*rect, pixels, pitch), "video texture - " + message);
+}
+
+void Display::update_texture_packed_10_bpc(const SDL_Rect* rect, std::array<uint8_t*, 3> planes, std::array<size_t, 3> pitches, const SDL_Rect& roi, const std::string& message) {
+  // pack straight into the (write-only) texture memory rather than via a staging buffer; the roi
+  // is in frame coordinates, offset from the rectangle by the same amount for every tile
+  auto writer = [&](const SDL_Rect& part, void* pixels, const int pitch) {
+    const SDL_Rect part_roi = {roi.x + part.x - rect->x, roi.y + part.y - rect->y, part.w, part.h};
+
+    convert_to_packed_10_bpc(planes, pitches, static_cast<uint32_t*>(pixels), static_cast<size_t>(pitch), part_roi);
+  };
+
+  check_sdl(get_video_texture()->update_locked(*rect, writer), "video texture lock - " + message);
 }
 
 int Display::round_and_clamp(const float value) {
@@ -1581,6 +1765,15 @@ std::string Display::get_and_format_rgb_yuv_pixel(uint8_t* rgb_plane, const size
   return "RGB" + format_pixel(rgb) + ", YUV" + format_pixel(yuv);
 }
 
+SDL_Rect clamp_roi_to_frame(const AVFrame* frame, const SDL_Rect& roi) {
+  const int x = clamp_range(roi.x, 0, frame->width - 1);
+  const int y = clamp_range(roi.y, 0, frame->height - 1);
+  const int w = clamp_range(roi.w, 1, frame->width - x);
+  const int h = clamp_range(roi.h, 1, frame->height - y);
+
+  return {x, y, w, h};
+}
+
 AVFrame* crop_rgb_frame(const AVFrame* src, const SDL_Rect& roi, SDL_Rect* out_effective_roi = nullptr) {
   AVFrame* cropped_frame = av_frame_clone(src);
 
@@ -1593,22 +1786,63 @@ AVFrame* crop_rgb_frame(const AVFrame* src, const SDL_Rect& roi, SDL_Rect* out_e
     bpp = 3;
   } else if (src->format == AV_PIX_FMT_RGB48LE) {
     bpp = 6;
+  } else if (ffmpeg::is_packed_10_bpc_rgb(src->format)) {
+    bpp = 4;
   } else {
     throw std::runtime_error("Unknown packed RGB format");
   }
 
-  const int x = clamp_range(roi.x, 0, src->width - 1);
-  const int y = clamp_range(roi.y, 0, src->height - 1);
-  const int w = clamp_range(roi.w, 1, src->width - x);
-  const int h = clamp_range(roi.h, 1, src->height - y);
+  const SDL_Rect effective_roi = clamp_roi_to_frame(src, roi);
 
   if (out_effective_roi != nullptr) {
-    *out_effective_roi = {x, y, w, h};
+    *out_effective_roi = effective_roi;
+  }
+
+  cropped_frame->data[0] = cropped_frame->data[0] + effective_roi.y * cropped_frame->linesize[0] + effective_roi.x * bpp;
+  cropped_frame->width = effective_roi.w;
+  cropped_frame->height = effective_roi.h;
+  return cropped_frame;
+}
+
+QualityMetricsRoi Display::to_source_frame_roi(const SDL_Rect& roi, const AVFrame* source_frame) const {
+  // the display frames are scaled to the common video size; map back to the source sampling grid
+  const int64_t source_width = source_frame->width;
+  const int64_t source_height = source_frame->height;
+
+  const int x0 = static_cast<int>(roi.x * source_width / video_width_);
+  const int y0 = static_cast<int>(roi.y * source_height / video_height_);
+  const int x1 = static_cast<int>(((roi.x + roi.w) * source_width + video_width_ - 1) / video_width_);
+  const int y1 = static_cast<int>(((roi.y + roi.h) * source_height + video_height_ - 1) / video_height_);
+
+  return QualityMetricsRoi{x0, y0, x1 - x0, y1 - y0};
+}
+
+SDL_Rect Display::to_frame_roi(const SDL_Rect& roi, const AVFrame* frame) const {
+  // display frames of a reduced (adaptive preview) resolution cover the video area on a coarser grid
+  const QualityMetricsRoi frame_roi = to_source_frame_roi(roi, frame);
+
+  return {frame_roi.x, frame_roi.y, frame_roi.w, frame_roi.h};
+}
+
+AVFrame* crop_source_frame(const AVFrame* src, const QualityMetricsRoi& roi) {
+  // source frames are reference-counted, so this only adjusts plane pointers
+  AVFrame* cropped_frame = av_frame_clone(src);
+
+  if (!cropped_frame) {
+    throw std::runtime_error("Unable to clone source frame");
+  }
+
+  cropped_frame->crop_left = roi.x;
+  cropped_frame->crop_top = roi.y;
+  cropped_frame->crop_right = src->width - (roi.x + roi.w);
+  cropped_frame->crop_bottom = src->height - (roi.y + roi.h);
+
+  // unaligned, so that the region is exactly the one the PSNR and SSIM are computed over
+  if (av_frame_apply_cropping(cropped_frame, AV_FRAME_CROP_UNALIGNED) < 0) {
+    av_frame_free(&cropped_frame);
+    throw std::runtime_error("Unable to crop source frame");
   }
 
-  cropped_frame->data[0] = cropped_frame->data[0] + y * cropped_frame->linesize[0] + x * bpp;
-  cropped_frame->width = w;
-  cropped_frame->height = h;
   return cropped_frame;
 }
 
@@ -1740,22 +1974,184 @@ std::string Display::compute_psnr(const float* left_plane, const float* right_pl
   return string_sprintf("%.3f", -10.f * log10f(static_cast<float>(mse)));
 }
 
-void Display::render_help() {
-  SDL_SetRenderDrawBlendMode(renderer_, SDL_BLENDMODE_BLEND);
-  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA * 3 / 2);
-  SDL_RenderFillRect(renderer_, nullptr);
+void Display::print_windowed_vmaf(const std::vector<std::pair<const AVFrame*, const AVFrame*>>& frame_pairs) {
+  print_windowed_vmaf_ = false;
 
-  int y = help_y_offset_;
+  const SDL_Rect roi = get_visible_roi_in_single_frame_coordinates();
 
-  for (size_t i = 0; i < help_textures_.size(); i++) {
-    int w, h;
-    SDL_QueryTexture(help_textures_[i], nullptr, nullptr, &w, &h);
+  if (roi.w <= 0 || roi.h <= 0) {
+    std::cerr << "ROI is empty, skipping windowed VMAF calculation" << std::endl;
+    return;
+  }
+  if (frame_pairs.empty()) {
+    return;
+  }
 
-    SDL_Rect screen_area = {HELP_TEXT_HORIZONTAL_MARGIN, y, w, h};
-    SDL_RenderCopy(renderer_, help_textures_[i], nullptr, &screen_area);
+  // native planes are used only if every pair in the window offers them
+  const bool use_source_frames = std::all_of(frame_pairs.cbegin(), frame_pairs.cend(), [](const std::pair<const AVFrame*, const AVFrame*>& frame_pair) {
+    const AVFrame* left_source = get_source_frame(frame_pair.first);
+    const AVFrame* right_source = get_source_frame(frame_pair.second);
 
-    y += h + HELP_TEXT_LINE_SPACING;
-  }
+    return left_source != nullptr && right_source != nullptr && can_compute_native_quality_metrics(left_source, right_source);
+  });
+
+  // in video coordinates; the buffer may also hold frames of a reduced preview resolution
+  const SDL_Rect video_rect{0, 0, video_width_, video_height_};
+  SDL_Rect effective_roi{};
+  SDL_IntersectRect(&roi, &video_rect, &effective_roi);
+
+  std::vector<AVFrame*> crops;
+  std::vector<std::pair<const AVFrame*, const AVFrame*>> crop_pairs;
+
+  crops.reserve(frame_pairs.size() * 2);
+
+  for (const auto& frame_pair : frame_pairs) {
+    AVFrame* left_crop;
+    AVFrame* right_crop;
+
+    if (use_source_frames) {
+      const QualityMetricsRoi source_roi = to_source_frame_roi(effective_roi, get_source_frame(frame_pair.first));
+
+      left_crop = crop_source_frame(get_source_frame(frame_pair.first), source_roi);
+      right_crop = crop_source_frame(get_source_frame(frame_pair.second), source_roi);
+    } else {
+      left_crop = crop_rgb_frame(frame_pair.first, to_frame_roi(effective_roi, frame_pair.first));
+      right_crop = crop_rgb_frame(frame_pair.second, to_frame_roi(effective_roi, frame_pair.second));
+    }
+
+    crops.push_back(left_crop);
+    crops.push_back(right_crop);
+    crop_pairs.emplace_back(left_crop, right_crop);
+  }
+
+  VMAFWindowScores scores;
+
+  if (VMAFCalculator::instance().compute_window(crop_pairs, scores)) {
+    auto format_positions = [](const std::pair<const AVFrame*, const AVFrame*>& frame_pair) {
+      return string_sprintf("[%s|%s]", format_position(ffmpeg::pts_in_secs(frame_pair.first), false).c_str(), format_position(ffmpeg::pts_in_secs(frame_pair.second), false).c_str());
+    };
+
+    const std::string roi_str = (effective_roi.w < video_width_ || effective_roi.h < video_height_)
+                                    ? string_sprintf("  (%d,%d)-(%d,%d)", effective_roi.x, effective_roi.y, effective_roi.x + effective_roi.w - 1, effective_roi.y + effective_roi.h - 1)
+                                    : "";
+
+    std::cout << string_sprintf("VMAF window: %s-%s %d frames, pooled VMAF(%s)%s", format_positions(frame_pairs.front()).c_str(), format_positions(frame_pairs.back()).c_str(), static_cast<int>(frame_pairs.size()),
+                                string_join(scores.pooled, "|").c_str(), roi_str.c_str())
+              << std::endl;
+
+    for (size_t i = 0; i < scores.per_frame.size() && i < frame_pairs.size(); i++) {
+      std::vector<std::string> frame_scores;
+
+      for (const double score : scores.per_frame[i]) {
+        frame_scores.push_back(string_sprintf("%.6f", score));
+      }
+
+      std::cout << string_sprintf("  %s VMAF(%s)", format_positions(frame_pairs[i]).c_str(), string_join(frame_scores, "|").c_str()) << std::endl;
+    }
+  }
+
+  for (AVFrame* crop : crops) {
+    av_frame_free(&crop);
+  }
+}
+
+bool Display::is_live_metrics_on() const {
+  return live_metrics_ != nullptr && live_metrics_->get_mode() != LiveMetrics::Mode::Off;
+}
+
+void Display::render_live_metrics(const int y) {
+  std::string metrics_str;
+
+  if (live_metrics_history_.empty()) {
+    metrics_str = "Live metrics: waiting for results";
+  } else {
+    const LiveMetrics::Sample& latest = live_metrics_history_.back();
+
+    if (!latest.valid) {
+      metrics_str = "Live metrics: n/a (sizes or pixel formats differ)";
+    } else {
+      const std::string psnr_str = latest.psnr_is_infinite ? "inf" : string_sprintf("%.2f dB", latest.psnr);
+      const std::string ssim_str = latest.has_ssim ? string_sprintf("%.4f", latest.ssim) : "n/a";
+
+      metrics_str = string_sprintf("PSNR %s  SSIM %s", psnr_str.c_str(), ssim_str.c_str());
+
+      if (live_metrics_->get_mode() == LiveMetrics::Mode::PsnrSsimVmaf) {
+        metrics_str += string_sprintf("  VMAF %s", latest.vmaf.empty() ? "n/a" : latest.vmaf.c_str());
+      }
+    }
+
+    if (live_metrics_dropped_count_ > 0) {
+      metrics_str += string_sprintf("  (skipped %llu)", static_cast<unsigned long long>(live_metrics_dropped_count_));
+    }
+  }
+
+  const int metrics_text_width = small_glyph_atlas_->get_text_width(metrics_str);
+  const int metrics_text_height = small_glyph_atlas_->get_height();
+
+  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA);
+  render_atlas_text(drawable_width_ / 2 - metrics_text_width / 2, y, metrics_str, LIVE_METRICS_COLOR, false);
+
+  // rolling PSNR sparkline beneath the text; lossless pairs pin to the top
+  std::vector<double> psnr_values;
+
+  for (const auto& sample : live_metrics_history_) {
+    if (sample.valid && !sample.psnr_is_infinite) {
+      psnr_values.push_back(sample.psnr);
+    }
+  }
+
+  if (live_metrics_history_.size() < 2 || psnr_values.empty()) {
+    return;
+  }
+
+  const auto minmax = std::minmax_element(psnr_values.cbegin(), psnr_values.cend());
+  const double min_psnr = *minmax.first;
+  const double psnr_range = std::max(*minmax.second - min_psnr, 1.0);
+
+  const int sparkline_width = std::max(metrics_text_width, static_cast<int>(LIVE_METRICS_HISTORY_SIZE));
+  const int sparkline_height = metrics_text_height * 3 / 2;
+  const SDL_Rect sparkline_rect = {drawable_width_ / 2 - sparkline_width / 2, y + metrics_text_height + double_border_extension_ + border_extension_, sparkline_width, sparkline_height};
+
+  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA);
+  SDL_RenderFillRect(renderer_, &sparkline_rect);
+
+  std::vector<SDL_Point> points;
+  points.reserve(live_metrics_history_.size());
+
+  const float x_step = static_cast<float>(sparkline_width - 1) / static_cast<float>(LIVE_METRICS_HISTORY_SIZE - 1);
+  const int x_offset = sparkline_rect.x + sparkline_width - 1 - static_cast<int>(x_step * (live_metrics_history_.size() - 1));
+
+  for (size_t i = 0; i < live_metrics_history_.size(); i++) {
+    const LiveMetrics::Sample& sample = live_metrics_history_[i];
+
+    if (!sample.valid) {
+      continue;
+    }
+
+    const double normalized = sample.psnr_is_infinite ? 1.0 : (sample.psnr - min_psnr) / psnr_range;
+    points.push_back({x_offset + static_cast<int>(x_step * i), sparkline_rect.y + sparkline_height - 1 - static_cast<int>(normalized * (sparkline_height - 1))});
+  }
+
+  SDL_SetRenderDrawColor(renderer_, LIVE_METRICS_COLOR.r, LIVE_METRICS_COLOR.g, LIVE_METRICS_COLOR.b, SDL_ALPHA_OPAQUE);
+  SDL_RenderDrawLines(renderer_, points.data(), static_cast<int>(points.size()));
+}
+
+void Display::render_help() {
+  SDL_SetRenderDrawBlendMode(renderer_, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA * 3 / 2);
+  SDL_RenderFillRect(renderer_, nullptr);
+
+  int y = help_y_offset_;
+
+  for (size_t i = 0; i < help_textures_.size(); i++) {
+    int w, h;
+    SDL_QueryTexture(help_textures_[i], nullptr, nullptr, &w, &h);
+
+    SDL_Rect screen_area = {HELP_TEXT_HORIZONTAL_MARGIN, y, w, h};
+    SDL_RenderCopy(renderer_, help_textures_[i], nullptr, &screen_area);
+
+    y += h + HELP_TEXT_LINE_SPACING;
+  }
 }
 
 void Display::render_metadata_overlay() {
@@ -2207,8 +2603,6 @@ void Display::possibly_apply_crop() {
 }
 
 void Display::save_selected_area(const AVFrame* left_frame, const AVFrame* right_frame, const SDL_Rect& selection_rect) {
-  std::atomic_bool error_occurred(false);
-
   // Lambda for creating and initializing frames
   auto create_frame = [&](const int width, const int height, const AVFrame* source_frame) -> AVFrame* {
     AVFrame* frame = av_frame_alloc();
@@ -2249,23 +2643,13 @@ void Display::save_selected_area(const AVFrame* left_frame, const AVFrame* right
   const std::string right_filename = string_sprintf("%s%s_cutout_%04d.png", right_stem.c_str(), stems_equal ? "_right" : "", saved_selected_image_number_);
   const std::string concatenated_filename = string_sprintf("%s_%s_cutout_concat_%04d.png", left_stem.c_str(), right_stem.c_str(), saved_selected_image_number_);
 
-  auto save_frame = [&](const AVFrame* frame, const std::string& filename) { return write_png(frame, filename, error_occurred); };
-
-  std::thread save_left_thread(save_frame, left_selected, left_filename);
-  std::thread save_right_thread(save_frame, right_selected, right_filename);
-  std::thread save_concatenated_thread(save_frame, concatenated, concatenated_filename);
-
-  save_left_thread.join();
-  save_right_thread.join();
-  save_concatenated_thread.join();
+  const bool queued = queue_image_save({left_selected, right_selected, concatenated}, {left_filename, right_filename, concatenated_filename});
 
   av_frame_free(&left_selected);
   av_frame_free(&right_selected);
   av_frame_free(&concatenated);
 
-  if (!error_occurred) {
-    std::cout << "Saved " << string_sprintf("%s, %s and %s", left_filename.c_str(), right_filename.c_str(), concatenated_filename.c_str()) << std::endl;
-
+  if (queued) {
     saved_selected_image_number_++;
   }
 }
@@ -2277,27 +2661,57 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
   const bool has_updated_left_frame = previous_left_frame_key_ != left_frame_key;
   const bool has_updated_right_frame = previous_right_frame_key_ != right_frame_key;
 
-  if (!input_received_ && !has_updated_left_frame && !has_updated_right_frame && !timer_based_update_performed_ && pending_message_.empty()) {
+  // hand the pair over to the live metrics worker (never waits) and pick up any finished results
+  bool has_updated_live_metrics = false;
+
+  if (is_live_metrics_on()) {
+    live_metrics_->submit(left_frame, right_frame);
+    has_updated_live_metrics = live_metrics_->consume_update(live_metrics_history_, live_metrics_dropped_count_) && show_hud_;
+  }
+
+  // likewise, a difference image finished by the worker is shown as soon as it is handed over
+  const bool has_updated_difference = consume_prepared_difference() && subtraction_mode_;
+
+  // report the saves finished in the background
+  if (image_save_queue_ != nullptr) {
+    for (const auto& notification : image_save_queue_->consume_notifications()) {
+      notify_user(notification);
+    }
+  }
+
+  if (!input_received_ && !has_updated_left_frame && !has_updated_right_frame && !timer_based_update_performed_ && !has_updated_live_metrics && !has_updated_difference && !has_updated_mosaic_frames_ && pending_message_.empty()) {
     return false;
   }
 
+  has_updated_mosaic_frames_ = false;
+
   std::array<uint8_t*, 3> planes_left{left_frame->data[0], left_frame->data[1], left_frame->data[2]};
   std::array<uint8_t*, 3> planes_right{right_frame->data[0], right_frame->data[1], right_frame->data[2]};
   std::array<size_t, 3> pitches_left{static_cast<size_t>(left_frame->linesize[0]), static_cast<size_t>(left_frame->linesize[1]), static_cast<size_t>(left_frame->linesize[2])};
   std::array<size_t, 3> pitches_right{static_cast<size_t>(right_frame->linesize[0]), static_cast<size_t>(right_frame->linesize[1]), static_cast<size_t>(right_frame->linesize[2])};
 
-  // init 10 bpc temp buffers
-  if (use_10_bpc_) {
-    if (left_buffer_ == nullptr) {
-      left_buffer_ = new uint32_t[pitches_left[0] * video_height_ / 4];
-      left_planes_ = {left_buffer_, nullptr, nullptr};
+  // one-shot actions read the frames in video coordinates, so they wait for full-resolution frames
+  const bool has_full_resolution_frames = !is_preview_frame(left_frame) && !is_preview_frame(right_frame);
+
+  // they also work on RGB48 in 10 bpc mode, so frames converted straight to the packed texture
+  // format are expanded while such an action is pending
+  const bool has_pending_frame_action = print_mouse_position_and_color_ || print_image_similarity_metrics_ || save_image_frames_ || (save_selected_area_ && selection_state_ == SelectionState::Completed);
+
+  AVFramePtr expanded_left_frame(nullptr, frame_deleter);
+  AVFramePtr expanded_right_frame(nullptr, frame_deleter);
+
+  if (has_pending_frame_action && has_full_resolution_frames) {
+    if (ffmpeg::is_packed_10_bpc_rgb(left_frame->format)) {
+      expanded_left_frame.reset(expand_packed_10_bpc_frame(left_frame).release());
     }
-    if (right_buffer_ == nullptr) {
-      right_buffer_ = new uint32_t[pitches_right[0] * video_height_ / 4];
-      right_planes_ = {right_buffer_, nullptr, nullptr};
+    if (ffmpeg::is_packed_10_bpc_rgb(right_frame->format)) {
+      expanded_right_frame.reset(expand_packed_10_bpc_frame(right_frame).release());
     }
   }
 
+  const AVFrame* action_left_frame = expanded_left_frame != nullptr ? expanded_left_frame.get() : left_frame;
+  const AVFrame* action_right_frame = expanded_right_frame != nullptr ? expanded_right_frame.get() : right_frame;
+
   const bool compare_mode = show_left_ && show_right_;
 
   const auto zoom_rect = compute_zoom_rect();
@@ -2309,8 +2723,13 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
   const int mouse_video_y = mouse_video_pos.y();
 
   // print pixel position in original video coordinates and RGB+YUV color value
-  if (print_mouse_position_and_color_) {
-    const bool print_left_pixel = mouse_video_x >= 0 && mouse_video_x < video_width_ && mouse_video_y >= 0 && mouse_video_y < video_height_;
+  if (print_mouse_position_and_color_ && has_full_resolution_frames) {
+    // the mosaic canvas maps onto the frame of the tile under the mouse instead
+    if (mode_ == Mode::Mosaic) {
+      print_mosaic_pixel(left_frame, mouse_video_x, mouse_video_y);
+    }
+
+    const bool print_left_pixel = mode_ != Mode::Mosaic && mouse_video_x >= 0 && mouse_video_x < video_width_ && mouse_video_y >= 0 && mouse_video_y < video_height_;
 
     bool print_right_pixel;
 
@@ -2340,10 +2759,10 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
       auto original_right_dims = get_original_dimensions(right_frame);
 
       std::cout << "Left:  " << string_sprintf("[%4d,%4d]", pixel_video_x * original_left_dims.first / video_width_, pixel_video_y * original_left_dims.second / video_height_);
-      std::cout << ", " << get_and_format_rgb_yuv_pixel(planes_left[0], pitches_left[0], left_frame, pixel_video_x, pixel_video_y);
+      std::cout << ", " << get_and_format_rgb_yuv_pixel(action_left_frame->data[0], action_left_frame->linesize[0], action_left_frame, pixel_video_x, pixel_video_y);
       std::cout << " - ";
       std::cout << "Right: " << string_sprintf("[%4d,%4d]", pixel_video_x * original_right_dims.first / video_width_, pixel_video_y * original_right_dims.second / video_height_);
-      std::cout << ", " << get_and_format_rgb_yuv_pixel(planes_right[0], pitches_right[0], right_frame, pixel_video_x, pixel_video_y);
+      std::cout << ", " << get_and_format_rgb_yuv_pixel(action_right_frame->data[0], action_right_frame->linesize[0], action_right_frame, pixel_video_x, pixel_video_y);
       std::cout << std::endl;
     }
 
@@ -2351,7 +2770,7 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
   }
 
   // print image similarity metrics
-  if (print_image_similarity_metrics_) {
+  if (print_image_similarity_metrics_ && has_full_resolution_frames) {
     SDL_Rect roi = get_visible_roi_in_single_frame_coordinates();
 
     if (roi.w <= 0 || roi.h <= 0) {
@@ -2359,8 +2778,8 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
     } else {
       SDL_Rect effective_roi_left{}, effective_roi_right{};
 
-      AVFrame* left_crop = crop_rgb_frame(left_frame, roi, &effective_roi_left);
-      AVFrame* right_crop = crop_rgb_frame(right_frame, roi, &effective_roi_right);
+      AVFrame* left_crop = crop_rgb_frame(action_left_frame, roi, &effective_roi_left);
+      AVFrame* right_crop = crop_rgb_frame(action_right_frame, roi, &effective_roi_right);
 
       // assert dimensions are the same
       if (!SDL_RectEquals(&effective_roi_left, &effective_roi_right)) {
@@ -2370,22 +2789,47 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
         const int crop_width = effective_roi_left.w;
         const int crop_height = effective_roi_left.h;
 
-        float* left_gray = rgb_to_grayscale(left_crop->data[0], left_crop->linesize[0], crop_width, crop_height);
-        float* right_gray = rgb_to_grayscale(right_crop->data[0], right_crop->linesize[0], crop_width, crop_height);
+        std::string psnr, ssim, vmaf, format_str;
+
+        // prefer the native (pre-conversion) planes; fall back to the luma of the display frames
+        // when the two sides differ in dimensions or pixel format, or the format is not supported
+        const AVFrame* left_source = get_source_frame(left_frame);
+        const AVFrame* right_source = get_source_frame(right_frame);
+        const QualityMetricsRoi source_roi = left_source != nullptr ? to_source_frame_roi(effective_roi_left, left_source) : QualityMetricsRoi{};
+        QualityMetrics native_metrics;
+
+        if (left_source != nullptr && right_source != nullptr && compute_native_quality_metrics(left_source, right_source, source_roi, row_workers_, native_metrics)) {
+          psnr = native_metrics.format_psnr();
+          ssim = native_metrics.format_ssim();
+          format_str = string_sprintf(" %s", native_metrics.pixel_format_name.c_str());
+
+          // VMAF is defined on YUV, so hand libvmaf the native planes as well
+          AVFrame* left_source_crop = crop_source_frame(left_source, source_roi);
+          AVFrame* right_source_crop = crop_source_frame(right_source, source_roi);
 
-        const std::string psnr = compute_psnr(left_gray, right_gray, crop_width, crop_height);
-        const std::string ssim = compute_ssim(left_gray, right_gray, crop_width, crop_height);
-        const std::string vmaf = (left_crop && right_crop) ? VMAFCalculator::instance().compute(left_crop, right_crop) : "n/a";
+          vmaf = VMAFCalculator::instance().compute(left_source_crop, right_source_crop);
+
+          av_frame_free(&left_source_crop);
+          av_frame_free(&right_source_crop);
+        } else {
+          float* left_gray = rgb_to_grayscale(left_crop->data[0], left_crop->linesize[0], crop_width, crop_height);
+          float* right_gray = rgb_to_grayscale(right_crop->data[0], right_crop->linesize[0], crop_width, crop_height);
+
+          psnr = compute_psnr(left_gray, right_gray, crop_width, crop_height);
+          ssim = compute_ssim(left_gray, right_gray, crop_width, crop_height);
+
+          delete[] left_gray;
+          delete[] right_gray;
+
+          vmaf = (left_crop && right_crop) ? VMAFCalculator::instance().compute(left_crop, right_crop) : "n/a";
+        }
 
         const std::string roi_str =
             (crop_width < video_width_ || crop_height < video_height_) ? string_sprintf("  (%d,%d)-(%d,%d)", effective_roi_left.x, effective_roi_left.y, effective_roi_left.x + crop_width - 1, effective_roi_left.y + crop_height - 1) : "";
 
-        std::cout << string_sprintf("Metrics: [%s|%s] PSNR(%s), SSIM(%s), VMAF(%s)%s", format_position(ffmpeg::pts_in_secs(left_frame), false).c_str(), format_position(ffmpeg::pts_in_secs(right_frame), false).c_str(), psnr.c_str(),
-                                    ssim.c_str(), vmaf.c_str(), roi_str.c_str())
+        std::cout << string_sprintf("Metrics: [%s|%s]%s PSNR(%s), SSIM(%s), VMAF(%s)%s", format_position(ffmpeg::pts_in_secs(left_frame), false).c_str(), format_position(ffmpeg::pts_in_secs(right_frame), false).c_str(), format_str.c_str(),
+                                    psnr.c_str(), ssim.c_str(), vmaf.c_str(), roi_str.c_str())
                   << std::endl;
-
-        delete[] left_gray;
-        delete[] right_gray;
       }
 
       if (left_crop) {
@@ -2414,97 +2858,164 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
   // the nearest texel border to the mouse x-position in window coordinates
   const float video_texel_clamped_mouse_x = static_cast<float>(content_window_.x) + (std::round(video_mouse_x) * zoom_rect.size.x() / static_cast<float>(video_width_) + zoom_rect.start.x()) / video_to_window_width_factor_;
 
-  if (show_left_ || show_right_) {
-    const int split_x = (compare_mode && mode_ == Mode::Split) ? clamp_range(std::round(video_mouse_x), 0.0F, float(video_width_)) : show_left_ ? video_width_ : 0;
+  const int split_x = (compare_mode && mode_ == Mode::Split) ? clamp_range(std::round(video_mouse_x), 0.0F, float(video_width_)) : show_left_ ? video_width_ : 0;
+
+  // uploads and draws leave out the video texture tiles outside the window; those which missed an
+  // upload while there are stale, so everything visible is uploaded anew once one of them shows
+  get_video_texture()->set_visible_rect(get_visible_texture_rect(zoom_rect, left_frame, right_frame));
+
+  if (get_video_texture()->consume_stale_visible_tiles()) {
+    video_texture_state_ = VideoTextureState{};
+  }
+
+  if (mode_ == Mode::Mosaic) {
+    render_mosaic(left_frame, zoom_rect);
+  } else if (show_left_ || show_right_) {
+
+    // the video texture is a render cache: only the columns it does not hold already for the
+    // current frames (and difference settings) are converted and uploaded
+    if (video_texture_state_.texture != get_video_texture()) {
+      video_texture_state_ = VideoTextureState{};
+      video_texture_state_.texture = get_video_texture();
+    }
+
+    const std::string left_content_key = get_texture_content_key(left_frame);
+    const std::string right_content_key =
+        subtraction_mode_ ? string_sprintf("diff:%d:%d|%s|%s", static_cast<int>(diff_mode_), diff_luma_only_, left_content_key.c_str(), get_texture_content_key(right_frame).c_str()) : get_texture_content_key(right_frame);
+
+    if (video_texture_state_.left_key != left_content_key) {
+      video_texture_state_.left_key = left_content_key;
+      video_texture_state_.left_valid_until = 0;
+    }
+    if (video_texture_state_.right_key != right_content_key) {
+      video_texture_state_.right_key = right_content_key;
+      video_texture_state_.right_valid_from = right_frame->width;
+    }
+
+    // frames converted at a reduced preview resolution fill the top-left of their texture region and
+    // are stretched to the video area, so the bands below are in texture (i.e., frame) columns
+    const float left_scale_x = static_cast<float>(video_width_) / static_cast<float>(left_frame->width);
+    const float right_scale_x = static_cast<float>(video_width_) / static_cast<float>(right_frame->width);
 
     // update video
     if (show_left_ && (split_x > 0)) {
-      const SDL_Rect tex_render_quad_left = {0, 0, split_x, video_height_};
-      const SDL_FRect screen_render_quad_left = video_rect_to_drawable_transform(video_to_zoom_space(tex_render_quad_left, zoom_rect));
+      const int end_left = std::min(static_cast<int>(std::ceil(static_cast<float>(split_x) / left_scale_x)), left_frame->width);
+
+      const SDL_Rect tex_render_quad_left = {0, 0, end_left, left_frame->height};
+      const SDL_Rect video_quad_left = {0, 0, std::min(round(static_cast<float>(end_left) * left_scale_x), video_width_), video_height_};
+      const SDL_FRect screen_render_quad_left = video_rect_to_drawable_transform(video_to_zoom_space(video_quad_left, zoom_rect));
+
+      const int band_start = video_texture_state_.left_valid_until;
 
-      if (input_received_ || has_updated_left_frame) {
-        if (use_10_bpc_) {
-          convert_to_packed_10_bpc(planes_left, pitches_left, left_planes_, pitches_left, tex_render_quad_left);
+      if (band_start < end_left) {
+        const SDL_Rect tex_band_left = {band_start, 0, end_left - band_start, left_frame->height};
 
-          update_texture(&tex_render_quad_left, left_planes_[0], pitches_left[0], "left update (10 bpc, video mode)");
+        if (ffmpeg::is_packed_10_bpc_rgb(left_frame->format)) {
+          update_texture(&tex_band_left, planes_left[0] + band_start * 4, pitches_left[0], "left update (packed 10 bpc, video mode)");
+        } else if (use_10_bpc_) {
+          update_texture_packed_10_bpc(&tex_band_left, planes_left, pitches_left, tex_band_left, "left update (10 bpc, video mode)");
         } else {
-          update_texture(&tex_render_quad_left, planes_left[0], pitches_left[0], "left update (video mode)");
+          update_texture(&tex_band_left, planes_left[0] + band_start * 3, pitches_left[0], "left update (video mode)");
+        }
+
+        video_texture_state_.left_valid_until = end_left;
+
+        // both sides share the same texture columns in split mode
+        if (mode_ == Mode::Split) {
+          video_texture_state_.right_valid_from = std::max(video_texture_state_.right_valid_from, end_left);
         }
       }
 
-      check_sdl(SDL_RenderCopyF(renderer_, get_video_texture(), &tex_render_quad_left, &screen_render_quad_left) == 0, "left video texture render copy");
+      check_sdl(get_video_texture()->render_copy(tex_render_quad_left, screen_render_quad_left), "left video texture render copy");
     }
     if (show_right_ && ((split_x < video_width_) || mode_ != Mode::Split)) {
-      const int start_right = (mode_ == Mode::Split) ? std::max(split_x, 0) : 0;
+      const int start_right = (mode_ == Mode::Split) ? static_cast<int>(std::floor(static_cast<float>(std::max(split_x, 0)) / right_scale_x)) : 0;
       const int right_x_offset = (mode_ == Mode::HStack) ? video_width_ : 0;
       const int right_y_offset = (mode_ == Mode::VStack) ? video_height_ : 0;
+      const int video_start_right = round(static_cast<float>(start_right) * right_scale_x);
 
-      const SDL_Rect tex_render_quad_right = {right_x_offset + start_right, right_y_offset, (video_width_ - start_right), video_height_};
-      const SDL_Rect roi = {start_right, 0, (video_width_ - start_right), video_height_};
-      const SDL_FRect screen_render_quad_right = video_rect_to_drawable_transform(video_to_zoom_space(tex_render_quad_right, zoom_rect));
+      const SDL_Rect tex_render_quad_right = {right_x_offset + start_right, right_y_offset, (right_frame->width - start_right), right_frame->height};
+      const SDL_Rect video_quad_right = {right_x_offset + video_start_right, right_y_offset, (video_width_ - video_start_right), video_height_};
+      const SDL_FRect screen_render_quad_right = video_rect_to_drawable_transform(video_to_zoom_space(video_quad_right, zoom_rect));
 
-      if (input_received_ || has_updated_right_frame) {
-        if (subtraction_mode_) {
-          update_difference(planes_left, pitches_left, planes_right, pitches_right, start_right);
+      const int band_end = video_texture_state_.right_valid_from;
+
+      // the difference needs both frames at the same resolution
+      const bool can_update_right = !subtraction_mode_ || (left_frame->width == right_frame->width && left_frame->height == right_frame->height);
 
-          if (use_10_bpc_) {
-            convert_to_packed_10_bpc(diff_planes_, diff_pitches_, right_planes_, pitches_right, roi);
+      if (start_right < band_end && can_update_right) {
+        const SDL_Rect tex_band_right = {right_x_offset + start_right, right_y_offset, band_end - start_right, right_frame->height};
+        const SDL_Rect roi = {start_right, 0, band_end - start_right, right_frame->height};
+
+        // the difference is uploaded once the worker has prepared it; until then, the texture keeps
+        // its previous content for these columns
+        bool has_uploaded_right = true;
+
+        if (subtraction_mode_) {
+          DifferenceBuffer& difference = difference_buffers_[difference_reading_index_];
 
-            update_texture(&tex_render_quad_right, right_planes_[0] + start_right, pitches_right[0], "right update (10 bpc, subtraction mode)");
+          if (difference.key != right_content_key) {
+            submit_difference(left_frame, right_frame, right_content_key);
+            has_uploaded_right = false;
+          } else if (use_10_bpc_) {
+            update_texture_packed_10_bpc(&tex_band_right, {difference.data.data(), nullptr, nullptr}, {difference_pitch_, 0, 0}, roi, "right update (10 bpc, subtraction mode)");
           } else {
-            update_texture(&tex_render_quad_right, diff_planes_[0] + start_right * 3, diff_pitches_[0], "right update (subtraction mode)");
+            update_texture(&tex_band_right, difference.data.data() + start_right * 3, difference_pitch_, "right update (subtraction mode)");
           }
         } else {
-          if (use_10_bpc_) {
-            convert_to_packed_10_bpc(planes_right, pitches_right, right_planes_, pitches_right, roi);
-
-            update_texture(&tex_render_quad_right, right_planes_[0] + start_right, pitches_right[0], "right update (10 bpc, video mode)");
+          if (ffmpeg::is_packed_10_bpc_rgb(right_frame->format)) {
+            update_texture(&tex_band_right, planes_right[0] + start_right * 4, pitches_right[0], "right update (packed 10 bpc, video mode)");
+          } else if (use_10_bpc_) {
+            update_texture_packed_10_bpc(&tex_band_right, planes_right, pitches_right, roi, "right update (10 bpc, video mode)");
           } else {
-            update_texture(&tex_render_quad_right, planes_right[0] + start_right * 3, pitches_right[0], "right update (video mode)");
+            update_texture(&tex_band_right, planes_right[0] + start_right * 3, pitches_right[0], "right update (video mode)");
+          }
+        }
+
+        if (has_uploaded_right) {
+          video_texture_state_.right_valid_from = start_right;
+
+          if (mode_ == Mode::Split) {
+            video_texture_state_.left_valid_until = std::min(video_texture_state_.left_valid_until, start_right);
           }
         }
       }
 
-      check_sdl(SDL_RenderCopyF(renderer_, get_video_texture(), &tex_render_quad_right, &screen_render_quad_right) == 0, "right video texture render copy");
+      check_sdl(get_video_texture()->render_copy(tex_render_quad_right, screen_render_quad_right), "right video texture render copy");
     }
   }
 
   const int mouse_drawable_x = std::round(video_texel_clamped_mouse_x * drawable_to_window_width_factor_);
-  const int mouse_drawable_y = std::round(static_cast<float>(mouse_y_) * drawable_to_window_height_factor_);
 
   // zoomed area
   const int dst_zoomed_size = static_cast<int>(std::round(std::min(drawable_width_, drawable_height_) * 0.5F)) & -2;  // size must be an even number of pixels
   const int dst_half_zoomed_size = dst_zoomed_size / 2;
 
   if (zoom_left_ || zoom_right_) {
-    const int src_zoomed_size = 64;
-    const int src_half_zoomed_size = src_zoomed_size / 2;
+    static constexpr float SRC_ZOOMED_DRAWABLE_SIZE = 64.0F;
 
-    SDL_Rect src_zoomed_area = {clamp_range(mouse_drawable_x - src_half_zoomed_size, 0, drawable_width_ - src_zoomed_size - 1), clamp_range(mouse_drawable_y - src_half_zoomed_size, 0, drawable_height_ - src_zoomed_size - 1),
-                                src_zoomed_size, src_zoomed_size};
+    // the (even) number of video pixels spanning as many drawable pixels as the loupe magnifies
+    const float drawable_pixels_per_video_pixel = global_zoom_factor_ * drawable_to_window_width_factor_ / video_to_window_width_factor_;
+    const int loupe_size = clamp_range(static_cast<int>(std::lround(SRC_ZOOMED_DRAWABLE_SIZE / drawable_pixels_per_video_pixel)), 4, 512) & -2;
 
-    SDL_Surface* render_surface = SDL_CreateRGBSurface(0, src_zoomed_size, src_zoomed_size, 32, 0, 0, 0, 0);
-    SDL_RenderReadPixels(renderer_, &src_zoomed_area, render_surface->format->format, render_surface->pixels, render_surface->pitch);
-    SDL_Texture* render_texture = SDL_CreateTextureFromSurface(renderer_, render_surface);
+    // centered on the split line in split mode, like the slider drawn through the loupe
+    const int center_x = (mode_ == Mode::Split) ? split_x : mouse_video_x;
+
+    update_loupe(left_frame, right_frame, center_x, mouse_video_y, split_x, loupe_size);
 
     if (zoom_left_) {
       const SDL_Rect dst_zoomed_area = {0, drawable_height_ - dst_zoomed_size, dst_zoomed_size, dst_zoomed_size};
-      SDL_RenderCopy(renderer_, render_texture, nullptr, &dst_zoomed_area);
+      SDL_RenderCopy(renderer_, loupe_texture_, nullptr, &dst_zoomed_area);
     }
     if (zoom_right_) {
       const SDL_Rect dst_zoomed_area = {drawable_width_ - dst_zoomed_size, drawable_height_ - dst_zoomed_size, dst_zoomed_size, dst_zoomed_size};
-      SDL_RenderCopy(renderer_, render_texture, nullptr, &dst_zoomed_area);
+      SDL_RenderCopy(renderer_, loupe_texture_, nullptr, &dst_zoomed_area);
     }
-
-    SDL_DestroyTexture(render_texture);
-    SDL_FreeSurface(render_surface);
   }
 
   timer_based_update_performed_ = false;
 
   SDL_Rect fill_rect;
-  SDL_Rect text_rect;
-  SDL_Surface* text_surface;
 
   if (show_hud_) {
     static constexpr int HUD_SCANLINE_GAP = 2;
@@ -2522,14 +3033,10 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
       // file name and current position of left video
       const std::string left_picture_type(1, av_get_picture_type_char(left_frame->pict_type));
       const std::string left_pos_str = format_position(left_position, true) + " " + left_picture_type + format_position_difference(left_position, right_position);
-      text_surface = TTF_RenderText_Blended(small_font_, left_pos_str.c_str(), POSITION_COLOR);
-      SDL_Texture* left_position_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-      const int left_position_text_width = text_surface->w;
-      const int left_position_text_height = text_surface->h;
-      SDL_FreeSurface(text_surface);
+      const int left_position_text_height = small_glyph_atlas_->get_height();
 
       if (mode_ == Mode::VStack) {
-        render_text(line1_y_, line1_y_, left_position_text_texture, left_position_text_width, left_position_text_height, border_extension_, true);
+        render_atlas_text(line1_y_, line1_y_, left_pos_str, POSITION_COLOR, true);
         const int left_file_row_y = line1_y_ + left_position_text_height + double_border_extension_ + HUD_SCANLINE_GAP;
         render_text(line1_y_, left_file_row_y, side_ui_[displayed_left_side_.as_simple_index()].text_texture, side_ui_[displayed_left_side_.as_simple_index()].text_width, side_ui_[displayed_left_side_.as_simple_index()].text_height,
                     border_extension_, true);
@@ -2537,20 +3044,14 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
         render_text(line1_y_, line1_y_, side_ui_[displayed_left_side_.as_simple_index()].text_texture, side_ui_[displayed_left_side_.as_simple_index()].text_width, side_ui_[displayed_left_side_.as_simple_index()].text_height,
                     border_extension_, true);
         const int left_position_row_y = line1_y_ + side_ui_[displayed_left_side_.as_simple_index()].text_height + double_border_extension_ + HUD_SCANLINE_GAP;
-        render_text(line1_y_, left_position_row_y, left_position_text_texture, left_position_text_width, left_position_text_height, border_extension_, true);
+        render_atlas_text(line1_y_, left_position_row_y, left_pos_str, POSITION_COLOR, true);
       }
-
-      SDL_DestroyTexture(left_position_text_texture);
     }
     if (show_right_) {
       // file name and current position of right video
       const std::string right_picture_type(1, av_get_picture_type_char(right_frame->pict_type));
       const std::string right_pos_str = format_position(right_position, true) + " " + right_picture_type + format_position_difference(right_position, left_position);
-      text_surface = TTF_RenderText_Blended(small_font_, right_pos_str.c_str(), POSITION_COLOR);
-      SDL_Texture* right_position_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-      int right_position_text_width = text_surface->w;
-      int right_position_text_height = text_surface->h;
-      SDL_FreeSurface(text_surface);
+      const int right_position_text_width = small_glyph_atlas_->get_text_width(right_pos_str);
 
       int text1_x;
       int text1_y;
@@ -2571,26 +3072,18 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
 
       render_text(text1_x, text1_y, side_ui_[displayed_right_side_.as_simple_index()].text_texture, side_ui_[displayed_right_side_.as_simple_index()].text_width, side_ui_[displayed_right_side_.as_simple_index()].text_height,
                   border_extension_, false);
-      render_text(text2_x, text2_y, right_position_text_texture, right_position_text_width, right_position_text_height, border_extension_, false);
-
-      SDL_DestroyTexture(right_position_text_texture);
+      render_atlas_text(text2_x, text2_y, right_pos_str, POSITION_COLOR, false);
     }
     if (mouse_is_inside_window_ && duration_ > 0) {
       // target seek position
       float target_position = static_cast<float>(mouse_x_) / static_cast<float>(window_width_) * duration_;
 
       const std::string target_pos_str = format_position(target_position, true);
-      text_surface = TTF_RenderText_Blended(small_font_, target_pos_str.c_str(), TARGET_COLOR);
-      SDL_Texture* target_position_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-      const int target_position_text_width = text_surface->w;
-      const int target_position_text_height = text_surface->h;
-      SDL_FreeSurface(text_surface);
+      const int target_position_text_width = small_glyph_atlas_->get_text_width(target_pos_str);
+      const int target_position_text_height = small_glyph_atlas_->get_height();
 
       SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA * 2);
-      render_text(drawable_width_ - line1_y_ - target_position_text_width, drawable_height_ - line1_y_ - target_position_text_height, target_position_text_texture, target_position_text_width, target_position_text_height, border_extension_,
-                  false);
-
-      SDL_DestroyTexture(target_position_text_texture);
+      render_atlas_text(drawable_width_ - line1_y_ - target_position_text_width, drawable_height_ - line1_y_ - target_position_text_height, target_pos_str, TARGET_COLOR, false);
     }
 
     // zoom factor
@@ -2610,19 +3103,15 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
       zoom_factor_str = string_sprintf("x%1.0f", global_zoom_factor_);
     }
 
-    text_surface = TTF_RenderText_Blended(small_font_, zoom_factor_str.c_str(), ZOOM_COLOR);
-    SDL_Texture* zoom_position_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-    const int zoom_position_text_width = text_surface->w;
-    const int zoom_position_text_height = text_surface->h;
-    SDL_FreeSurface(text_surface);
+    const int zoom_position_text_width = small_glyph_atlas_->get_text_width(zoom_factor_str);
+    const int zoom_position_text_height = small_glyph_atlas_->get_height();
 
     SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA * 2);
 
     int text_x = (mode_ == Mode::VStack) ? drawable_width_ - line1_y_ - zoom_position_text_width : line1_y_;
     int text_y = (mode_ == Mode::VStack) ? line1_y_ : drawable_height_ - line1_y_ - zoom_position_text_height;
 
-    render_text(text_x, text_y, zoom_position_text_texture, zoom_position_text_width, zoom_position_text_height, border_extension_, false);
-    SDL_DestroyTexture(zoom_position_text_texture);
+    render_atlas_text(text_x, text_y, zoom_factor_str, ZOOM_COLOR, false);
 
     // playback speed
     std::string playback_speed_str;
@@ -2654,24 +3143,16 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
     }
 
     const std::string united_playback_speed_str = string_sprintf("@%s%s", playback_speed_str.c_str(), playback_speed_factor_str.c_str());
-    text_surface = TTF_RenderText_Blended(small_font_, united_playback_speed_str.c_str(), PLAYBACK_SPEED_COLOR);
-    SDL_Texture* playack_speed_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-    const int playack_speed_text_width = text_surface->w;
-    const int playack_speed_text_height = text_surface->h;
-    SDL_FreeSurface(text_surface);
+    const int playack_speed_text_width = small_glyph_atlas_->get_text_width(united_playback_speed_str);
 
     text_x = drawable_width_ / 2 - playack_speed_text_width / 2 - border_extension_;
     text_y = drawable_height_ - line1_y_ - zoom_position_text_height;
 
-    render_text(text_x, text_y, playack_speed_text_texture, playack_speed_text_width, playack_speed_text_height, border_extension_, false);
-    SDL_DestroyTexture(playack_speed_text_texture);
+    render_atlas_text(text_x, text_y, united_playback_speed_str, PLAYBACK_SPEED_COLOR, false);
 
     // current frame / number of frames in history buffer
-    text_surface = TTF_RenderText_Blended(small_font_, current_total_browsable.c_str(), BUFFER_COLOR);
-    SDL_Texture* current_total_browsable_text_texture = SDL_CreateTextureFromSurface(renderer_, text_surface);
-    const int current_total_browsable_text_width = text_surface->w;
-    const int current_total_browsable_text_height = text_surface->h;
-    SDL_FreeSurface(text_surface);
+    const int current_total_browsable_text_width = small_glyph_atlas_->get_text_width(current_total_browsable);
+    const int current_total_browsable_text_height = small_glyph_atlas_->get_height();
 
     text_y = (mode_ == Mode::VStack) ? line1_y_ : line2_y_;
 
@@ -2702,42 +3183,40 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
     SDL_SetRenderDrawColor(renderer_, label_color.r, label_color.g, label_color.b, label_alpha);
     SDL_RenderFillRect(renderer_, &fill_rect);
 
-    text_rect = {drawable_width_ / 2 - current_total_browsable_text_width / 2, text_y, current_total_browsable_text_width, current_total_browsable_text_height};
-    SDL_RenderCopy(renderer_, current_total_browsable_text_texture, nullptr, &text_rect);
-    SDL_DestroyTexture(current_total_browsable_text_texture);
+    small_glyph_atlas_->queue_text(drawable_width_ / 2 - current_total_browsable_text_width / 2, text_y, current_total_browsable, BUFFER_COLOR);
+
+    if (is_live_metrics_on()) {
+      render_live_metrics(text_y + current_total_browsable_text_height + double_border_extension_ + HUD_SCANLINE_GAP);
+    }
 
     // display progress as dot lines
     render_progress_dots(left_position, left_progress, true);
     render_progress_dots(right_position, right_progress, false);
+
+    // all of the above text in one batch; it overlaps none of the backgrounds
+    small_glyph_atlas_->flush();
   }
 
   // render (optional) message
   if (!pending_message_.empty()) {
     message_shown_at_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
-    text_surface = TTF_RenderText_Blended(big_font_, pending_message_.c_str(), TEXT_COLOR);
-
-    if (message_texture_ != nullptr) {
-      SDL_DestroyTexture(message_texture_);
-    }
-    message_texture_ = SDL_CreateTextureFromSurface(renderer_, text_surface);
-
-    message_width_ = text_surface->w;
-    message_height_ = text_surface->h;
-    SDL_FreeSurface(text_surface);
+    message_ = pending_message_;
 
     pending_message_.clear();
   }
-  if (message_texture_ != nullptr) {
+  if (!message_.empty()) {
     std::chrono::milliseconds now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
     const float keep_alpha = std::max(sqrtf(1.0F - (now - message_shown_at_).count() / 1000.0F / 4.0F), 0.0F);
 
+    const int message_width = big_glyph_atlas_->get_text_width(message_);
+    const int message_height = big_glyph_atlas_->get_height();
+
     SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA * keep_alpha);
-    fill_rect = {drawable_width_ / 2 - message_width_ / 2 - 2, drawable_height_ / 2 - message_height_ / 2 - 2, message_width_ + 4, message_height_ + 4};
+    fill_rect = {drawable_width_ / 2 - message_width / 2 - 2, drawable_height_ / 2 - message_height / 2 - 2, message_width + 4, message_height + 4};
     SDL_RenderFillRect(renderer_, &fill_rect);
 
-    SDL_SetTextureAlphaMod(message_texture_, 255 * keep_alpha);
-    text_rect = {drawable_width_ / 2 - message_width_ / 2, drawable_height_ / 2 - message_height_ / 2, message_width_, message_height_};
-    SDL_RenderCopy(renderer_, message_texture_, nullptr, &text_rect);
+    big_glyph_atlas_->queue_text(drawable_width_ / 2 - message_width / 2, drawable_height_ / 2 - message_height / 2, message_, TEXT_COLOR, 255 * keep_alpha);
+    big_glyph_atlas_->flush();
 
     timer_based_update_performed_ = timer_based_update_performed_ || (keep_alpha > 0.0F);
   }
@@ -2765,19 +3244,20 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
     render_help();
   }
 
-  if (save_image_frames_) {
-    save_image_frames(left_frame, right_frame);
+  if (save_image_frames_ && has_full_resolution_frames) {
+    save_image_frames(action_left_frame, action_right_frame);
     save_image_frames_ = false;
   }
 
-  if (save_selected_area_) {
-    possibly_save_selected_area(left_frame, right_frame);
+  if (save_selected_area_ && has_full_resolution_frames) {
+    possibly_save_selected_area(action_left_frame, action_right_frame);
   }
   if (crop_mode_) {
     possibly_apply_crop();
   }
 
   SDL_RenderPresent(renderer_);
+  record_present();
 
   input_received_ = false;
   previous_left_frame_pts_ = left_frame->pts;
@@ -2788,6 +3268,36 @@ bool Display::possibly_refresh(const AVFrame* left_frame, const AVFrame* right_f
   return true;
 }
 
+void Display::record_present() {
+  const auto now = std::chrono::steady_clock::now();
+
+  if (has_unpresented_input_) {
+    present_stats_.input_latency_samples++;
+    present_stats_.input_latency_ms_sum += static_cast<double>(SDL_GetTicks() - unpresented_input_ticks_);
+
+    has_unpresented_input_ = false;
+  }
+
+  // pacing is only of interest between consecutive presents during playback
+  if (play_ && has_last_present_time_) {
+    const double interval_ms = std::chrono::duration<double, std::milli>(now - last_present_time_).count();
+
+    present_stats_.interval_samples++;
+    present_stats_.interval_ms_sum += interval_ms;
+    present_stats_.interval_ms_sum_of_squares += interval_ms * interval_ms;
+  }
+
+  last_present_time_ = now;
+  has_last_present_time_ = play_;
+}
+
+PresentStats Display::consume_present_stats() {
+  const PresentStats present_stats = present_stats_;
+  present_stats_ = PresentStats{};
+
+  return present_stats;
+}
+
 void Display::set_pending_message(const std::string& message) {
   pending_message_ = message;
 }
@@ -2867,6 +3377,308 @@ SDL_FRect Display::video_to_zoom_space(const SDL_Rect& video_rect, const Display
                     std::min(float(video_rect.h) * zoom_rect.zoom_factor, zoom_rect.size.y())});
 };
 
+SDL_Rect Display::get_visible_texture_rect(const Display::ZoomRect& zoom_rect, const AVFrame* left_frame, const AVFrame* right_frame) const {
+  const Vector2D p0 = window_to_video_position(0, 0, zoom_rect, true);
+  const Vector2D p1 = window_to_video_position(window_width_, window_height_, zoom_rect, false);
+
+  // frames converted at a reduced preview resolution fill the top-left of their texture region,
+  // whereas the mosaic canvas always has the size of the video area
+  const bool is_mosaic = mode_ == Mode::Mosaic;
+  const float left_scale_x = is_mosaic ? 1.0F : static_cast<float>(left_frame->width) / static_cast<float>(video_width_);
+  const float left_scale_y = is_mosaic ? 1.0F : static_cast<float>(left_frame->height) / static_cast<float>(video_height_);
+  const float right_scale_x = is_mosaic ? 1.0F : static_cast<float>(right_frame->width) / static_cast<float>(video_width_);
+  const float right_scale_y = is_mosaic ? 1.0F : static_cast<float>(right_frame->height) / static_cast<float>(video_height_);
+
+  // maps a layout position to the texture along one axis, where the right region either follows the
+  // left one (when stacked along that axis) or shares its texels
+  auto to_texture = [](const float position, const int region_size, const bool is_stacked, const float left_scale, const float right_scale, const bool is_end) {
+    if (is_stacked) {
+      return position < static_cast<float>(region_size) ? position * left_scale : static_cast<float>(region_size) + (position - static_cast<float>(region_size)) * right_scale;
+    }
+
+    return position * (is_end ? std::max(left_scale, right_scale) : std::min(left_scale, right_scale));
+  };
+
+  const bool is_hstack = mode_ == Mode::HStack;
+  const bool is_vstack = mode_ == Mode::VStack;
+  const int texture_width = is_hstack ? video_width_ * 2 : video_width_;
+  const int texture_height = is_vstack ? video_height_ * 2 : video_height_;
+
+  const int x0 = clamp_range(static_cast<int>(std::floor(to_texture(std::min(p0.x(), p1.x()), video_width_, is_hstack, left_scale_x, right_scale_x, false))) - 1, 0, texture_width);
+  const int y0 = clamp_range(static_cast<int>(std::floor(to_texture(std::min(p0.y(), p1.y()), video_height_, is_vstack, left_scale_y, right_scale_y, false))) - 1, 0, texture_height);
+  const int x1 = clamp_range(static_cast<int>(std::ceil(to_texture(std::max(p0.x(), p1.x()), video_width_, is_hstack, left_scale_x, right_scale_x, true))) + 1, 0, texture_width);
+  const int y1 = clamp_range(static_cast<int>(std::ceil(to_texture(std::max(p0.y(), p1.y()), video_height_, is_vstack, left_scale_y, right_scale_y, true))) + 1, 0, texture_height);
+
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
+std::vector<SDL_Rect> Display::get_mosaic_tile_rects(const size_t tile_count) const {
+  int columns;
+  int rows;
+  std::tie(columns, rows) = get_mosaic_grid(tile_count);
+
+  // tiles keep the aspect ratio of the video area and are centered in their grid cells
+  const int cell_width = video_width_ / columns;
+  const int cell_height = video_height_ / rows;
+  const float tile_scale = std::min(static_cast<float>(cell_width - MOSAIC_TILE_GAP) / static_cast<float>(video_width_), static_cast<float>(cell_height - MOSAIC_TILE_GAP) / static_cast<float>(video_height_));
+  const int tile_width = std::max(1, static_cast<int>(std::lround(static_cast<float>(video_width_) * tile_scale)));
+  const int tile_height = std::max(1, static_cast<int>(std::lround(static_cast<float>(video_height_) * tile_scale)));
+
+  std::vector<SDL_Rect> tile_rects;
+
+  for (size_t i = 0; i < tile_count; i++) {
+    const int column = static_cast<int>(i) % columns;
+    const int row = static_cast<int>(i) / columns;
+
+    tile_rects.push_back({column * cell_width + (cell_width - tile_width) / 2, row * cell_height + (cell_height - tile_height) / 2, tile_width, tile_height});
+  }
+
+  return tile_rects;
+}
+
+void Display::print_mosaic_pixel(const AVFrame* left_frame, const int canvas_x, const int canvas_y) {
+  std::vector<std::pair<std::string, const AVFrame*>> tiles{{"Left", left_frame}};
+
+  for (const auto& right_frame : mosaic_right_frames_) {
+    tiles.emplace_back(string_sprintf("Right <%zu>", right_frame.first + 1), right_frame.second);
+  }
+
+  const std::vector<SDL_Rect> tile_rects = get_mosaic_tile_rects(tiles.size());
+
+  for (size_t i = 0; i < tiles.size(); i++) {
+    const SDL_Rect& tile_rect = tile_rects[i];
+    const AVFrame* frame = tiles[i].second;
+
+    if (frame == nullptr || canvas_x < tile_rect.x || canvas_x >= tile_rect.x + tile_rect.w || canvas_y < tile_rect.y || canvas_y >= tile_rect.y + tile_rect.h) {
+      continue;
+    }
+
+    // the pixel the canvas shows there, as composed by compose_mosaic()
+    const int frame_x = (canvas_x - tile_rect.x) * frame->width / tile_rect.w;
+    const int frame_y = (canvas_y - tile_rect.y) * frame->height / tile_rect.h;
+
+    AVFramePtr expanded_frame(nullptr, frame_deleter);
+
+    if (ffmpeg::is_packed_10_bpc_rgb(frame->format)) {
+      expanded_frame.reset(expand_packed_10_bpc_frame(frame).release());
+    }
+
+    const AVFrame* pixel_frame = expanded_frame != nullptr ? expanded_frame.get() : frame;
+    const int original_width = get_metadata_int_value(frame, "original_width", frame->width);
+    const int original_height = get_metadata_int_value(frame, "original_height", frame->height);
+
+    std::cout << tiles[i].first << ": " << string_sprintf("[%4d,%4d]", frame_x * original_width / frame->width, frame_y * original_height / frame->height);
+    std::cout << ", " << get_and_format_rgb_yuv_pixel(pixel_frame->data[0], pixel_frame->linesize[0], pixel_frame, frame_x, frame_y);
+    std::cout << std::endl;
+  }
+}
+
+void Display::render_mosaic(const AVFrame* left_frame, const ZoomRect& zoom_rect) {
+  if (video_texture_state_.texture != get_video_texture()) {
+    video_texture_state_ = VideoTextureState{};
+    video_texture_state_.texture = get_video_texture();
+  }
+
+  std::vector<const AVFrame*> frames{left_frame};
+
+  for (const auto& right_frame : mosaic_right_frames_) {
+    frames.push_back(right_frame.second);
+  }
+
+  const std::string canvas_key = "mosaic|" + get_texture_content_key(left_frame) + mosaic_right_frames_key_;
+  const std::vector<SDL_Rect> tile_rects = get_mosaic_tile_rects(frames.size());
+
+  const SDL_Rect canvas_rect = {0, 0, video_width_, video_height_};
+
+  if (video_texture_state_.left_key != canvas_key) {
+    const bool is_packed_10_bpc = ffmpeg::is_packed_10_bpc_rgb(left_frame->format);
+    const int bytes_per_pixel = get_packed_rgb_bytes_per_pixel(left_frame->format, use_10_bpc_);
+    const size_t canvas_pitch = static_cast<size_t>(video_width_) * bytes_per_pixel;
+
+    compose_mosaic(frames, tile_rects, bytes_per_pixel);
+
+    if (is_packed_10_bpc || !use_10_bpc_) {
+      update_texture(&canvas_rect, mosaic_canvas_.data(), canvas_pitch, "mosaic update");
+    } else {
+      update_texture_packed_10_bpc(&canvas_rect, {mosaic_canvas_.data(), nullptr, nullptr}, {canvas_pitch, 0, 0}, canvas_rect, "mosaic update (10 bpc)");
+    }
+
+    // the canvas covers the whole texture; the other modes upload their frames anew
+    video_texture_state_.left_key = canvas_key;
+    video_texture_state_.left_valid_until = video_width_;
+    video_texture_state_.right_key.clear();
+    video_texture_state_.right_valid_from = video_width_;
+  }
+
+  const SDL_FRect screen_render_quad = video_rect_to_drawable_transform(video_to_zoom_space(canvas_rect, zoom_rect));
+  check_sdl(get_video_texture()->render_copy(canvas_rect, screen_render_quad), "mosaic texture render copy");
+
+  // number the right tiles like the right file labels; the left one and the active right are named by the HUD
+  if (show_hud_) {
+    SDL_SetRenderDrawColor(renderer_, 0, 0, 0, BACKGROUND_ALPHA);
+    SDL_SetRenderDrawBlendMode(renderer_, SDL_BLENDMODE_BLEND);
+
+    for (size_t i = 1; i < frames.size(); i++) {
+      const size_t right_index = mosaic_right_frames_[i - 1].first;
+      const std::string tile_label = string_sprintf("<%zu>", right_index + 1);
+      const SDL_FRect tile_quad = video_rect_to_drawable_transform(video_to_zoom_space(tile_rects[i], zoom_rect));
+
+      const int label_x = static_cast<int>(tile_quad.x + tile_quad.w / 2.0F) - small_glyph_atlas_->get_text_width(tile_label) / 2;
+      const int label_y = static_cast<int>(tile_quad.y + tile_quad.h / 2.0F) - small_glyph_atlas_->get_height() / 2;
+
+      render_atlas_text(label_x, label_y, tile_label, right_index == active_right_index_ ? POSITION_COLOR : TEXT_COLOR, true);
+    }
+
+    // drawn now, so that the loupe and the other overlays go on top
+    small_glyph_atlas_->flush();
+  }
+}
+
+void Display::update_loupe(const AVFrame* left_frame, const AVFrame* right_frame, const int center_x, const int center_y, const int split_x, const int loupe_size) {
+  const DifferenceBuffer& difference = difference_buffers_[difference_reading_index_];
+  const bool has_difference = subtraction_mode_ && difference.key == video_texture_state_.right_key;
+
+  // the texture keys identify the frames (or difference or mosaic) currently shown
+  const std::string loupe_key = string_sprintf("%d,%d,%d,%d,%d,%d%d%d|%s|%s", center_x, center_y, loupe_size, split_x, static_cast<int>(mode_), show_left_, show_right_, has_difference, video_texture_state_.left_key.c_str(),
+                                               video_texture_state_.right_key.c_str());
+
+  if (loupe_texture_ != nullptr && loupe_texture_size_ == loupe_size && loupe_key == loupe_key_) {
+    return;
+  }
+
+  if (loupe_texture_size_ != loupe_size) {
+    SDL_DestroyTexture(loupe_texture_);
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    loupe_texture_ = check_sdl(SDL_CreateTexture(renderer_, use_10_bpc_ ? SDL_PIXELFORMAT_ARGB2101010 : SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING, loupe_size, loupe_size), "loupe texture");
+    loupe_texture_size_ = loupe_size;
+  }
+
+  const int left_bytes_per_pixel = get_packed_rgb_bytes_per_pixel(left_frame->format, use_10_bpc_);
+  const int right_bytes_per_pixel = get_packed_rgb_bytes_per_pixel(right_frame->format, use_10_bpc_);
+
+  const LoupeSource left_source{left_frame->data[0], static_cast<size_t>(left_frame->linesize[0]), left_frame->width, left_frame->height, left_bytes_per_pixel};
+  const LoupeSource right_source = has_difference ? LoupeSource{difference.data.data(), difference_pitch_, right_frame->width, right_frame->height, use_10_bpc_ ? 6 : 3}
+                                                  : LoupeSource{right_frame->data[0], static_cast<size_t>(right_frame->linesize[0]), right_frame->width, right_frame->height, right_bytes_per_pixel};
+  const LoupeSource canvas_source{mosaic_canvas_.data(), static_cast<size_t>(video_width_) * left_bytes_per_pixel, video_width_, video_height_, left_bytes_per_pixel};
+
+  // maps a video (layout) position to the source shown there and the position within it
+  auto find_source = [&](int& x, int& y) -> const LoupeSource* {
+    if (mode_ == Mode::Mosaic) {
+      return mosaic_canvas_.empty() ? nullptr : &canvas_source;
+    }
+
+    bool is_right;
+
+    switch (mode_) {
+      case Mode::HStack:
+        is_right = x >= video_width_;
+        x -= is_right ? video_width_ : 0;
+        break;
+      case Mode::VStack:
+        is_right = y >= video_height_;
+        y -= is_right ? video_height_ : 0;
+        break;
+      default:
+        is_right = x >= split_x;
+        break;
+    }
+
+    // in subtraction mode, the difference is blank until the worker has prepared it
+    if (is_right ? (!show_right_ || (subtraction_mode_ && !has_difference)) : !show_left_) {
+      return nullptr;
+    }
+
+    return is_right ? &right_source : &left_source;
+  };
+
+  const int output_bytes_per_pixel = use_10_bpc_ ? 4 : 3;
+
+  loupe_pixels_.assign(static_cast<size_t>(loupe_size) * loupe_size * output_bytes_per_pixel, 0);
+
+  for (int loupe_y = 0; loupe_y < loupe_size; loupe_y++) {
+    uint8_t* p_out = loupe_pixels_.data() + static_cast<size_t>(loupe_y) * loupe_size * output_bytes_per_pixel;
+
+    for (int loupe_x = 0; loupe_x < loupe_size; loupe_x++, p_out += output_bytes_per_pixel) {
+      int x = center_x - loupe_size / 2 + loupe_x;
+      int y = center_y - loupe_size / 2 + loupe_y;
+
+      const LoupeSource* source = find_source(x, y);
+
+      if (source == nullptr || x < 0 || x >= video_width_ || y < 0 || y >= video_height_) {
+        continue;
+      }
+
+      // frames converted at a reduced preview resolution cover the whole video area
+      const int source_x = x * source->width / video_width_;
+      const int source_y = y * source->height / video_height_;
+      const uint8_t* p_in = source->data + source->pitch * source_y + static_cast<size_t>(source_x) * source->bytes_per_pixel;
+
+      if (source->bytes_per_pixel == 6) {
+        const uint16_t* p_in_16 = reinterpret_cast<const uint16_t*>(p_in);
+        const uint32_t packed = (static_cast<uint32_t>(p_in_16[0] >> 6) << 20) | (static_cast<uint32_t>(p_in_16[1] >> 6) << 10) | static_cast<uint32_t>(p_in_16[2] >> 6);
+
+        memcpy(p_out, &packed, sizeof(packed));
+      } else {
+        memcpy(p_out, p_in, output_bytes_per_pixel);
+      }
+    }
+  }
+
+  check_sdl(SDL_UpdateTexture(loupe_texture_, nullptr, loupe_pixels_.data(), loupe_size * output_bytes_per_pixel) == 0, "loupe texture update");
+
+  loupe_key_ = loupe_key;
+}
+
+void Display::compose_mosaic(const std::vector<const AVFrame*>& frames, const std::vector<SDL_Rect>& tile_rects, const int bytes_per_pixel) {
+  const size_t canvas_pitch = static_cast<size_t>(video_width_) * bytes_per_pixel;
+  const int canvas_format = frames.front()->format;
+
+  mosaic_canvas_.resize(canvas_pitch * video_height_);
+
+  // nearest-neighbor source byte offset for each column of each tile; frames missing so far (or
+  // in another pixel format) leave their tiles blank
+  std::vector<std::vector<int>> source_offsets(frames.size());
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i] != nullptr && frames[i]->format == canvas_format) {
+      source_offsets[i].resize(tile_rects[i].w);
+
+      for (int x = 0; x < tile_rects[i].w; x++) {
+        source_offsets[i][x] = (x * frames[i]->width / tile_rects[i].w) * bytes_per_pixel;
+      }
+    }
+  }
+
+  row_workers_.run_dynamic(
+      video_height_,
+      [&](const int start_row, const int end_row) {
+        for (int y = start_row; y < end_row; y++) {
+          uint8_t* canvas_row = mosaic_canvas_.data() + canvas_pitch * y;
+
+          memset(canvas_row, 0, canvas_pitch);
+
+          for (size_t i = 0; i < frames.size(); i++) {
+            const SDL_Rect& tile_rect = tile_rects[i];
+
+            if (source_offsets[i].empty() || y < tile_rect.y || y >= tile_rect.y + tile_rect.h) {
+              continue;
+            }
+
+            const AVFrame* frame = frames[i];
+            const uint8_t* source_row = frame->data[0] + static_cast<size_t>(frame->linesize[0]) * ((y - tile_rect.y) * frame->height / tile_rect.h);
+            uint8_t* p_out = canvas_row + tile_rect.x * bytes_per_pixel;
+
+            for (const int source_offset : source_offsets[i]) {
+              memcpy(p_out, source_row + source_offset, bytes_per_pixel);
+              p_out += bytes_per_pixel;
+            }
+          }
+        }
+      },
+      suggest_block_rows_by_bytes(video_width_, video_height_, bytes_per_pixel, 1));
+}
+
 std::pair<SDL_Rect, SDL_Rect> Display::get_visible_rois_in_single_frame_coordinates() const {
   const auto zoom_rect = compute_zoom_rect();
 
@@ -2888,6 +3700,12 @@ std::pair<SDL_Rect, SDL_Rect> Display::get_visible_rois_in_single_frame_coordina
     return (hi > lo) ? std::make_pair(lo, hi) : std::make_pair(0, 0);
   };
 
+  // Mosaic: the canvas maps onto no single frame, so the whole left and active right frames are measured
+  if (mode_ == Mode::Mosaic) {
+    const SDL_Rect roi = {0, 0, video_width_, video_height_};
+    return {roi, roi};
+  }
+
   // Default: single-frame layout (split) => both sides share the same ROI.
   if (mode_ != Mode::HStack && mode_ != Mode::VStack) {
     const int x0 = clamp_x(lx0);
@@ -2999,10 +3817,12 @@ void Display::begin_input_frame() {
   seek_from_start_ = false;
   frame_buffer_offset_delta_ = 0;
   frame_navigation_delta_ = 0;
+  worst_frame_step_ = 0;
   shift_right_frames_ = 0;
   tick_playback_ = false;
   possibly_tick_playback_ = false;
   toggle_scope_window_requested_.fill(false);
+  toggle_metrics_timeline_requested_ = false;
 }
 
 void Display::mark_input_received() {
@@ -3013,6 +3833,11 @@ void Display::handle_event(const SDL_Event& event) {
   event_ = event;
   input_received_ = true;
 
+  if (!has_unpresented_input_) {
+    unpresented_input_ticks_ = event.common.timestamp;
+    has_unpresented_input_ = true;
+  }
+
   auto update_cursor = [&]() {
     SDL_Cursor* cursor;
 
@@ -3149,6 +3974,12 @@ void Display::handle_event(const SDL_Event& event) {
       };
 
       auto start_crop_mode_for_side = [&](const CropTargetSide side) {
+        // selections are made on the canvas, which maps onto no single frame
+        if (mode_ == Mode::Mosaic) {
+          notify_user("Cropping is not available in mosaic mode");
+          return;
+        }
+
         save_selected_area_ = false;
         crop_target_side_ = side;
         crop_mode_ = true;
@@ -3377,7 +4208,9 @@ void Display::handle_event(const SDL_Event& event) {
         }
         case SDLK_f:
           if (is_shift_down) {
-            if (!save_selected_area_) {
+            if (mode_ == Mode::Mosaic) {
+              notify_user("Saving a selected area is not available in mosaic mode");
+            } else if (!save_selected_area_) {
               reset_crop_mode();
               save_selected_area_ = true;
             } else {
@@ -3402,25 +4235,68 @@ void Display::handle_event(const SDL_Event& event) {
           break;
         case SDLK_m:
           if (is_shift_down) {
-            constexpr int kModeCount = 3;
+            constexpr int kModeCount = 4;
             const int delta = is_ctrl_down ? -1 : 1;
             mode_ = static_cast<Mode>((static_cast<int>(mode_) + delta + kModeCount) % kModeCount);
 
+            // an area selection in progress cannot be carried over onto the mosaic canvas
+            if (mode_ == Mode::Mosaic) {
+              reset_crop_mode();
+              save_selected_area_ = false;
+            }
+
             recreate_video_textures_for_current_mode();
             resize_window_for_mode_switch();
 
             const std::string mode_name = mode_to_string(mode_);
             notify_user(string_sprintf("Display mode set to '%s'", to_upper_case(mode_name).c_str()));
+          } else if (is_ctrl_down) {
+            print_windowed_vmaf_ = true;
+          } else if (is_alt_down) {
+            // cycle live metrics: off -> PSNR/SSIM -> PSNR/SSIM/VMAF -> off
+            if (live_metrics_ == nullptr) {
+              live_metrics_ = std::make_unique<LiveMetrics>(LIVE_METRICS_HISTORY_SIZE);
+            }
+
+            const LiveMetrics::Mode mode = live_metrics_->get_mode();
+
+            live_metrics_->set_mode(mode == LiveMetrics::Mode::Off ? LiveMetrics::Mode::PsnrSsim : (mode == LiveMetrics::Mode::PsnrSsim ? LiveMetrics::Mode::PsnrSsimVmaf : LiveMetrics::Mode::Off));
+            live_metrics_history_.clear();
+            live_metrics_dropped_count_ = 0;
+
+            notify_user(string_sprintf("Live metrics set to '%s'", !is_live_metrics_on() ? "OFF" : (live_metrics_->get_mode() == LiveMetrics::Mode::PsnrSsimVmaf ? "PSNR/SSIM/VMAF" : "PSNR/SSIM")));
           } else {
             print_image_similarity_metrics_ = true;
           }
           break;
+        case SDLK_F4:
+          toggle_metrics_timeline_requested_ = true;
+          break;
+        case SDLK_F5:
+          toggle_scope_window_requested_[ScopeWindow::index(ScopeWindow::Type::Difference)] = true;
+          break;
+        case SDLK_LEFTBRACKET:
+          worst_frame_step_--;
+          break;
+        case SDLK_RIGHTBRACKET:
+          worst_frame_step_++;
+          break;
         case SDLK_4:
         case SDLK_KP_4:
+          if (is_shift_down) {
+            // Fallback for layouts where F-keys are inconvenient
+            toggle_metrics_timeline_requested_ = true;
+            break;
+          }
           update_zoom_factor_and_move_offset(std::min(video_to_window_width_factor_ / drawable_to_window_width_factor_, video_to_window_height_factor_ / drawable_to_window_height_factor_));
           break;
         case SDLK_5:
         case SDLK_KP_5:
+          if (is_shift_down) {
+            // Fallback for layouts where F-keys are inconvenient
+            toggle_scope_window_requested_[ScopeWindow::index(ScopeWindow::Type::Difference)] = true;
+            break;
+          }
           update_zoom_factor_and_move_offset(0.5F);
           break;
         case SDLK_6:
@@ -3596,6 +4472,47 @@ bool Display::get_play() const {
   return play_;
 }
 
+int Display::get_refresh_rate() const {
+  SDL_DisplayMode display_mode;
+
+  if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window_), &display_mode) != 0) {
+    return 0;
+  }
+
+  return display_mode.refresh_rate;
+}
+
+int Display::get_preview_scale_divisor() const {
+  // drawable pixels per video pixel, zoom included
+  const float width_scale = global_zoom_factor_ * drawable_to_window_width_factor_ / video_to_window_width_factor_;
+  const float height_scale = global_zoom_factor_ * drawable_to_window_height_factor_ / video_to_window_height_factor_;
+  float scale = std::max(width_scale, height_scale);
+
+  // mosaic tiles take a fraction of the video area each
+  if (mode_ == Mode::Mosaic) {
+    const auto grid = get_mosaic_grid(1 + mosaic_right_frames_.size());
+
+    scale /= static_cast<float>(std::max(grid.first, grid.second));
+  }
+
+  // halve while the preview still has at least one pixel per drawable pixel
+  int divisor = 1;
+
+  while (divisor < MAX_PREVIEW_SCALE_DIVISOR && scale * static_cast<float>(divisor * 2) <= 1.0F) {
+    divisor *= 2;
+  }
+
+  return divisor;
+}
+
+bool Display::get_full_resolution_requested() const {
+  return save_image_frames_ || save_selected_area_ || print_mouse_position_and_color_ || print_image_similarity_metrics_ || zoom_left_ || zoom_right_;
+}
+
+bool Display::is_preview_frame(const AVFrame* frame) const {
+  return frame->width != video_width_ || frame->height != video_height_;
+}
+
 Display::Loop Display::get_buffer_play_loop_mode() const {
   return buffer_play_loop_mode_;
 }
@@ -3642,6 +4559,10 @@ int Display::get_frame_navigation_delta() const {
   return frame_navigation_delta_;
 }
 
+int Display::get_worst_frame_step() const {
+  return worst_frame_step_;
+}
+
 int Display::get_shift_right_frames() const {
   return shift_right_frames_;
 }
@@ -3662,16 +4583,33 @@ bool Display::get_show_fps() const {
   return show_fps_;
 }
 
+bool Display::get_print_windowed_vmaf() const {
+  return print_windowed_vmaf_;
+}
+
 bool Display::get_toggle_scope_window_requested(const ScopeWindow::Type type) const {
   return toggle_scope_window_requested_[ScopeWindow::index(type)];
 }
 
+bool Display::get_toggle_metrics_timeline_requested() const {
+  return toggle_metrics_timeline_requested_;
+}
+
+void Display::seek_to(const float position) {
+  seek_relative_ = position / static_cast<float>(duration_);
+  seek_from_start_ = true;
+}
+
 PendingCropRequest Display::get_and_clear_pending_crop_request() {
   const PendingCropRequest request = pending_crop_request_;
   pending_crop_request_ = PendingCropRequest{};
   return request;
 }
 
+void Display::set_png_compression_level(const int level) {
+  png_compression_level_ = level;
+}
+
 void Display::set_num_right_videos(const size_t num_right_videos) {
   num_right_videos_ = num_right_videos;
 }
@@ -3687,3 +4625,23 @@ size_t Display::get_active_right_index() const {
 void Display::set_active_right_index(const size_t index) {
   active_right_index_ = std::min(index, num_right_videos_ > 0 ? num_right_videos_ - 1 : 0UL);
 }
+
+bool Display::get_mosaic_mode() const {
+  return mode_ == Mode::Mosaic;
+}
+
+void Display::set_mosaic_right_frames(const std::vector<std::pair<size_t, const AVFrame*>>& right_frames) {
+  std::string right_frames_key;
+
+  for (const auto& right_frame : right_frames) {
+    right_frames_key += string_sprintf("|%zu:%s", right_frame.first, right_frame.second != nullptr ? get_texture_content_key(right_frame.second).c_str() : "-");
+  }
+
+  // the tiles of right videos other than the active one also call for a refresh
+  if (right_frames_key != mosaic_right_frames_key_) {
+    mosaic_right_frames_key_ = right_frames_key;
+    has_updated_mosaic_frames_ = true;
+  }
+
+  mosaic_right_frames_ = right_frames;
+}
@@ -1,19 +1,29 @@
 #pragma once
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 #include "core_types.h"
+#include "glyph_atlas.h"
+#include "image_save_queue.h"
+#include "live_metrics.h"
+#include "quality_metrics.h"
 #include "row_workers.h"
 #include "scope_window.h"
 #include "string_utils.h"
+#include "tiled_texture.h"
 extern "C" {
 #include <libavutil/frame.h>
 }
@@ -102,9 +112,32 @@ struct PendingCropRequest {
   size_t right_target_index{0};
 };
 
+// Input latency (SDL event timestamp to the present showing it) and the spread of the intervals
+// between presents during playback, accumulated since they were last collected
+struct PresentStats {
+  int input_latency_samples{0};
+  double input_latency_ms_sum{0.0};
+  int interval_samples{0};
+  double interval_ms_sum{0.0};
+  double interval_ms_sum_of_squares{0.0};
+
+  double average_input_latency_ms() const { return input_latency_samples > 0 ? input_latency_ms_sum / input_latency_samples : 0.0; }
+
+  // standard deviation of the present intervals
+  double interval_jitter_ms() const {
+    if (interval_samples < 2) {
+      return 0.0;
+    }
+
+    const double mean = interval_ms_sum / interval_samples;
+
+    return std::sqrt(std::max(interval_ms_sum_of_squares / interval_samples - mean * mean, 0.0));
+  }
+};
+
 class Display {
  public:
-  enum class Mode { Split, VStack, HStack };
+  enum class Mode { Split, VStack, HStack, Mosaic };
   enum class Loop { Off, ForwardOnly, PingPong };
   enum class AspectLockMode { Off, Window, Content };
   enum class AspectViewMode { Stretch, Original, Preset16x9, Preset4x3, Preset1x1 };
@@ -118,6 +151,8 @@ class Display {
         return "vstack";
       case Mode::HStack:
         return "hstack";
+      case Mode::Mosaic:
+        return "mosaic";
       default:
         return "unknown";
     }
@@ -221,11 +256,20 @@ class Display {
   float seek_relative_{0.0F};
   int frame_buffer_offset_delta_{0};
   int frame_navigation_delta_{0};
+  int worst_frame_step_{0};
   int shift_right_frames_{0};
   bool seek_from_start_{false};
   bool save_image_frames_{false};
   bool print_mouse_position_and_color_{false};
   bool print_image_similarity_metrics_{false};
+  bool print_windowed_vmaf_{false};
+
+  std::unique_ptr<ImageSaveQueue> image_save_queue_;  // created on the first save
+  int png_compression_level_{3};
+
+  std::unique_ptr<LiveMetrics> live_metrics_;  // created on first use, then kept across modes
+  std::deque<LiveMetrics::Sample> live_metrics_history_;
+  uint64_t live_metrics_dropped_count_{0};
   bool mouse_is_inside_window_{false};
   float playback_speed_level_{0.0F};
   float playback_speed_factor_{1.0F};
@@ -236,9 +280,11 @@ class Display {
   // Subtraction mode settings
   DiffMode diff_mode_{DiffMode::AbsLinear};
   bool diff_luma_only_{false};
+  uint32_t difference_scale_{0};  // of the adaptive modes, from the last frame's p99 (0 if none yet; difference worker only)
 
   // Scope windows toggle requests
-  std::array<bool, ScopeWindow::kNumScopes> toggle_scope_window_requested_{{false, false, false}};
+  std::array<bool, ScopeWindow::kNumScopes> toggle_scope_window_requested_{{false, false, false, false}};
+  bool toggle_metrics_timeline_requested_{false};
 
   // Rectangle selection state
   enum class SelectionState { None, Started, Completed };
@@ -253,6 +299,11 @@ class Display {
   PendingCropRequest pending_crop_request_;
 
   bool input_received_{true};
+  bool has_unpresented_input_{false};
+  uint32_t unpresented_input_ticks_{0};  // of the earliest event not yet presented
+  std::chrono::steady_clock::time_point last_present_time_;
+  bool has_last_present_time_{false};  // only while playing
+  PresentStats present_stats_;
   int64_t previous_left_frame_pts_;
   int64_t previous_right_frame_pts_;
   std::string previous_left_frame_key_;
@@ -267,16 +318,61 @@ class Display {
   SDL sdl_;
   TTF_Font* small_font_{nullptr};
   TTF_Font* big_font_{nullptr};
+  std::unique_ptr<GlyphAtlas> small_glyph_atlas_;
+  std::unique_ptr<GlyphAtlas> big_glyph_atlas_;
   SDL_Cursor* normal_mode_cursor_;
   SDL_Cursor* pan_mode_cursor_;
   SDL_Cursor* selection_mode_cursor_;
-  uint8_t* diff_buffer_{nullptr};
-  uint32_t* left_buffer_{nullptr};
-  uint32_t* right_buffer_{nullptr};
-  std::array<uint8_t*, 3> diff_planes_;
-  std::array<uint32_t*, 3> left_planes_;
-  std::array<uint32_t*, 3> right_planes_;
-  std::array<size_t, 3> diff_pitches_;
+  uint8_t* left_buffer_{nullptr};   // difference worker only
+  uint8_t* right_buffer_{nullptr};  // difference worker only
+
+  // What the video texture holds, so that unchanged content is not converted and uploaded again:
+  // the left frame in columns [0, left_valid_until) and the right frame (or the difference) in
+  // columns [right_valid_from, width) of their regions, which coincide in split mode
+  struct VideoTextureState {
+    const TiledTexture* texture{nullptr};
+    std::string left_key;
+    std::string right_key;
+    int left_valid_until{0};
+    int right_valid_from{0};
+  };
+  VideoTextureState video_texture_state_;
+
+  // In mosaic mode, the left frame and these right frames (paired with their right video index) are
+  // tiled into a canvas of the size of a single frame, which takes the place of the video texture
+  std::vector<std::pair<size_t, const AVFrame*>> mosaic_right_frames_;
+  std::string mosaic_right_frames_key_;
+  bool has_updated_mosaic_frames_{false};
+  std::vector<uint8_t> mosaic_canvas_;
+
+  // Difference images are prepared by a worker thread, leaving the main thread (which owns the
+  // renderer) to upload and present them. Three full-frame buffers rotate between the worker
+  // (writing), the handoff (ready) and the texture upload (reading), so neither side waits.
+  struct DifferenceJob {
+    AVFrame* left_frame{nullptr};  // references, none if no job is pending
+    AVFrame* right_frame{nullptr};
+    std::string key;
+    DiffMode mode{DiffMode::AbsLinear};
+    bool luma_only{false};
+  };
+  struct DifferenceBuffer {
+    std::vector<uint8_t> data;
+    std::string key;  // of the difference held, empty if none
+  };
+  std::array<DifferenceBuffer, 3> difference_buffers_;
+  size_t difference_pitch_{0};
+  int difference_writing_index_{0};
+  int difference_ready_index_{1};
+  int difference_reading_index_{2};
+  bool has_ready_difference_{false};
+  DifferenceJob pending_difference_job_;
+  std::string submitted_difference_key_;  // main thread only
+  bool difference_worker_busy_{false};
+  bool quit_difference_worker_{false};
+  std::mutex difference_mutex_;
+  std::condition_variable difference_cv_;
+  RowWorkers difference_row_workers_;
+  std::thread difference_worker_;
 
   struct SideUIState {
     SDL_Texture* text_texture{nullptr};
@@ -295,14 +391,26 @@ class Display {
 
   std::string pending_message_;
   std::chrono::milliseconds message_shown_at_;
-  SDL_Texture* message_texture_{nullptr};
-  int message_width_;
-  int message_height_;
+  std::string message_;
 
   SDL_Window* window_;
   SDL_Renderer* renderer_;
-  SDL_Texture* video_texture_linear_{nullptr};
-  SDL_Texture* video_texture_nn_{nullptr};
+  std::unique_ptr<TiledTexture> video_texture_linear_;
+  std::unique_ptr<TiledTexture> video_texture_nn_;
+
+  // The loupe is read from the CPU-side frames rather than back from the renderer, and its texture
+  // is only updated when the magnified pixels change
+  struct LoupeSource {
+    const uint8_t* data;
+    size_t pitch;
+    int width;
+    int height;
+    int bytes_per_pixel;
+  };
+  SDL_Texture* loupe_texture_{nullptr};
+  int loupe_texture_size_{0};
+  std::vector<uint8_t> loupe_pixels_;
+  std::string loupe_key_;
 
   SDL_Event event_;
   int mouse_x_;
@@ -352,13 +460,31 @@ class Display {
   void handle_window_resize(bool reset_forced_size_guard = false, bool force_layout_refresh = false);
   void recreate_video_textures_for_current_mode();
 
-  void convert_to_packed_10_bpc(std::array<uint8_t*, 3> in_planes, std::array<size_t, 3> in_pitches, std::array<uint32_t*, 3> out_planes, std::array<size_t, 3> out_pitches, const SDL_Rect& roi);
+  // Packs the roi of 16-bit RGB planes into ARGB2101010, writing to out_plane from the roi's top-left
+  void convert_to_packed_10_bpc(std::array<uint8_t*, 3> in_planes, std::array<size_t, 3> in_pitches, uint32_t* out_plane, const size_t out_pitch, const SDL_Rect& roi);
 
-  void update_difference(std::array<uint8_t*, 3> planes_left, std::array<size_t, 3> pitches_left, std::array<uint8_t*, 3> planes_right, std::array<size_t, 3> pitches_right, int split_x);
+  // Expands the roi of an ARGB2101010 plane into RGB48, at the same position in out_plane (difference worker only)
+  void convert_from_packed_10_bpc(const uint8_t* in_plane, const size_t in_pitch, uint8_t* out_plane, const size_t out_pitch, const SDL_Rect& roi);
 
-  template <int Bpc>
-  float calculate_frame_p99(const typename BitDepthTraits<Bpc>::P* plane_left, const typename BitDepthTraits<Bpc>::P* plane_right, const size_t pitch_left, const size_t pitch_right, const int width_right) const;
+  // Hands a frame pair over to the difference worker unless it was the last one submitted,
+  // replacing any job not yet started; never waits
+  void submit_difference(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& key);
+
+  // Moves the latest difference finished by the worker to the reading buffer; returns true if there was one
+  bool consume_prepared_difference();
+
+  // Drops any pending job and waits for the worker to finish the current one, e.g. before reallocating buffers
+  void wait_for_difference_worker_idle();
 
+  void stop_difference_worker();
+
+  void run_difference_worker();
+
+  // Computes the whole difference image of the job's frames into plane_difference
+  void update_difference(const DifferenceJob& job, uint8_t* plane_difference, const size_t pitch_difference);
+
+  // Maps the difference of the planes with the given scale of the adaptive modes, optionally
+  // collecting the histogram the scale is derived from in the same pass
   template <int Bpc>
   void process_difference_planes(const typename BitDepthTraits<Bpc>::P* plane_left0,
                                  const typename BitDepthTraits<Bpc>::P* plane_right0,
@@ -367,9 +493,28 @@ class Display {
                                  const size_t pitch_right,
                                  const size_t pitch_difference,
                                  const int width_right,
-                                 const float diff_max) const;
+                                 const int height,
+                                 const DiffMode mode,
+                                 const bool luma_only,
+                                 const uint32_t scale_max,
+                                 std::vector<uint32_t>* histogram) const;
+
+  template <int Bpc>
+  void update_difference_planes(const typename BitDepthTraits<Bpc>::P* plane_left0,
+                                const typename BitDepthTraits<Bpc>::P* plane_right0,
+                                typename BitDepthTraits<Bpc>::P* plane_difference0,
+                                const size_t pitch_left,
+                                const size_t pitch_right,
+                                const size_t pitch_difference,
+                                const int width_right,
+                                const int height,
+                                const DiffMode mode,
+                                const bool luma_only);
+
+  void record_present();
 
   void save_image_frames(const AVFrame* left_frame, const AVFrame* right_frame);
+  bool queue_image_save(const std::vector<const AVFrame*>& frames, const std::vector<std::string>& filenames);
 
   inline int static round(const float value) { return static_cast<int>(std::round(value)); }
 
@@ -384,12 +529,24 @@ class Display {
 
   void render_text(int x, int y, SDL_Texture* texture, int texture_width, int texture_height, int border_extension, bool left_adjust);
 
+  // Same layout as render_text for text changing every frame, queued on the small glyph atlas
+  void render_atlas_text(const int x, const int y, const std::string& text, const SDL_Color& color, const bool left_adjust);
+
   void render_progress_dots(const float position, const float progress, const bool is_top);
 
+  bool is_live_metrics_on() const;
+  void render_live_metrics(const int y);
+
   SDL_Surface* render_text_with_fallback(const std::string& text);
 
-  SDL_Texture* get_video_texture() const;
+  TiledTexture* get_video_texture() const;
+  static std::string get_texture_content_key(const AVFrame* frame);
+
+  // True for frames converted at a reduced (adaptive preview) resolution
+  bool is_preview_frame(const AVFrame* frame) const;
+
   void update_texture(const SDL_Rect* rect, const void* pixels, int pitch, const std::string& message);
+  void update_texture_packed_10_bpc(const SDL_Rect* rect, std::array<uint8_t*, 3> planes, std::array<size_t, 3> pitches, const SDL_Rect& roi, const std::string& message);
 
   int round_and_clamp(const float value);
 
@@ -399,6 +556,11 @@ class Display {
   std::string format_pixel(const std::array<int, 3>& rgb);
   std::string get_and_format_rgb_yuv_pixel(uint8_t* rgb_plane, const size_t pitch, const AVFrame* frame, const int x, const int y);
 
+  QualityMetricsRoi to_source_frame_roi(const SDL_Rect& roi, const AVFrame* source_frame) const;
+
+  // Maps a region in video coordinates onto a display frame, which may be of a reduced preview resolution
+  SDL_Rect to_frame_roi(const SDL_Rect& roi, const AVFrame* frame) const;
+
   float* rgb_to_grayscale(const uint8_t* plane, const size_t pitch, const int width, const int height);
 
   float compute_ssim_block(const float* left_plane, const float* right_plane, const int width, const int x_offset, const int y_offset, const int block_size);
@@ -438,6 +600,18 @@ class Display {
   Vector2D window_to_video_position(const int window_x_position, const int window_y_position, const ZoomRect& zoom_rect, const bool floor_result = true) const;
   SDL_FRect video_to_zoom_space(const SDL_Rect& video_rect, const ZoomRect& zoom_rect) const;
 
+  // The part of the video texture within the window, with a texel to spare for filtered sampling
+  SDL_Rect get_visible_texture_rect(const ZoomRect& zoom_rect, const AVFrame* left_frame, const AVFrame* right_frame) const;
+
+  // Where each mosaic tile (the left first, then the rights) goes on the canvas, in video coordinates
+  std::vector<SDL_Rect> get_mosaic_tile_rects(const size_t tile_count) const;
+  // Prints the pixel of the tile at the given canvas position, as the mouse position print does
+  void print_mosaic_pixel(const AVFrame* left_frame, const int canvas_x, const int canvas_y);
+
+  void render_mosaic(const AVFrame* left_frame, const ZoomRect& zoom_rect);
+  void update_loupe(const AVFrame* left_frame, const AVFrame* right_frame, const int center_x, const int center_y, const int split_x, const int loupe_size);
+  void compose_mosaic(const std::vector<const AVFrame*>& frames, const std::vector<SDL_Rect>& tile_rects, const int bytes_per_pixel);
+
   void update_playback_speed(const float playback_speed_level_delta);
 
  public:
@@ -469,6 +643,9 @@ class Display {
   // Copy frame to display
   bool possibly_refresh(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& current_total_browsable);
 
+  // Score the buffered frame pairs (oldest first) with VMAF over the visible area and print the results
+  void print_windowed_vmaf(const std::vector<std::pair<const AVFrame*, const AVFrame*>>& frame_pairs);
+
   // Set a pending message to be displayed
   void set_pending_message(const std::string& message);
 
@@ -490,6 +667,16 @@ class Display {
 
   bool get_quit() const;
   bool get_play() const;
+
+  // Of the display the window is on, in Hz (0 if unknown)
+  int get_refresh_rate() const;
+
+  // Power-of-two reduction at which the video still covers at least one drawable pixel per pixel
+  int get_preview_scale_divisor() const;
+
+  // True while an action needs the frames at full resolution (saving, pixel and metrics printing, loupe)
+  bool get_full_resolution_requested() const;
+
   Loop get_buffer_play_loop_mode() const;
   void set_buffer_play_loop_mode(const Loop& mode);
   bool get_buffer_play_forward() const;
@@ -500,12 +687,17 @@ class Display {
   bool get_seek_from_start() const;
   int get_frame_buffer_offset_delta() const;
   int get_frame_navigation_delta() const;
+  int get_worst_frame_step() const;
   int get_shift_right_frames() const;
   float get_playback_speed_factor() const;
   bool get_tick_playback() const;
   bool get_possibly_tick_playback() const;
   bool get_show_fps() const;
 
+  // Returns the input latency and present pacing gathered since the previous call
+  PresentStats consume_present_stats();
+  bool get_print_windowed_vmaf() const;
+
   void update_metadata(const VideoMetadata left_metadata, const VideoMetadata right_metadata);
   void update_right_video(const std::string& right_file_name, const VideoMetadata right_metadata);
 
@@ -513,12 +705,24 @@ class Display {
   SDL_Rect get_visible_roi_in_single_frame_coordinates() const;
 
   bool get_toggle_scope_window_requested(const ScopeWindow::Type type) const;
+  bool get_toggle_metrics_timeline_requested() const;
+
+  // Seek to a position (in seconds) on the next iteration, as when clicking the progress bar
+  void seek_to(const float position);
 
   PendingCropRequest get_and_clear_pending_crop_request();
 
+  // Takes effect from the first saved image on
+  void set_png_compression_level(const int level);
+
   // Multiple right video support
   void set_num_right_videos(const size_t num_right_videos);
   size_t get_num_right_videos() const;
   size_t get_active_right_index() const;
   void set_active_right_index(size_t index);
+
+  bool get_mosaic_mode() const;
+
+  // The right frames to tile next to the left one on the next refresh in mosaic mode
+  void set_mosaic_right_frames(const std::vector<std::pair<size_t, const AVFrame*>>& right_frames);
 };
@@ -106,6 +106,37 @@ download_sdl_library() {
     echo "$FILE_NAME win32-x64 and mingw-devel builds downloaded and extracted successfully."
 }
 
+# Function to download zlib and build it as a static library with the MinGW-w64 toolchain
+# (the FFmpeg shared build ships no zlib headers or import library)
+# Parameters:
+#   1. (Optional) zlib version (e.g., 1.3.1)
+download_zlib() {
+    VERSION="${1:-1.3.1}"
+    VERSION="${VERSION#v}"
+    ARCHIVE="zlib-$VERSION.tar.gz"
+    DOWNLOAD_URL="https://github.com/madler/zlib/releases/download/v$VERSION/$ARCHIVE"
+
+    echo "Downloading $DOWNLOAD_URL..."
+    if ! wget "$DOWNLOAD_URL" -O "$ARCHIVE"; then
+        echo "Failed to download zlib $VERSION."
+        return 1
+    fi
+
+    echo "Extracting $ARCHIVE..."
+    tar -xzf "$ARCHIVE"
+    rm "$ARCHIVE"
+
+    MAKE_COMMAND=$(command -v mingw32-make || command -v make)
+    if [ -z "$MAKE_COMMAND" ]; then
+        echo "Failed to find make to build zlib with."
+        return 1
+    fi
+
+    echo "Building libz.a in zlib-$VERSION..."
+    "$MAKE_COMMAND" -C "zlib-$VERSION" -f win32/Makefile.gcc PREFIX=x86_64-w64-mingw32- libz.a
+    echo "zlib $VERSION downloaded and built successfully."
+}
+
 ARG="${1%$'\r'}"
 TAG="${2%$'\r'}"
 
@@ -119,8 +150,11 @@ case "$ARG" in
     sdl2_ttf)
         download_sdl_library "SDL_ttf" "SDL2_ttf" "$TAG"
         ;;
+    zlib)
+        download_zlib "$TAG"
+        ;;
     *)
-        echo "Usage: $0 {ffmpeg|sdl2|sdl2_ttf} [release_tag]"
+        echo "Usage: $0 {ffmpeg|sdl2|sdl2_ttf|zlib} [release_tag]"
         exit 1
         ;;
 esac
@@ -37,6 +37,16 @@ inline int check(const std::string& file_name, const int status) {
   return status;
 }
 
+// Packed 10-bit RGB in the layout of SDL's ARGB2101010 textures, where libavutil has it
+inline bool is_packed_10_bpc_rgb(const int format) {
+#ifdef AV_PIX_FMT_X2RGB10
+  return format == AV_PIX_FMT_X2RGB10LE;
+#else
+  (void)format;
+  return false;
+#endif
+}
+
 inline float pts_in_secs(const AVFrame* frame) {
   return frame->pts * AV_TIME_TO_SEC;
 }
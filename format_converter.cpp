@@ -48,7 +48,9 @@ FormatConverter::FormatConverter(const size_t src_width,
       src_color_space_{src_color_space},
       src_color_range_{src_color_range},
       active_flags_(flags),
-      pending_flags_(active_flags_) {
+      pending_flags_(active_flags_),
+      pending_dest_width_(dest_width),
+      pending_dest_height_(dest_height) {
   ScopedLogSide scoped_log_side(side);
 
   init();
@@ -109,10 +111,38 @@ AVPixelFormat FormatConverter::dest_pixel_format() const {
 }
 
 void FormatConverter::set_pending_flags(const int flags) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
   pending_flags_ = flags;
 }
 
-void FormatConverter::operator()(AVFrame* src, AVFrame* dst) {
+void FormatConverter::set_pending_dest_size(const size_t dest_width, const size_t dest_height) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  pending_dest_width_ = dest_width;
+  pending_dest_height_ = dest_height;
+}
+
+void FormatConverter::apply_pending_changes() {
+  bool must_reinit = false;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+
+    if (pending_flags_ != active_flags_) {
+      active_flags_ = pending_flags_;
+      must_reinit = true;
+    }
+    if (pending_dest_width_ != dest_width_ || pending_dest_height_ != dest_height_) {
+      dest_width_ = pending_dest_width_;
+      dest_height_ = pending_dest_height_;
+      must_reinit = true;
+    }
+  }
+
+  if (must_reinit) {
+    reinit();
+  }
+}
+
+void FormatConverter::operator()(const AVFrame* src, AVFrame* dst) {
   bool must_reinit = false;
 
   if (src_width_ != static_cast<size_t>(src->width)) {
@@ -139,10 +169,6 @@ void FormatConverter::operator()(AVFrame* src, AVFrame* dst) {
     src_color_range_ = src->color_range;
     must_reinit = true;
   }
-  if (pending_flags_ != active_flags_) {
-    active_flags_ = pending_flags_;
-    must_reinit = true;
-  }
 
   if (must_reinit) {
     reinit();
@@ -153,7 +179,8 @@ void FormatConverter::operator()(AVFrame* src, AVFrame* dst) {
 
   const AVDictionaryEntry* filter_generation_entry = av_dict_get(src->metadata, "filter_generation", nullptr, 0);
   const char* filter_generation = filter_generation_entry != nullptr ? filter_generation_entry->value : "0";
-  const std::string frame_key = std::to_string(src->pts) + ":" + filter_generation;
+  // the size tells apart conversions of the same frame at different (adaptive preview) resolutions
+  const std::string frame_key = std::to_string(src->pts) + ":" + filter_generation + ":" + std::to_string(dest_width_) + "x" + std::to_string(dest_height_);
 
   set_frame_key(dst, frame_key);
 
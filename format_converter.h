@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include "side_aware.h"
 extern "C" {
 #include "libavformat/avformat.h"
@@ -30,24 +31,33 @@ class FormatConverter : public SideAware {
   size_t dest_height() const;
   AVPixelFormat dest_pixel_format() const;
 
+  // Pending changes are made by another thread and take effect on the next apply_pending_changes()
   void set_pending_flags(const int flags);
+  void set_pending_dest_size(const size_t dest_width, const size_t dest_height);
 
-  void operator()(AVFrame* src, AVFrame* dst);
+  // Call on the converting thread before allocating each destination frame
+  void apply_pending_changes();
+
+  void operator()(const AVFrame* src, AVFrame* dst);
 
  private:
   size_t src_width_;
   size_t src_height_;
   AVPixelFormat src_pixel_format_;
 
-  const size_t dest_width_;
-  const size_t dest_height_;
+  size_t dest_width_;
+  size_t dest_height_;
   const AVPixelFormat dest_pixel_format_;
 
   AVColorSpace src_color_space_;
   AVColorRange src_color_range_;
 
   int active_flags_;
+
+  std::mutex pending_mutex_;
   int pending_flags_;
+  size_t pending_dest_width_;
+  size_t pending_dest_height_;
 
   SwsContext* conversion_context_{};
 };
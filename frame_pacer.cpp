@@ -0,0 +1,109 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// PTS steps of more frames than this are discontinuities (e.g. loop wrap-arounds) rather than drops
+static const int64_t MAX_DROPPED_FRAMES_PER_STEP = 30;
+
+static void accumulate(FramePacingStats& stats, const FramePacingStats& step) {
+  stats.presented_frames += step.presented_frames;
+  stats.dropped_frames += step.dropped_frames;
+  stats.duplicated_refreshes += step.duplicated_refreshes;
+  stats.late_presents += step.late_presents;
+}
+
+void FramePacer::set_refresh_rate(const int refresh_rate) {
+  refresh_rate_ = std::max(refresh_rate, 0);
+  refresh_period_us_ = refresh_rate_ > 0 ? (1000000 + refresh_rate_ / 2) / refresh_rate_ : 0;
+}
+
+int64_t FramePacer::us_until_refresh(const int64_t us_until_due, const int64_t refresh_time_us) const {
+  if (!has_vsync_phase_ || refresh_period_us_ == 0) {
+    return us_until_due;
+  }
+
+  const auto now = Clock::now();
+  const int64_t due_since_phase = std::chrono::duration_cast<std::chrono::microseconds>(now - vsync_phase_).count() + us_until_due;
+
+  // the nearest vsync shows any present issued within the preceding refresh period, so aim for its middle
+  const int64_t nearest_vsync = static_cast<int64_t>(std::llround(static_cast<double>(due_since_phase) / refresh_period_us_)) * refresh_period_us_;
+  const int64_t refresh_at = nearest_vsync - refresh_period_us_ / 2 - refresh_time_us;
+
+  return std::max<int64_t>(refresh_at - (due_since_phase - us_until_due), 0);
+}
+
+void FramePacer::on_present(const int64_t pts, const int64_t frame_duration, const float speed) {
+  const auto now = Clock::now();
+
+  vsync_phase_ = now;
+  has_vsync_phase_ = true;
+
+  if (has_previous_frame_ && pts == previous_pts_) {
+    return;
+  }
+
+  FramePacingStats step;
+  step.presented_frames = 1;
+
+  const double wall_clock_factor = 1.0 / std::max(speed, 0.01F);
+
+  // in-buffer ping-pong playback steps backwards
+  const int64_t pts_step = std::abs(pts - previous_pts_);
+
+  if (has_previous_frame_ && previous_frame_duration_ > 0 && pts_step > 0) {
+    const int64_t skipped_frames = std::llround(static_cast<double>(pts_step) / previous_frame_duration_) - 1;
+
+    if (skipped_frames > MAX_DROPPED_FRAMES_PER_STEP) {
+      restart();
+    } else {
+      step.dropped_frames = static_cast<uint64_t>(std::max<int64_t>(skipped_frames, 0));
+
+      const auto step_period = std::chrono::microseconds(std::llround(static_cast<double>(pts_step) * wall_clock_factor));
+      due_time_ += std::chrono::duration_cast<Clock::duration>(step_period);
+
+      if (refresh_period_us_ > 0) {
+        const double refresh_period = static_cast<double>(refresh_period_us_);
+
+        // e.g. 24 FPS on a 60 Hz display alternates between 2 and 3 refreshes per frame
+        const double cadence = std::ceil(static_cast<double>(step_period.count()) / refresh_period - 0.01);
+        const double shown = std::round(static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(now - previous_present_time_).count()) / refresh_period);
+
+        step.duplicated_refreshes = static_cast<uint64_t>(std::max(shown - cadence, 0.0));
+      }
+
+      // presents land on vsyncs, so up to a refresh after being due is on time
+      const int64_t tolerance_us = refresh_period_us_ > 0 ? refresh_period_us_ : previous_frame_duration_ / 2;
+
+      if (now > due_time_ + std::chrono::microseconds(tolerance_us)) {
+        step.late_presents = 1;
+
+        // catch up, so that a single hiccup is not counted against every frame after it
+        due_time_ = now;
+      }
+    }
+  }
+
+  accumulate(interval_stats_, step);
+  accumulate(total_stats_, step);
+
+  if (!has_previous_frame_) {
+    due_time_ = now;
+  }
+
+  has_previous_frame_ = true;
+  previous_pts_ = pts;
+  previous_frame_duration_ = frame_duration;
+  previous_present_time_ = now;
+}
+
+void FramePacer::restart() {
+  has_previous_frame_ = false;
+}
+
+FramePacingStats FramePacer::consume_interval_stats() {
+  const FramePacingStats stats = interval_stats_;
+  interval_stats_ = FramePacingStats{};
+
+  return stats;
+}
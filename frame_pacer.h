@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+struct FramePacingStats {
+  uint64_t presented_frames{0};
+  uint64_t dropped_frames{0};        // skipped over without ever being presented
+  uint64_t duplicated_refreshes{0};  // refreshes a frame stayed on screen beyond its cadence
+  uint64_t late_presents{0};         // more than a refresh after the frame was due
+};
+
+// Schedules playback presents against the display's vsync deadlines and accounts for how the
+// frames land on them. The vsync phase is taken from the completion of the (vsync-blocking)
+// presents. Must be used from the main thread only.
+class FramePacer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // 0 if unknown, in which case presents are not aligned and refreshes are not counted
+  void set_refresh_rate(const int refresh_rate);
+
+  int get_refresh_rate() const { return refresh_rate_; }
+
+  // True once the vsync phase is known from a present and the refresh rate is known
+  bool can_align_to_vsync() const { return has_vsync_phase_ && refresh_period_us_ > 0; }
+
+  // Microseconds to wait before the refresh of a frame due in us_until_due, so that, with the
+  // refresh taking refresh_time_us, its present lands on the vsync nearest to when it is due
+  // rather than on the first one after it
+  int64_t us_until_refresh(const int64_t us_until_due, const int64_t refresh_time_us) const;
+
+  // Accounts for a completed present of the playback frame with the given PTS and duration
+  // (microseconds) at the given playback speed; repeated presents of the same frame only
+  // track the vsync phase
+  void on_present(const int64_t pts, const int64_t frame_duration, const float speed);
+
+  // Breaks the frame sequence (pausing, seeking, stepping) so that the gap is not accounted for
+  void restart();
+
+  // Statistics since the previous call
+  FramePacingStats consume_interval_stats();
+
+  const FramePacingStats& get_total_stats() const { return total_stats_; }
+
+ private:
+  int refresh_rate_{0};
+  int64_t refresh_period_us_{0};
+
+  bool has_vsync_phase_{false};
+  Clock::time_point vsync_phase_;  // completion of the latest present, i.e. just after a vsync
+
+  bool has_previous_frame_{false};
+  int64_t previous_pts_{0};
+  int64_t previous_frame_duration_{0};
+  Clock::time_point previous_present_time_;
+  Clock::time_point due_time_;  // of the latest frame presented
+
+  FramePacingStats interval_stats_;
+  FramePacingStats total_stats_;
+};
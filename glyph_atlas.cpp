@@ -0,0 +1,182 @@
+#include "glyph_atlas.h"
+#include <algorithm>
+#include <stdexcept>
+
+static constexpr int ATLAS_COLUMNS = 16;
+
+// keeps filtered sampling of one glyph from picking up its neighbors
+static constexpr int GLYPH_PADDING = 1;
+
+static const SDL_Color WHITE_COLOR = {255, 255, 255, 255};
+
+// the printable part of Latin-1, as interpreted by TTF_RenderText_*
+static bool is_printable(const int c) {
+  return (c >= 32 && c <= 126) || (c >= 160 && c <= 255);
+}
+
+template <typename T>
+static T check_sdl(T value, const char* what) {
+  if (!value) {
+    throw std::runtime_error(std::string("SDL error in ") + what + ": " + SDL_GetError());
+  }
+  return value;
+}
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font) : renderer_(renderer), height_(TTF_FontHeight(font)) {
+  std::array<SDL_Surface*, 256> glyph_surfaces{};
+
+  int cell_width = 1;
+  int cell_height = std::max(height_, 1);
+  int glyph_count = 0;
+
+  for (int c = 0; c < 256; c++) {
+    if (!is_printable(c)) {
+      continue;
+    }
+
+    int advance = 0;
+
+    if (TTF_GlyphMetrics(font, static_cast<Uint16>(c), nullptr, nullptr, nullptr, nullptr, &advance) == 0) {
+      glyphs_[c].advance = advance;
+    }
+
+    // whitespace and glyphs missing from the font yield no surface
+    glyph_surfaces[c] = TTF_RenderGlyph_Blended(font, static_cast<Uint16>(c), WHITE_COLOR);
+
+    if (glyph_surfaces[c] != nullptr) {
+      cell_width = std::max(cell_width, glyph_surfaces[c]->w);
+      cell_height = std::max(cell_height, glyph_surfaces[c]->h);
+    }
+
+    glyph_count++;
+  }
+
+  cell_width += GLYPH_PADDING;
+  cell_height += GLYPH_PADDING;
+
+  texture_width_ = ATLAS_COLUMNS * cell_width;
+  texture_height_ = ((glyph_count + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * cell_height;
+
+  SDL_Surface* atlas_surface = SDL_CreateRGBSurfaceWithFormat(0, texture_width_, texture_height_, 32, SDL_PIXELFORMAT_ARGB8888);
+
+  int cell = 0;
+
+  for (int c = 0; c < 256; c++) {
+    if (!is_printable(c)) {
+      continue;
+    }
+
+    SDL_Surface* glyph_surface = glyph_surfaces[c];
+
+    if (glyph_surface != nullptr) {
+      SDL_Rect destination = {(cell % ATLAS_COLUMNS) * cell_width, (cell / ATLAS_COLUMNS) * cell_height, glyph_surface->w, glyph_surface->h};
+
+      if (atlas_surface != nullptr) {
+        // copy the coverage as is rather than blending it onto the transparent atlas
+        SDL_SetSurfaceBlendMode(glyph_surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(glyph_surface, nullptr, atlas_surface, &destination);
+      }
+
+      glyphs_[c].source = {destination.x, destination.y, glyph_surface->w, glyph_surface->h};
+      SDL_FreeSurface(glyph_surface);
+    }
+
+    cell++;
+  }
+
+  check_sdl(atlas_surface, "SDL_CreateRGBSurfaceWithFormat");
+
+  texture_ = SDL_CreateTextureFromSurface(renderer_, atlas_surface);
+  SDL_FreeSurface(atlas_surface);
+
+  check_sdl(texture_, "SDL_CreateTextureFromSurface");
+  SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+  SDL_DestroyTexture(texture_);
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::get_glyph(const char c) const {
+  const int index = static_cast<unsigned char>(c);
+
+  // TTF_RenderText_* would draw a missing-glyph box here
+  return is_printable(index) ? glyphs_[index] : glyphs_['?'];
+}
+
+int GlyphAtlas::get_text_width(const std::string& text) const {
+  int width = 0;
+
+  for (const char c : text) {
+    width += get_glyph(c).advance;
+  }
+
+  return width;
+}
+
+void GlyphAtlas::queue_text(const int x, const int y, const std::string& text, const SDL_Color& color, const Uint8 alpha) {
+  const SDL_Color modulation = {color.r, color.g, color.b, alpha};
+  int pen_x = x;
+
+  for (const char c : text) {
+    const Glyph& glyph = get_glyph(c);
+
+    if (glyph.source.w > 0) {
+      queued_glyphs_.push_back({glyph.source, {pen_x, y, glyph.source.w, glyph.source.h}, modulation});
+    }
+
+    pen_x += glyph.advance;
+  }
+}
+
+void GlyphAtlas::flush() {
+  if (queued_glyphs_.empty()) {
+    return;
+  }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  // a single draw call for every queued quad, colored per vertex
+  vertices_.clear();
+  indices_.clear();
+
+  const float u_scale = 1.0F / static_cast<float>(texture_width_);
+  const float v_scale = 1.0F / static_cast<float>(texture_height_);
+
+  for (const auto& queued : queued_glyphs_) {
+    const int first_vertex = static_cast<int>(vertices_.size());
+
+    const float x0 = static_cast<float>(queued.destination.x);
+    const float y0 = static_cast<float>(queued.destination.y);
+    const float x1 = static_cast<float>(queued.destination.x + queued.destination.w);
+    const float y1 = static_cast<float>(queued.destination.y + queued.destination.h);
+
+    const float u0 = static_cast<float>(queued.source.x) * u_scale;
+    const float v0 = static_cast<float>(queued.source.y) * v_scale;
+    const float u1 = static_cast<float>(queued.source.x + queued.source.w) * u_scale;
+    const float v1 = static_cast<float>(queued.source.y + queued.source.h) * v_scale;
+
+    vertices_.push_back({{x0, y0}, queued.color, {u0, v0}});
+    vertices_.push_back({{x1, y0}, queued.color, {u1, v0}});
+    vertices_.push_back({{x1, y1}, queued.color, {u1, v1}});
+    vertices_.push_back({{x0, y1}, queued.color, {u0, v1}});
+
+    for (const int corner : {0, 1, 2, 0, 2, 3}) {
+      indices_.push_back(first_vertex + corner);
+    }
+  }
+
+  SDL_RenderGeometry(renderer_, texture_, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(), static_cast<int>(indices_.size()));
+#else
+  // no geometry API before SDL 2.0.18; the glyphs still come from the one texture
+  for (const auto& queued : queued_glyphs_) {
+    SDL_SetTextureColorMod(texture_, queued.color.r, queued.color.g, queued.color.b);
+    SDL_SetTextureAlphaMod(texture_, queued.color.a);
+    SDL_RenderCopy(renderer_, texture_, &queued.source, &queued.destination);
+  }
+
+  SDL_SetTextureColorMod(texture_, 255, 255, 255);
+  SDL_SetTextureAlphaMod(texture_, 255);
+#endif
+
+  queued_glyphs_.clear();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <array>
+#include <string>
+#include <vector>
+
+// Pre-renders the printable Latin-1 glyphs of a font into a single texture, so that HUD text
+// which changes every frame is drawn as textured quads rather than rasterized and uploaded anew.
+// Bytes map to glyphs as with TTF_RenderText_*; text is queued and drawn in one batch by flush().
+class GlyphAtlas {
+ public:
+  GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font);
+  ~GlyphAtlas();
+
+  GlyphAtlas(const GlyphAtlas&) = delete;
+  GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+  int get_height() const { return height_; }
+
+  int get_text_width(const std::string& text) const;
+
+  int get_advance(const char c) const { return get_glyph(c).advance; }
+
+  // The alpha of the color is ignored, as with TTF_RenderText_*; the glyphs fade with the separate alpha
+  void queue_text(const int x, const int y, const std::string& text, const SDL_Color& color, const Uint8 alpha = SDL_ALPHA_OPAQUE);
+
+  // Draws all text queued since the last flush
+  void flush();
+
+ private:
+  struct Glyph {
+    SDL_Rect source{0, 0, 0, 0};
+    int advance{0};
+  };
+
+  struct QueuedGlyph {
+    SDL_Rect source;
+    SDL_Rect destination;
+    SDL_Color color;
+  };
+
+  const Glyph& get_glyph(const char c) const;
+
+ private:
+  SDL_Renderer* renderer_;
+  SDL_Texture* texture_{nullptr};
+  int texture_width_{0};
+  int texture_height_{0};
+  int height_{0};
+
+  std::array<Glyph, 256> glyphs_;
+
+  std::vector<QueuedGlyph> queued_glyphs_;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  std::vector<SDL_Vertex> vertices_;
+  std::vector<int> indices_;
+#endif
+};
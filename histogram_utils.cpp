@@ -0,0 +1,34 @@
+#include "histogram_utils.h"
+#include <cmath>
+#include <numeric>
+
+float calculate_histogram_percentile(const uint32_t* histogram, const int bins, const double fraction) {
+  const uint64_t total = std::accumulate(histogram, histogram + bins, uint64_t(0));
+
+  if (total == 0) {
+    return 0.F;
+  }
+
+  const double target = fraction * static_cast<double>(total - 1);
+  const uint64_t rank0 = static_cast<uint64_t>(std::floor(target));
+  const uint64_t rank1 = static_cast<uint64_t>(std::ceil(target));
+
+  int value0 = bins - 1;
+  int value1 = bins - 1;
+  uint64_t accumulated = 0;
+
+  for (int k = 0; k < bins; k++) {
+    const uint64_t next = accumulated + histogram[k];
+
+    if (accumulated <= rank0 && rank0 < next) {
+      value0 = k;
+    }
+    if (accumulated <= rank1 && rank1 < next) {
+      value1 = k;
+      break;
+    }
+    accumulated = next;
+  }
+
+  return static_cast<float>(value0 + (target - static_cast<double>(rank0)) * (value1 - value0));
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// Linear-interpolated percentile (fraction from 0 to 1) of the values counted in a histogram; 0 if it
+// is empty
+float calculate_histogram_percentile(const uint32_t* histogram, const int bins, const double fraction);
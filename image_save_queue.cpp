@@ -0,0 +1,138 @@
+#include "image_save_queue.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "png_saver.h"
+#include "png_writer.h"
+#include "string_utils.h"
+
+// e.g. "a.png, b.png and c.png"
+static std::string join_filenames(const std::vector<std::string>& filenames) {
+  std::string joined;
+
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (i > 0) {
+      joined += i + 1 < filenames.size() ? ", " : " and ";
+    }
+    joined += filenames[i];
+  }
+
+  return joined;
+}
+
+ImageSaveQueue::ImageSaveQueue(const size_t thread_count, const size_t max_pending_images, const int compression_level)
+    : max_pending_images_(max_pending_images), compression_level_(compression_level) {
+  const int writer_thread_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency() / std::max<size_t>(1, thread_count)));
+
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this, writer_thread_count]() { run(writer_thread_count); });
+  }
+}
+
+ImageSaveQueue::~ImageSaveQueue() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+    cv_.notify_all();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool ImageSaveQueue::submit(const std::vector<const AVFrame*>& frames, const std::vector<std::string>& filenames) {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (pending_images_ + frames.size() > max_pending_images_) {
+      return false;
+    }
+  }
+
+  auto image_set = std::make_shared<ImageSet>();
+  image_set->filenames = filenames;
+  image_set->remaining = frames.size();
+
+  std::vector<Job> jobs;
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    AVFrame* frame_ref = av_frame_clone(frames[i]);
+
+    if (frame_ref == nullptr) {
+      for (auto& job : jobs) {
+        av_frame_free(&job.frame);
+      }
+      throw std::runtime_error("av_frame_clone failed (image save)");
+    }
+
+    jobs.push_back({frame_ref, filenames[i], image_set});
+  }
+
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  for (auto& job : jobs) {
+    jobs_.push_back(std::move(job));
+  }
+  pending_images_ += frames.size();
+  cv_.notify_all();
+
+  return true;
+}
+
+std::vector<std::string> ImageSaveQueue::consume_notifications() {
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  std::vector<std::string> notifications;
+  notifications.swap(notifications_);
+
+  return notifications;
+}
+
+void ImageSaveQueue::run(const int writer_thread_count) {
+  PngWriter png_writer(writer_thread_count, compression_level_);
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      cv_.wait(lk, [&]() { return !jobs_.empty() || stop_; });
+
+      // pending images are still written when stopping
+      if (jobs_.empty()) {
+        break;
+      }
+
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    bool failed = false;
+
+    try {
+      if (PngWriter::supports_format(job.frame->format)) {
+        png_writer.write(job.frame, job.filename);
+      } else {
+        PngSaver::save(job.frame, job.filename);
+      }
+    } catch (const PngSaver::IOException& e) {
+      std::cerr << "Error saving video PNG image to file: " << job.filename << std::endl;
+      failed = true;
+    } catch (const std::exception& e) {
+      // e.g. std::bad_alloc for a large 16-bit frame; an escaping exception would terminate the player
+      std::cerr << "Unexpected error while saving PNG: " << e.what() << std::endl;
+      failed = true;
+    }
+
+    av_frame_free(&job.frame);
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    ImageSet& image_set = *job.image_set;
+
+    image_set.failed = image_set.failed || failed;
+    pending_images_--;
+
+    if (--image_set.remaining == 0) {
+      notifications_.push_back(string_sprintf(image_set.failed ? "Failed to save %s" : "Saved %s", join_filenames(image_set.filenames).c_str()));
+    }
+  }
+}
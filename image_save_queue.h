@@ -0,0 +1,58 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Writes PNG images on a few background threads. Submitting only takes references to the frames
+// (copying those that are not reference-counted), so the render loop never waits on encoding.
+// Images submitted together are reported together once the last of them has been written. Each
+// thread encodes with a PngWriter of its own, sharing the cores between them.
+class ImageSaveQueue {
+ public:
+  ImageSaveQueue(const size_t thread_count, const size_t max_pending_images, const int compression_level);
+  // Finishes writing the pending images
+  ~ImageSaveQueue();
+
+  // Returns false, saving nothing, if the images would exceed the pending limit
+  bool submit(const std::vector<const AVFrame*>& frames, const std::vector<std::string>& filenames);
+
+  // Completion and failure messages of the image sets finished since the last call
+  std::vector<std::string> consume_notifications();
+
+ private:
+  struct ImageSet {
+    std::vector<std::string> filenames;
+    size_t remaining;
+    bool failed{false};
+  };
+
+  struct Job {
+    AVFrame* frame{nullptr};
+    std::string filename;
+    std::shared_ptr<ImageSet> image_set;
+  };
+
+  void run(const int writer_thread_count);
+
+ private:
+  const size_t max_pending_images_;
+  const int compression_level_;
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  std::deque<Job> jobs_;
+  size_t pending_images_{0};  // queued or being written
+  bool stop_{false};
+
+  std::vector<std::string> notifications_;
+};
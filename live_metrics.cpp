@@ -0,0 +1,167 @@
+#include "live_metrics.h"
+#include <algorithm>
+#include <utility>
+#include "core_types.h"
+#include "quality_metrics.h"
+
+// leave most cores to decoding, filtering and format conversion
+static int get_live_metrics_thread_count() {
+  const unsigned int hardware_concurrency = std::thread::hardware_concurrency();
+
+  return std::max(1, static_cast<int>(hardware_concurrency / 4));
+}
+
+LiveMetrics::LiveMetrics(const size_t history_size) : history_size_(history_size), row_workers_(get_live_metrics_thread_count()) {
+  thread_ = std::thread([this]() { run(); });
+}
+
+LiveMetrics::~LiveMetrics() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+    cv_.notify_all();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  free_pair(pending_distorted_frame_, pending_reference_frame_);
+}
+
+void LiveMetrics::set_mode(const Mode mode) {
+  last_submitted_frame_keys_.clear();
+
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  mode_ = mode;
+  mode_generation_++;
+
+  free_pair(pending_distorted_frame_, pending_reference_frame_);
+  history_.clear();
+  dropped_count_ = 0;
+  updated_ = false;
+}
+
+LiveMetrics::Mode LiveMetrics::get_mode() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  return mode_;
+}
+
+void LiveMetrics::free_pair(AVFrame*& distorted_frame, AVFrame*& reference_frame) {
+  av_frame_free(&distorted_frame);
+  av_frame_free(&reference_frame);
+}
+
+void LiveMetrics::submit(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
+  if (get_mode() == Mode::Off) {
+    return;
+  }
+
+  const AVFrame* distorted_source = get_source_frame(distorted_frame);
+  const AVFrame* reference_source = get_source_frame(reference_frame);
+
+  if (distorted_source == nullptr || reference_source == nullptr) {
+    return;
+  }
+
+  const std::string frame_keys = get_frame_key(distorted_frame) + "|" + get_frame_key(reference_frame);
+
+  if (frame_keys == last_submitted_frame_keys_) {
+    return;
+  }
+
+  last_submitted_frame_keys_ = frame_keys;
+
+  AVFrame* distorted_ref = av_frame_clone(distorted_source);
+  AVFrame* reference_ref = av_frame_clone(reference_source);
+
+  if (distorted_ref == nullptr || reference_ref == nullptr) {
+    free_pair(distorted_ref, reference_ref);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  if (pending_distorted_frame_ != nullptr) {
+    free_pair(pending_distorted_frame_, pending_reference_frame_);
+    dropped_count_++;
+  }
+
+  pending_distorted_frame_ = distorted_ref;
+  pending_reference_frame_ = reference_ref;
+  pending_frame_keys_ = frame_keys;
+  cv_.notify_all();
+}
+
+bool LiveMetrics::consume_update(std::deque<Sample>& history, uint64_t& dropped_count) {
+  std::lock_guard<std::mutex> lk(mutex_);
+
+  if (!updated_) {
+    return false;
+  }
+
+  history = history_;
+  dropped_count = dropped_count_;
+  updated_ = false;
+
+  return true;
+}
+
+void LiveMetrics::run() {
+  while (true) {
+    AVFrame* distorted_frame = nullptr;
+    AVFrame* reference_frame = nullptr;
+    std::string frame_keys;
+    bool compute_vmaf;
+    uint64_t mode_generation;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      cv_.wait(lk, [&]() { return pending_distorted_frame_ != nullptr || stop_; });
+      if (stop_) {
+        break;
+      }
+      std::swap(distorted_frame, pending_distorted_frame_);
+      std::swap(reference_frame, pending_reference_frame_);
+      frame_keys = pending_frame_keys_;
+      compute_vmaf = mode_ == Mode::PsnrSsimVmaf;
+      mode_generation = mode_generation_;
+    }
+
+    Sample sample = compute(distorted_frame, reference_frame, compute_vmaf);
+    sample.frame_keys = frame_keys;
+
+    free_pair(distorted_frame, reference_frame);
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (mode_generation != mode_generation_) {
+        continue;
+      }
+      history_.push_back(sample);
+      while (history_.size() > history_size_) {
+        history_.pop_front();
+      }
+      updated_ = true;
+    }
+  }
+}
+
+LiveMetrics::Sample LiveMetrics::compute(const AVFrame* distorted_frame, const AVFrame* reference_frame, const bool compute_vmaf) {
+  Sample sample;
+  QualityMetrics metrics;
+
+  if (compute_native_quality_metrics(distorted_frame, reference_frame, QualityMetricsRoi{0, 0, distorted_frame->width, distorted_frame->height}, row_workers_, metrics)) {
+    sample.valid = true;
+    sample.psnr = metrics.psnr_average;
+    sample.psnr_is_infinite = metrics.mse_average == 0.0;
+    sample.ssim = metrics.ssim_average;
+    sample.has_ssim = metrics.has_ssim;
+
+    if (compute_vmaf) {
+      sample.vmaf = vmaf_calculator_.compute(distorted_frame, reference_frame);
+    }
+  }
+
+  return sample;
+}
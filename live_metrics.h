@@ -0,0 +1,80 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "row_workers.h"
+#include "vmaf_calculator.h"
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Computes similarity metrics for the displayed frame pairs on a background thread. The render
+// loop hands over the latest pair and never waits: a pair still pending when the next one
+// arrives is dropped, so the metrics trail playback rather than throttle it. The worker is kept
+// across modes, so switching them never waits on a computation in progress either; its result
+// is discarded instead. VMAF goes through a calculator of its own, leaving the shared one free
+// for the interactive commands.
+class LiveMetrics {
+ public:
+  enum class Mode { Off, PsnrSsim, PsnrSsimVmaf };
+
+  struct Sample {
+    std::string frame_keys;
+    bool valid{false};
+    double psnr{0.0};
+    bool psnr_is_infinite{false};
+    double ssim{0.0};
+    bool has_ssim{false};
+    std::string vmaf;
+  };
+
+  // Starts in Mode::Off
+  explicit LiveMetrics(const size_t history_size);
+  ~LiveMetrics();
+
+  // Discards the pending pair and the history
+  void set_mode(const Mode mode);
+  Mode get_mode() const;
+
+  // Cheap: takes references to the pre-conversion frames (see attach_source_frame). Pairs
+  // identical to the previously submitted one are ignored.
+  void submit(const AVFrame* distorted_frame, const AVFrame* reference_frame);
+
+  // Copies the history (oldest first) if a result arrived since the last call
+  bool consume_update(std::deque<Sample>& history, uint64_t& dropped_count);
+
+ private:
+  void run();
+
+  Sample compute(const AVFrame* distorted_frame, const AVFrame* reference_frame, const bool compute_vmaf);
+
+  static void free_pair(AVFrame*& distorted_frame, AVFrame*& reference_frame);
+
+ private:
+  const size_t history_size_;
+
+  RowWorkers row_workers_;
+  VMAFCalculator vmaf_calculator_;
+
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+
+  Mode mode_{Mode::Off};
+  uint64_t mode_generation_{0};  // results of pairs picked up before the last mode change are discarded
+
+  AVFrame* pending_distorted_frame_{nullptr};
+  AVFrame* pending_reference_frame_{nullptr};
+  std::string pending_frame_keys_;
+  bool stop_{false};
+
+  std::string last_submitted_frame_keys_;
+
+  std::deque<Sample> history_;
+  uint64_t dropped_count_{0};
+  bool updated_{false};
+};
@@ -9,6 +9,7 @@
 #include <vector>
 #include "argagg.h"
 #include "controls.h"
+#include "png_writer.h"
 #include "runtime_notes.h"
 #include "side_aware_logger.h"
 #include "string_utils.h"
@@ -559,9 +560,11 @@ int main(int argc, char** argv) {
          {"10-bpc", {"-b", "--10-bpc"}, "use 10 bits per color component instead of 8", 0},
          {"fast-alignment", {"-F", "--fast-alignment"}, "toggle fast bilinear scaling for aligning input source resolutions, replacing high-quality bicubic and chroma-accurate interpolation", 0},
          {"bilinear-texture", {"-I", "--bilinear-texture"}, "toggle bilinear video texture interpolation, replacing nearest-neighbor filtering", 0},
+         {"adaptive-preview", {"--adaptive-preview"}, "convert frames at about the on-screen resolution during playback (full resolution when paused, zoomed in or saving), so that high-resolution sources play in real time", 0},
          {"subtraction-mode", {"-S", "--subtraction-mode"}, "start in subtraction (difference) view", 0},
          {"display-number", {"-n", "--display-number"}, "open main window on specific display (e.g. 0, 1 or 2), default is 0", 1},
-         {"display-mode", {"-m", "--mode"}, "display mode (layout), 'split' for split screen (default), 'vstack' for vertical stack, 'hstack' for horizontal stack", 1},
+         {"display-mode", {"-m", "--mode"}, "display mode (layout), 'split' for split screen (default), 'vstack' for vertical stack, 'hstack' for horizontal stack, 'mosaic' for a grid of the left and all right videos", 1},
+         {"mosaic-rights", {"--mosaic-rights"}, "right videos to show in mosaic mode as a comma-separated list of 1-based indices (e.g. '1,3,4'), default is all", 1},
          {"window-size", {"-w", "--window-size"}, "override window size, specified as [width]x[height] (e.g. 800x600, 1280x or x480)", 1},
          {"window-fit-display", {"-W", "--window-fit-display"}, "calculate the window size to fit within the usable display bounds while maintaining the video aspect ratio", 0},
          {"aspect-lock", {"-k", "--aspect-lock"}, "aspect lock mode during resizing: 'off' (default), 'window' for initial window ratio, 'content' for current video/content ratio", 1},
@@ -570,6 +573,7 @@ int main(int argc, char** argv) {
          {"frame-buffer-size", {"-f", "--frame-buffer-size"}, "frame buffer size (e.g. 10, 70 or 150), default is 50", 1},
          {"time-shift", {"-t", "--time-shift"}, "shift the time stamps of the right video by a user-specified time offset, optionally with a multiplier (e.g. 0.150, -0.1, x1.04+0.1, x25.025/24-1:30.5)", 1},
          {"wheel-sensitivity", {"-s", "--wheel-sensitivity"}, "mouse wheel sensitivity (e.g. 0.5, -1 or 1.7), default is 1; negative values invert the input direction", 1},
+         {"png-compression-level", {"--png-compression-level"}, "compression level of saved PNG images, from 0 (none, fastest) to 9 (smallest), default is 3", 1},
          {"color-space", {"-C", "--color-space"}, "set the color space matrix, specified as [matrix] for the same on both sides, or [l-matrix?]:[r-matrix?] for different values (e.g. 'bt709' or 'bt2020nc:')", 1},
          {"color-range", {"-A", "--color-range"}, "set the color range, specified as [range] for the same on both sides, or [l-range?]:[r-range?] for different values (e.g. 'tv', ':pc' or 'pc:tv')", 1},
          {"color-primaries", {"-P", "--color-primaries"}, "set the color primaries, specified as [primaries] for the same on both sides, or [l-primaries?]:[r-primaries?] for different values (e.g. 'bt709' or 'bt2020:bt709')", 1},
@@ -585,11 +589,14 @@ int main(int argc, char** argv) {
          {"histogram-window", {"--histogram-window"}, "open always-on-top histogram scopes window", 0},
          {"vectorscope-window", {"--vectorscope-window"}, "open always-on-top vectorscope scopes window", 0},
          {"waveform-window", {"--waveform-window"}, "open always-on-top waveform scopes window", 0},
-         {"histogram-options", {"--histogram-options"}, "histogram FFmpeg filter options (e.g. 'display_mode=parade:colors_mode=coloronblack:level_height=256:levels_mode=logarithmic')", 1},
-         {"vectorscope-options", {"--vectorscope-options"}, "vectorscope FFmpeg filter options (e.g. 'mode=color4:graticule=green:envelope=instant+peak:flags=name+white+black')", 1},
-         {"waveform-options", {"--waveform-options"}, "waveform FFmpeg filter options (e.g. 'graticule=orange:display=stack:scale=ire:flags=numbers+dots:intensity=0.1:components=7:filter=lowpass')", 1},
+         {"difference-window", {"--difference-window"}, "open always-on-top scopes window with the distribution of the left/right differences and their 50th, 95th and 99th percentiles", 0},
+         {"histogram-options", {"--histogram-options"}, "histogram FFmpeg filter options, computed by the filter when given (e.g. 'display_mode=parade:colors_mode=coloronblack:level_height=256:levels_mode=logarithmic')", 1},
+         {"vectorscope-options", {"--vectorscope-options"}, "vectorscope FFmpeg filter options, computed by the filter when given (e.g. 'mode=color4:graticule=green:envelope=instant+peak:flags=name+white+black')", 1},
+         {"waveform-options", {"--waveform-options"}, "waveform FFmpeg filter options, computed by the filter when given (e.g. 'graticule=orange:display=stack:scale=ire:flags=numbers+dots:intensity=0.1:components=7:filter=lowpass')", 1},
+         {"difference-per-channel", {"--difference-per-channel"}, "show the difference distribution of each RGB channel rather than of the largest channel difference of each pixel", 0},
          {"scope-size", {"--scope-size"}, "set initial scope window size as WxH (total width by height); scope windows are resizable; default 1024x256", 1},
          {"scope-notop", {"--scope-notop"}, "do not keep scope windows always on top", 0},
+         {"scope-max-samples", {"--scope-max-samples"}, "maximum pixels per side a scope samples per frame, above which the ROI is sampled on an evenly spaced grid (0 samples every pixel); default 2000000", 1},
          {"find-protocols", {"--find-protocols"}, "find FFmpeg input protocols that match the provided search term (e.g. 'ipfs', 'srt', or 'rtmp'; use \"\" to list all)", 1},
          {"demuxer", {"--demuxer"}, "left FFmpeg video demuxer name for both sides, specified as [type?][:options?] (e.g. 'rawvideo:pixel_format=rgb24,video_size=320x240,framerate=10')", 1},
          {"left-demuxer", {"--left-demuxer"}, "left FFmpeg video demuxer name, specified as [type?][:options?]", 1},
@@ -687,6 +694,7 @@ int main(int argc, char** argv) {
       }
       config.use_10_bpc = args["10-bpc"];
       config.fast_input_alignment = args["fast-alignment"];
+      config.adaptive_preview = args["adaptive-preview"];
       config.bilinear_texture_filtering = args["bilinear-texture"];
       config.disable_auto_filters = args["disable-auto-filters"];
       config.start_in_subtraction_mode = args["subtraction-mode"];
@@ -709,8 +717,10 @@ int main(int argc, char** argv) {
           config.display_mode = Display::Mode::VStack;
         } else if (display_mode_arg == "hstack") {
           config.display_mode = Display::Mode::HStack;
+        } else if (display_mode_arg == "mosaic") {
+          config.display_mode = Display::Mode::Mosaic;
         } else {
-          throw std::logic_error{"Cannot parse display mode argument (valid options: split, vstack, hstack)"};
+          throw std::logic_error{"Cannot parse display mode argument (valid options: split, vstack, hstack, mosaic)"};
         }
       }
       if (args["color-space"]) {
@@ -804,6 +814,27 @@ int main(int argc, char** argv) {
 
         config.wheel_sensitivity = parse_strict_double(wheel_sensitivity_arg);
       }
+      if (args["png-compression-level"]) {
+        const std::string png_compression_level_arg = args["png-compression-level"];
+        const std::logic_error parse_error{"Cannot parse --png-compression-level argument; must be a number from 0 to 9"};
+
+        if (!std::regex_match(png_compression_level_arg, UNSIGNED_INTEGER_RE)) {
+          throw parse_error;
+        }
+
+        int png_compression_level;
+        try {
+          png_compression_level = parse_strict_int(png_compression_level_arg);
+        } catch (const std::invalid_argument&) {
+          throw parse_error;
+        }
+
+        if (png_compression_level > PngWriter::MAX_COMPRESSION_LEVEL) {
+          throw parse_error;
+        }
+
+        config.png_compression_level = png_compression_level;
+      }
       if (args["tone-map-mode"]) {
         auto tone_mapping_mode_spec = static_cast<const std::string&>(args["tone-map-mode"]);
         auto left_tone_mapping_mode = get_nth_token_or_empty(tone_mapping_mode_spec, ':', 0);
@@ -816,6 +847,8 @@ int main(int argc, char** argv) {
       config.scopes.histogram = args["histogram-window"];
       config.scopes.vectorscope = args["vectorscope-window"];
       config.scopes.waveform = args["waveform-window"];
+      config.scopes.difference = args["difference-window"];
+      config.scopes.difference_per_channel = args["difference-per-channel"];
       if (args["histogram-options"]) {
         config.scopes.histogram_options = static_cast<const std::string&>(args["histogram-options"]);
       }
@@ -837,6 +870,20 @@ int main(int argc, char** argv) {
       if (args["scope-notop"]) {
         config.scopes.always_on_top = false;
       }
+      if (args["scope-max-samples"]) {
+        const std::string scope_max_samples_arg = args["scope-max-samples"];
+        const std::logic_error parse_error{"Cannot parse --scope-max-samples argument (required format: [number], e.g. 0, 500000 or 2000000)"};
+
+        if (!std::regex_match(scope_max_samples_arg, UNSIGNED_INTEGER_RE)) {
+          throw parse_error;
+        }
+
+        try {
+          config.scopes.max_samples = parse_strict_int(scope_max_samples_arg);
+        } catch (const std::invalid_argument&) {
+          throw parse_error;
+        }
+      }
 
       // video filters
       if (args["filters"]) {
@@ -962,10 +1009,40 @@ int main(int argc, char** argv) {
         config.right_videos.push_back(right_video);
       }
 
+      if (args["mosaic-rights"]) {
+        const std::string mosaic_rights_arg = args["mosaic-rights"];
+        const std::logic_error parse_error{string_sprintf("Cannot parse mosaic rights argument (required format: comma-separated distinct right video numbers between 1 and %zu, e.g. 1,3)", config.right_videos.size())};
+
+        for (const auto& index_arg : string_split(mosaic_rights_arg, ',')) {
+          if (!std::regex_match(index_arg, UNSIGNED_INTEGER_RE)) {
+            throw parse_error;
+          }
+
+          int right_number;
+          try {
+            right_number = parse_strict_int(index_arg);
+          } catch (const std::invalid_argument&) {
+            throw parse_error;
+          }
+
+          if (right_number < 1 || static_cast<size_t>(right_number) > config.right_videos.size()) {
+            throw parse_error;
+          }
+
+          const size_t right_index = static_cast<size_t>(right_number - 1);
+
+          if (std::find(config.mosaic_right_indices.cbegin(), config.mosaic_right_indices.cend(), right_index) != config.mosaic_right_indices.cend()) {
+            throw parse_error;
+          }
+
+          config.mosaic_right_indices.push_back(right_index);
+        }
+      }
+
       av_log_set_callback(sa_av_log_callback);
 
       if (args["libvmaf-options"]) {
-        VMAFCalculator::instance().set_libvmaf_options(args["libvmaf-options"]);
+        VMAFCalculator::set_libvmaf_options(args["libvmaf-options"]);
       }
 
       maybe_log_runtime_note();
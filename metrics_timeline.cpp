@@ -0,0 +1,345 @@
+#include "metrics_timeline.h"
+#include <algorithm>
+#include <iostream>
+#include "ffmpeg.h"
+#include "metrics_timeline_window.h"
+#include "quality_metrics.h"
+#include "row_workers.h"
+#include "vmaf_calculator.h"
+extern "C" {
+#include <libavfilter/avfilter.h>
+}
+
+// how often a window follows a scan that is still streaming in results
+static constexpr std::chrono::milliseconds SCAN_REDRAW_INTERVAL(100);
+
+// consecutive frames scored per libvmaf session; each session also streams the frame before and
+// after the batch, so that the motion features at its boundaries see their real neighbors
+static constexpr size_t VMAF_BATCH_SIZE = 24;
+
+MetricsTimeline::MetricsTimeline(const ClipScannerFactory& scanner_factory, const float duration, const int window_width, const int window_height, const bool always_on_top, const int display_number)
+    : scanner_factory_(scanner_factory), duration_(duration), window_width_(window_width), window_height_(window_height), always_on_top_(always_on_top), display_number_(display_number) {}
+
+MetricsTimeline::~MetricsTimeline() {
+  window_.reset();
+
+  for (auto& pair : scans_) {
+    stop_scan(*pair.second);
+  }
+}
+
+bool MetricsTimeline::handle_event(const SDL_Event& event) {
+  return window_ != nullptr && window_->handle_event(event);
+}
+
+bool MetricsTimeline::request_toggle() {
+  if (window_ != nullptr) {
+    window_.reset();
+    return false;
+  }
+
+  window_ = std::make_unique<MetricsTimelineWindow>(window_width_, window_height_, always_on_top_, display_number_);
+  rendered_revision_ = 0;
+
+  reconcile();
+
+  return true;
+}
+
+void MetricsTimeline::set_pair(const Side& right_side, const int right_frame_shift, const int64_t right_time_shift) {
+  const ScanKey key{right_side, right_frame_shift};
+
+  if (has_selection_ && key == selected_key_) {
+    return;
+  }
+
+  selected_key_ = key;
+  selected_right_time_shift_ = right_time_shift;
+  has_selection_ = true;
+
+  // abandon unfinished scans of pairs no longer looked at; finished ones stay cached
+  for (auto it = scans_.begin(); it != scans_.end();) {
+    bool complete;
+    {
+      std::lock_guard<std::mutex> lock(it->second->mutex);
+      complete = it->second->snapshot.complete;
+    }
+
+    if (it->first != key && !complete) {
+      stop_scan(*it->second);
+      it = scans_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void MetricsTimeline::set_position(const int64_t left_pts) {
+  position_pts_ = left_pts;
+}
+
+void MetricsTimeline::reconcile() {
+  if (window_ != nullptr && window_->close_requested()) {
+    window_.reset();
+  }
+
+  if ((window_ != nullptr || scan_requested_) && has_selection_ && scans_.find(selected_key_) == scans_.end()) {
+    start_scan(selected_key_, selected_right_time_shift_);
+  }
+}
+
+void MetricsTimeline::request_scan() {
+  scan_requested_ = true;
+
+  reconcile();
+}
+
+bool MetricsTimeline::get_snapshot(MetricsTimelineSnapshot& snapshot, const size_t first_point) const {
+  const auto it = scans_.find(selected_key_);
+
+  if (!has_selection_ || it == scans_.end()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(it->second->mutex);
+  const MetricsTimelineSnapshot& scan_snapshot = it->second->snapshot;
+
+  snapshot.points.assign(scan_snapshot.points.cbegin() + std::min(first_point, scan_snapshot.points.size()), scan_snapshot.points.cend());
+  snapshot.complete = scan_snapshot.complete;
+  snapshot.failed = scan_snapshot.failed;
+  snapshot.vmaf_failed = scan_snapshot.vmaf_failed;
+
+  return true;
+}
+
+void MetricsTimeline::render() {
+  if (window_ == nullptr) {
+    return;
+  }
+
+  const auto it = scans_.find(selected_key_);
+  if (it == scans_.end()) {
+    return;
+  }
+
+  Scan& scan = *it->second;
+  uint64_t revision;
+  {
+    std::lock_guard<std::mutex> lock(scan.mutex);
+    revision = scan.revision;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+
+  const bool scan_changed = revision != rendered_revision_ || selected_key_ != rendered_key_;
+  const bool view_changed = position_pts_ != rendered_position_pts_ || window_->needs_redraw();
+
+  if (!view_changed && (!scan_changed || (now - last_render_time_) < SCAN_REDRAW_INTERVAL)) {
+    return;
+  }
+
+  MetricsTimelineSnapshot snapshot;
+  {
+    std::lock_guard<std::mutex> lock(scan.mutex);
+    snapshot = scan.snapshot;
+    revision = scan.revision;
+  }
+
+  window_->render(snapshot, duration_, position_pts_);
+
+  rendered_revision_ = revision;
+  rendered_key_ = selected_key_;
+  rendered_position_pts_ = position_pts_;
+  last_render_time_ = now;
+}
+
+bool MetricsTimeline::consume_seek_request(float& position) {
+  int64_t pts;
+
+  if (window_ == nullptr || !window_->consume_seek_request(duration_, pts)) {
+    return false;
+  }
+
+  position = static_cast<float>(pts * AV_TIME_TO_SEC);
+
+  return true;
+}
+
+void MetricsTimeline::start_scan(const ScanKey& key, const int64_t right_time_shift) {
+  auto scan = std::make_unique<Scan>();
+
+  try {
+    scan->scanner = scanner_factory_(key.first, right_time_shift);
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to set up the metrics timeline scan: " << e.what() << std::endl;
+    scan->snapshot.failed = true;
+    scan->snapshot.complete = true;
+  }
+
+  if (scan->scanner != nullptr) {
+    Scan* scan_ptr = scan.get();
+    scan->thread = std::thread([scan_ptr]() { run_scan(*scan_ptr); });
+  }
+
+  scans_[key] = std::move(scan);
+}
+
+void MetricsTimeline::stop_scan(Scan& scan) {
+  scan.cancel.store(true, std::memory_order_relaxed);
+
+  if (scan.thread.joinable()) {
+    scan.thread.join();
+  }
+}
+
+void MetricsTimeline::run_scan(Scan& scan) {
+  RowWorkers row_workers(get_clip_scan_thread_count());
+
+  // the scan's own, so that it neither waits on the interactive commands nor affects them
+  VMAFCalculator vmaf_calculator;
+
+  bool compute_vmaf = avfilter_get_by_name("libvmaf") != nullptr;
+
+  // consecutive pairs, the first vmaf_batch_context of which were scored by the previous session
+  std::vector<std::pair<AVFrame*, AVFrame*>> vmaf_batch;
+  size_t vmaf_batch_first_index = 0;
+  size_t vmaf_batch_context = 0;
+
+  auto free_vmaf_pairs = [&](const size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      av_frame_free(&vmaf_batch[i].first);
+      av_frame_free(&vmaf_batch[i].second);
+    }
+    vmaf_batch.erase(vmaf_batch.begin(), vmaf_batch.begin() + count);
+    vmaf_batch_first_index += count;
+  };
+
+  auto free_vmaf_batch = [&]() {
+    free_vmaf_pairs(vmaf_batch.size());
+    vmaf_batch_context = 0;
+  };
+
+  // scores all but the context pairs, and with keep_lookahead also all but the last pair, which is
+  // then scored by the next session with the pair before it as context
+  auto flush_vmaf_batch = [&](const bool keep_lookahead) {
+    const size_t scored_end = keep_lookahead ? vmaf_batch.size() - 1 : vmaf_batch.size();
+
+    if (vmaf_batch.empty() || scored_end <= vmaf_batch_context) {
+      free_vmaf_batch();
+      return;
+    }
+
+    const std::vector<std::pair<const AVFrame*, const AVFrame*>> frame_pairs(vmaf_batch.cbegin(), vmaf_batch.cend());
+    VMAFWindowScores scores;
+
+    // plot the first model only; give up on VMAF for this scan if libvmaf reports no per-frame scores
+    if (vmaf_calculator.compute_window(frame_pairs, scores) && scores.per_frame.size() == vmaf_batch.size()) {
+      std::lock_guard<std::mutex> lock(scan.mutex);
+
+      for (size_t i = vmaf_batch_context; i < scored_end; i++) {
+        MetricsTimelinePoint& point = scan.snapshot.points[vmaf_batch_first_index + i];
+
+        if (!scores.per_frame[i].empty()) {
+          point.vmaf = static_cast<float>(scores.per_frame[i].front());
+          point.has_vmaf = true;
+        }
+      }
+      scan.revision++;
+    } else {
+      std::cerr << "Metrics timeline: no per-frame VMAF scores, continuing with PSNR and SSIM only" << std::endl;
+      compute_vmaf = false;
+
+      std::lock_guard<std::mutex> lock(scan.mutex);
+      scan.snapshot.vmaf_failed = true;
+      scan.revision++;
+    }
+
+    if (compute_vmaf && keep_lookahead) {
+      free_vmaf_pairs(vmaf_batch.size() - 2);
+      vmaf_batch_context = 1;
+    } else {
+      free_vmaf_batch();
+    }
+  };
+
+  auto on_pair = [&](const AVFrame* left_frame, const AVFrame* right_frame) {
+    MetricsTimelinePoint point{left_frame->pts, false, 0.0F, false, 0.0F, false, 0.0F, false};
+    QualityMetrics metrics;
+
+    if (compute_native_quality_metrics(left_frame, right_frame, QualityMetricsRoi{0, 0, left_frame->width, left_frame->height}, row_workers, metrics)) {
+      point.valid = true;
+      point.psnr = static_cast<float>(metrics.psnr_average);
+      point.psnr_is_infinite = metrics.mse_average == 0.0;
+      point.ssim = static_cast<float>(metrics.ssim_average);
+      point.has_ssim = metrics.has_ssim;
+    }
+
+    size_t point_index;
+    {
+      std::lock_guard<std::mutex> lock(scan.mutex);
+      point_index = scan.snapshot.points.size();
+      scan.snapshot.points.push_back(point);
+      scan.revision++;
+    }
+
+    if (compute_vmaf) {
+      // a libvmaf session needs consistent dimensions and pixel formats throughout
+      const bool fits_batch =
+          vmaf_batch.empty() || (vmaf_batch.front().first->width == left_frame->width && vmaf_batch.front().first->height == left_frame->height && vmaf_batch.front().first->format == left_frame->format);
+
+      if (!point.valid || !fits_batch) {
+        flush_vmaf_batch(false);
+      }
+
+      if (point.valid && compute_vmaf) {
+        if (vmaf_batch.empty()) {
+          vmaf_batch_first_index = point_index;
+        }
+
+        AVFrame* left_ref = av_frame_clone(left_frame);
+        AVFrame* right_ref = av_frame_clone(right_frame);
+
+        if (left_ref == nullptr || right_ref == nullptr) {
+          av_frame_free(&left_ref);
+          av_frame_free(&right_ref);
+          throw std::runtime_error("av_frame_clone failed");
+        }
+
+        vmaf_batch.emplace_back(left_ref, right_ref);
+
+        if (vmaf_batch.size() == vmaf_batch_context + VMAF_BATCH_SIZE + 1) {
+          flush_vmaf_batch(true);
+        }
+      }
+    }
+
+    return true;
+  };
+
+  bool finished = false;
+  bool failed = false;
+
+  try {
+    finished = scan.scanner->run(on_pair, scan.cancel);
+
+    if (finished) {
+      flush_vmaf_batch(false);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Metrics timeline scan failed: " << e.what() << std::endl;
+    failed = true;
+  }
+
+  free_vmaf_batch();
+
+  // release the decoders and files right away rather than when the cached results go
+  scan.scanner.reset();
+
+  // a cancelled scan is about to be discarded
+  if (finished || failed) {
+    std::lock_guard<std::mutex> lock(scan.mutex);
+    scan.snapshot.complete = true;
+    scan.snapshot.failed = failed;
+    scan.revision++;
+  }
+}
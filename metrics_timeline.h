@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "clip_scanner.h"
+#include "core_types.h"
+
+// Forward declarations to avoid leaking SDL headers outside the window's translation unit
+union SDL_Event;
+class MetricsTimelineWindow;
+
+struct MetricsTimelinePoint {
+  int64_t pts;  // left side, microseconds from the start
+  bool valid;   // false if the sides differ in size or pixel format
+  float psnr;
+  bool psnr_is_infinite;
+  float ssim;
+  bool has_ssim;
+  float vmaf;
+  bool has_vmaf;
+};
+
+struct MetricsTimelineSnapshot {
+  std::vector<MetricsTimelinePoint> points;  // in PTS order
+  bool complete{false};
+  bool failed{false};
+  bool vmaf_failed{false};  // VMAF was given up on for this scan only; the other metrics carry on
+};
+
+// Per-frame PSNR/SSIM (and VMAF when libvmaf is available) of the left input and a right input
+// across the whole clip, filled in by a background scan and plotted in a separate window.
+// Results are cached per right input and time shift, and a scan keeps running while the window
+// is closed, so reopening the window is instant.
+class MetricsTimeline {
+ public:
+  // The scanner factory is called on the main thread
+  MetricsTimeline(const ClipScannerFactory& scanner_factory, const float duration, const int window_width, const int window_height, const bool always_on_top, const int display_number);
+  ~MetricsTimeline();
+
+  // Dispatch an SDL event to the timeline window; returns true if consumed
+  bool handle_event(const SDL_Event& event);
+
+  // Opens or closes the window; returns true if it was opened (so the caller can refocus the main window)
+  bool request_toggle();
+
+  // Selects the pair to plot. The frame shift identifies the time shift in the cache, since the
+  // time shift itself is re-derived from the (averaged) frame duration.
+  void set_pair(const Side& right_side, const int right_frame_shift, const int64_t right_time_shift);
+
+  // Current left PTS of the main view, marked on the timeline
+  void set_position(const int64_t left_pts);
+
+  // Destroys the window if it requested to close; starts the scan for the selected pair if needed
+  void reconcile();
+
+  // Scans the selected pair (and any selected later) even while the window is closed, as for the
+  // worst frame search
+  void request_scan();
+
+  // Copies the results for the selected pair so far, leaving out the points before first_point;
+  // returns false if it is not being scanned
+  bool get_snapshot(MetricsTimelineSnapshot& snapshot, const size_t first_point = 0) const;
+
+  // Redraws the window if anything changed (main thread)
+  void render();
+
+  // Returns true once per click or drag in the plot, with the position to seek to in seconds
+  bool consume_seek_request(float& position);
+
+  bool is_open() const { return window_ != nullptr; }
+
+ private:
+  using ScanKey = std::pair<Side, int>;
+
+  struct Scan {
+    std::unique_ptr<ClipScanner> scanner;
+    std::thread thread;
+    std::atomic_bool cancel{false};
+
+    std::mutex mutex;
+    MetricsTimelineSnapshot snapshot;
+    uint64_t revision{0};
+  };
+
+  void start_scan(const ScanKey& key, const int64_t right_time_shift);
+  void stop_scan(Scan& scan);
+
+  static void run_scan(Scan& scan);
+
+ private:
+  const ClipScannerFactory scanner_factory_;
+  const float duration_;
+  const int window_width_;
+  const int window_height_;
+  const bool always_on_top_;
+  const int display_number_;
+
+  std::unique_ptr<MetricsTimelineWindow> window_;
+
+  std::map<ScanKey, std::unique_ptr<Scan>> scans_;
+
+  ScanKey selected_key_{LEFT, 0};
+  int64_t selected_right_time_shift_{0};
+  bool has_selection_{false};
+  bool scan_requested_{false};
+
+  int64_t position_pts_{0};
+
+  // throttles redraws while a scan is streaming in results
+  uint64_t rendered_revision_{0};
+  ScanKey rendered_key_{LEFT, 0};
+  int64_t rendered_position_pts_{INT64_MIN};
+  std::chrono::steady_clock::time_point last_render_time_;
+};
@@ -0,0 +1,327 @@
+#include "metrics_timeline_window.h"
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "ffmpeg.h"
+#include "sdl_event_info.h"
+#include "string_utils.h"
+
+namespace {
+constexpr int kPlotPad = 4;
+constexpr int kMarkerThickness = 2;
+constexpr float kMinPsnrRange = 1.0F;
+constexpr float kMinSsimRange = 0.001F;
+
+constexpr SDL_Color kPsnrColor = {255, 176, 96, 255};
+constexpr SDL_Color kSsimColor = {128, 224, 144, 255};
+constexpr SDL_Color kVmafColor = {144, 176, 255, 255};
+
+const char* kBaseTitle = "Metrics timeline";
+
+struct Lane {
+  SDL_Rect rect;
+  SDL_Color color;
+};
+
+// Maps a value in [0, 1] to a y coordinate within the lane (1 is at the top)
+inline int lane_y(const Lane& lane, const float normalized) {
+  const float clamped = std::min(std::max(normalized, 0.0F), 1.0F);
+
+  return lane.rect.y + lane.rect.h - 1 - static_cast<int>(clamped * static_cast<float>(lane.rect.h - 1) + 0.5F);
+}
+
+void draw_series(SDL_Renderer* renderer, const Lane& lane, const std::vector<SDL_Point>& points) {
+  SDL_SetRenderDrawColor(renderer, lane.color.r, lane.color.g, lane.color.b, lane.color.a);
+
+  if (points.size() == 1) {
+    SDL_RenderDrawPoint(renderer, points.front().x, points.front().y);
+  } else if (points.size() > 1) {
+    SDL_RenderDrawLines(renderer, points.data(), static_cast<int>(points.size()));
+  }
+}
+}  // namespace
+
+static void* sdl_check_ptr(void* ptr, const char* what) {
+  if (!ptr) {
+    throw std::runtime_error(std::string("SDL error in ") + what + ": " + SDL_GetError());
+  }
+  return ptr;
+}
+
+MetricsTimelineWindow::MetricsTimelineWindow(const int width, const int height, const bool always_on_top, const int display_number) : window_width_(width), window_height_(height) {
+  Uint32 window_flags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE;
+
+  if (always_on_top) {
+    window_flags |= SDL_WINDOW_ALWAYS_ON_TOP;
+  }
+
+  // Place it at the bottom of the usable bounds to stay clear of the scope windows, which start at the top
+  int initial_position_x = SDL_WINDOWPOS_UNDEFINED_DISPLAY(display_number);
+  int initial_position_y = SDL_WINDOWPOS_UNDEFINED_DISPLAY(display_number);
+  SDL_Rect usable_bounds;
+  if (SDL_GetDisplayUsableBounds(display_number, &usable_bounds) == 0) {
+    const int margin_pixels = 32;
+    initial_position_x = usable_bounds.x + margin_pixels;
+    initial_position_y = usable_bounds.y + std::max(margin_pixels, usable_bounds.h - height - margin_pixels);
+  }
+
+  last_window_title_ = kBaseTitle;
+
+  window_ = static_cast<SDL_Window*>(sdl_check_ptr(SDL_CreateWindow(kBaseTitle, initial_position_x, initial_position_y, width, height, window_flags), "SDL_CreateWindow"));
+
+  // no vsync: presenting must never hold up the main loop
+  renderer_ = static_cast<SDL_Renderer*>(sdl_check_ptr(SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED), "SDL_CreateRenderer"));
+
+  window_id_ = SDL_GetWindowID(window_);
+}
+
+MetricsTimelineWindow::~MetricsTimelineWindow() {
+  if (renderer_ != nullptr) {
+    SDL_DestroyRenderer(renderer_);
+    renderer_ = nullptr;
+  }
+  if (window_ != nullptr) {
+    SDL_DestroyWindow(window_);
+    window_ = nullptr;
+  }
+}
+
+int MetricsTimelineWindow::pts_to_x(const int64_t pts, const float duration) const {
+  const int plot_width = std::max(1, window_width_ - kPlotPad * 2);
+  const float fraction = duration > 0.0F ? static_cast<float>(pts * AV_TIME_TO_SEC) / duration : 0.0F;
+
+  return kPlotPad + static_cast<int>(std::min(std::max(fraction, 0.0F), 1.0F) * static_cast<float>(plot_width - 1));
+}
+
+void MetricsTimelineWindow::build_columns(const MetricsTimelineSnapshot& snapshot, const float duration) {
+  columns_.assign(static_cast<size_t>(std::max(1, window_width_)), Column{});
+
+  for (const auto& point : snapshot.points) {
+    if (!point.valid) {
+      continue;
+    }
+
+    Column& column = columns_[std::min(static_cast<size_t>(pts_to_x(point.pts, duration)), columns_.size() - 1)];
+
+    const bool is_worse_psnr = !column.has_psnr || (column.psnr_is_infinite && !point.psnr_is_infinite) || (!point.psnr_is_infinite && point.psnr < column.psnr);
+
+    if (is_worse_psnr) {
+      column.has_point = true;
+      column.pts = point.pts;
+      column.has_psnr = true;
+      column.psnr = point.psnr;
+      column.psnr_is_infinite = point.psnr_is_infinite;
+    }
+    if (point.has_ssim && (!column.has_ssim || point.ssim < column.ssim)) {
+      column.has_ssim = true;
+      column.ssim = point.ssim;
+    }
+    if (point.has_vmaf && (!column.has_vmaf || point.vmaf < column.vmaf)) {
+      column.has_vmaf = true;
+      column.vmaf = point.vmaf;
+    }
+  }
+}
+
+void MetricsTimelineWindow::update_title(const MetricsTimelineSnapshot& snapshot, const float duration) {
+  std::string title = kBaseTitle;
+
+  if (snapshot.failed) {
+    title += "   (scan failed)";
+  } else if (!snapshot.complete) {
+    const float scanned = snapshot.points.empty() || duration <= 0.0F ? 0.0F : static_cast<float>(snapshot.points.back().pts * AV_TIME_TO_SEC) / duration;
+
+    title += string_sprintf("   (scanning %d%%)", static_cast<int>(std::min(scanned, 1.0F) * 100.0F));
+  }
+  if (snapshot.vmaf_failed) {
+    title += "   (VMAF failed)";
+  }
+
+  if (hover_x_ >= 0 && hover_x_ < static_cast<int>(columns_.size()) && columns_[hover_x_].has_point) {
+    const Column& column = columns_[hover_x_];
+
+    title += string_sprintf("   %s   PSNR %s", format_position(static_cast<float>(column.pts * AV_TIME_TO_SEC), false).c_str(), column.psnr_is_infinite ? "inf" : string_sprintf("%.2f dB", column.psnr).c_str());
+
+    if (column.has_ssim) {
+      title += string_sprintf("   SSIM %.4f", column.ssim);
+    }
+    if (column.has_vmaf) {
+      title += string_sprintf("   VMAF %.2f", column.vmaf);
+    }
+  }
+
+  if (title != last_window_title_) {
+    SDL_SetWindowTitle(window_, title.c_str());
+    last_window_title_ = title;
+  }
+}
+
+void MetricsTimelineWindow::render(const MetricsTimelineSnapshot& snapshot, const float duration, const int64_t position_pts) {
+  needs_redraw_ = false;
+
+  build_columns(snapshot, duration);
+  update_title(snapshot, duration);
+
+  // value ranges: PSNR and SSIM are stretched to what was measured, VMAF uses its natural scale
+  float min_psnr = std::numeric_limits<float>::max();
+  float max_psnr = std::numeric_limits<float>::lowest();
+  float min_ssim = 1.0F;
+  bool has_vmaf = false;
+
+  for (const auto& column : columns_) {
+    if (column.has_psnr && !column.psnr_is_infinite) {
+      min_psnr = std::min(min_psnr, column.psnr);
+      max_psnr = std::max(max_psnr, column.psnr);
+    }
+    if (column.has_ssim) {
+      min_ssim = std::min(min_ssim, column.ssim);
+    }
+    has_vmaf = has_vmaf || column.has_vmaf;
+  }
+
+  const float psnr_range = std::max(max_psnr - min_psnr, kMinPsnrRange);
+  const float ssim_range = std::max(1.0F - min_ssim, kMinSsimRange);
+
+  const int num_lanes = has_vmaf ? 3 : 2;
+  const int lane_height = std::max(1, (window_height_ - kPlotPad * (num_lanes + 1)) / num_lanes);
+  const int plot_width = std::max(1, window_width_ - kPlotPad * 2);
+
+  std::vector<Lane> lanes;
+  for (int i = 0; i < num_lanes; i++) {
+    lanes.push_back(Lane{SDL_Rect{kPlotPad, kPlotPad + i * (lane_height + kPlotPad), plot_width, lane_height}, i == 0 ? kPsnrColor : (i == 1 ? kSsimColor : kVmafColor)});
+  }
+
+  SDL_SetRenderDrawBlendMode(renderer_, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 255);
+  SDL_RenderClear(renderer_);
+
+  for (const auto& lane : lanes) {
+    SDL_SetRenderDrawColor(renderer_, 32, 32, 32, 255);
+    SDL_RenderFillRect(renderer_, &lane.rect);
+  }
+
+  std::vector<SDL_Point> psnr_points, ssim_points, vmaf_points;
+
+  for (int x = 0; x < static_cast<int>(columns_.size()); x++) {
+    const Column& column = columns_[x];
+
+    if (column.has_psnr) {
+      psnr_points.push_back({x, lane_y(lanes[0], column.psnr_is_infinite ? 1.0F : (column.psnr - min_psnr) / psnr_range)});
+    }
+    if (column.has_ssim) {
+      ssim_points.push_back({x, lane_y(lanes[1], (column.ssim - min_ssim) / ssim_range)});
+    }
+    if (has_vmaf && column.has_vmaf) {
+      vmaf_points.push_back({x, lane_y(lanes[2], column.vmaf / 100.0F)});
+    }
+  }
+
+  draw_series(renderer_, lanes[0], psnr_points);
+  draw_series(renderer_, lanes[1], ssim_points);
+  if (has_vmaf) {
+    draw_series(renderer_, lanes[2], vmaf_points);
+  }
+
+  // dim the part of the clip which has not been scanned yet
+  if (!snapshot.complete) {
+    const int scanned_x = snapshot.points.empty() ? kPlotPad : pts_to_x(snapshot.points.back().pts, duration) + 1;
+    const SDL_Rect pending_rect{scanned_x, 0, std::max(0, window_width_ - kPlotPad - scanned_x), window_height_};
+
+    SDL_SetRenderDrawColor(renderer_, 0, 0, 0, 128);
+    SDL_RenderFillRect(renderer_, &pending_rect);
+  }
+
+  if (hover_x_ >= kPlotPad && hover_x_ < kPlotPad + plot_width) {
+    SDL_SetRenderDrawColor(renderer_, 160, 160, 160, 160);
+    SDL_RenderDrawLine(renderer_, hover_x_, 0, hover_x_, window_height_ - 1);
+  }
+
+  const int position_x = pts_to_x(position_pts, duration);
+  const SDL_Rect position_rect{position_x - kMarkerThickness / 2, 0, kMarkerThickness, window_height_};
+
+  SDL_SetRenderDrawColor(renderer_, 255, 255, 255, 220);
+  SDL_RenderFillRect(renderer_, &position_rect);
+
+  SDL_RenderPresent(renderer_);
+}
+
+bool MetricsTimelineWindow::consume_seek_request(const float duration, int64_t& pts) {
+  if (seek_x_ < 0) {
+    return false;
+  }
+
+  const int x = seek_x_;
+  seek_x_ = -1;
+
+  // snap to the worst frame drawn nearest to the click, so that clicking a dip lands on it
+  static const int kSnapDistance = 3;
+
+  for (int distance = 0; distance <= kSnapDistance; distance++) {
+    for (const int candidate_x : {x - distance, x + distance}) {
+      if (candidate_x >= 0 && candidate_x < static_cast<int>(columns_.size()) && columns_[candidate_x].has_point) {
+        pts = columns_[candidate_x].pts;
+        return true;
+      }
+    }
+  }
+
+  const int plot_width = std::max(2, window_width_ - kPlotPad * 2);
+  const float fraction = std::min(std::max(static_cast<float>(x - kPlotPad) / static_cast<float>(plot_width - 1), 0.0F), 1.0F);
+
+  pts = static_cast<int64_t>(fraction * duration * SEC_TO_AV_TIME);
+
+  return true;
+}
+
+bool MetricsTimelineWindow::handle_event(const SDL_Event& event) {
+  const Uint32 event_window_id = SDLEventInfo::window_id(event);
+
+  // Only process events directed to this window
+  if (event_window_id == 0 || event_window_id != window_id_) {
+    return false;
+  }
+
+  switch (event.type) {
+    case SDL_WINDOWEVENT:
+      if (event.window.event == SDL_WINDOWEVENT_CLOSE) {
+        close_requested_ = true;
+      } else if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        if (event.window.data1 > 0 && event.window.data2 > 0) {
+          window_width_ = event.window.data1;
+          window_height_ = event.window.data2;
+          needs_redraw_ = true;
+        }
+      } else if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+        needs_redraw_ = true;
+      } else if (event.window.event == SDL_WINDOWEVENT_LEAVE) {
+        hover_x_ = -1;
+        dragging_ = false;
+        needs_redraw_ = true;
+      }
+      return true;
+    case SDL_MOUSEBUTTONDOWN:
+      if (event.button.button == SDL_BUTTON_LEFT) {
+        dragging_ = true;
+        seek_x_ = event.button.x;
+      }
+      return true;
+    case SDL_MOUSEBUTTONUP:
+      if (event.button.button == SDL_BUTTON_LEFT) {
+        dragging_ = false;
+      }
+      return true;
+    case SDL_MOUSEMOTION:
+      hover_x_ = event.motion.x;
+      if (dragging_) {
+        seek_x_ = event.motion.x;
+      }
+      needs_redraw_ = true;
+      return true;
+    case SDL_MOUSEWHEEL:
+      return true;
+  }
+
+  // For other events to this window that we do not explicitly handle, do not consume by default
+  return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "metrics_timeline.h"
+
+// Forward declarations to avoid leaking SDL headers outside this translation unit
+struct SDL_Window;
+struct SDL_Renderer;
+union SDL_Event;
+
+// Plots a MetricsTimelineSnapshot as stacked PSNR, SSIM and VMAF lanes over the clip duration.
+// Each pixel column shows the worst frame it covers, so that short quality dips stay visible
+// however long the clip is. Must be used from the main thread only.
+class MetricsTimelineWindow {
+ public:
+  MetricsTimelineWindow(const int width, const int height, const bool always_on_top, const int display_number);
+  ~MetricsTimelineWindow();
+
+  uint32_t window_id() const { return window_id_; }
+
+  bool close_requested() const { return close_requested_.load(); }
+
+  // Handle SDL events targeted to this window; returns true if consumed
+  bool handle_event(const SDL_Event& event);
+
+  // True if resizing, exposure or hovering calls for a redraw
+  bool needs_redraw() const { return needs_redraw_; }
+
+  // Returns true once per click or drag in the plot, with the PTS (microseconds) to seek to
+  bool consume_seek_request(const float duration, int64_t& pts);
+
+  void render(const MetricsTimelineSnapshot& snapshot, const float duration, const int64_t position_pts);
+
+ private:
+  struct Column {
+    bool has_point{false};
+    int64_t pts{0};  // of the worst (lowest PSNR) point within the column
+    bool has_psnr{false};
+    float psnr{0.0F};
+    bool psnr_is_infinite{false};
+    bool has_ssim{false};
+    float ssim{0.0F};
+    bool has_vmaf{false};
+    float vmaf{0.0F};
+  };
+
+  void build_columns(const MetricsTimelineSnapshot& snapshot, const float duration);
+
+  int pts_to_x(const int64_t pts, const float duration) const;
+
+  void update_title(const MetricsTimelineSnapshot& snapshot, const float duration);
+
+ private:
+  SDL_Window* window_{nullptr};
+  SDL_Renderer* renderer_{nullptr};
+  int window_width_{0};
+  int window_height_{0};
+  uint32_t window_id_{0};
+  std::atomic<bool> close_requested_{false};
+
+  std::string last_window_title_;
+  bool needs_redraw_{true};
+
+  int hover_x_{-1};
+  bool dragging_{false};
+  int seek_x_{-1};
+
+  std::vector<Column> columns_;
+};
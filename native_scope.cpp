@@ -0,0 +1,469 @@
+#include "native_scope.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "ffmpeg.h"
+#include "histogram_utils.h"
+#include "string_utils.h"
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+// brightness added per sample, as the intensity options of the FFmpeg filters default to
+static constexpr float WAVEFORM_INTENSITY = 0.04F;
+static constexpr float VECTORSCOPE_INTENSITY = 0.004F;
+
+// proportions of the level bars and the scale below them in each histogram band
+static constexpr int HISTOGRAM_LEVEL_HEIGHT = 200;
+static constexpr int HISTOGRAM_SCALE_HEIGHT = 12;
+
+// the histogram foreground opacity defaults to 0.7
+static constexpr int HISTOGRAM_BAR_BRIGHTNESS = 179;
+
+// the percentiles marked in the difference scope, and their colors
+static constexpr double DIFFERENCE_PERCENTILES[] = {0.50, 0.95, 0.99};
+static constexpr uint8_t DIFFERENCE_MARKER_COLORS[][3] = {{255, 255, 255}, {255, 220, 0}, {255, 64, 64}};
+
+static constexpr int FIXED_SHIFT = 16;
+
+// RGB to limited range Y'CbCr as the yuv444p conversion ahead of the FFmpeg scopes does
+struct YuvCoefficients {
+  int32_t y[3];
+  int32_t u[3];
+  int32_t v[3];
+  int32_t y_offset;
+  int32_t uv_offset;
+};
+
+// same matrices as used for the YUV to RGB conversion, so BT.601 unless specified otherwise
+static YuvCoefficients get_yuv_coefficients(const int colorspace, const int bit_depth) {
+  double kr = 0.299;
+  double kb = 0.114;
+
+  switch (colorspace) {
+    case AVCOL_SPC_BT709:
+      kr = 0.2126;
+      kb = 0.0722;
+      break;
+    case AVCOL_SPC_FCC:
+      kr = 0.30;
+      kb = 0.11;
+      break;
+    case AVCOL_SPC_SMPTE240M:
+      kr = 0.212;
+      kb = 0.087;
+      break;
+    case AVCOL_SPC_BT2020_CL:
+    case AVCOL_SPC_BT2020_NCL:
+      kr = 0.2627;
+      kb = 0.0593;
+      break;
+    default:
+      break;
+  }
+
+  const double kg = 1.0 - kr - kb;
+  const double max_value = static_cast<double>((1 << bit_depth) - 1);
+  const double y_scale = static_cast<double>(219 << (bit_depth - 8)) / max_value * (1 << FIXED_SHIFT);
+  const double uv_scale = static_cast<double>(224 << (bit_depth - 8)) / max_value * (1 << FIXED_SHIFT);
+
+  auto to_fixed = [](const double value) { return static_cast<int32_t>(value >= 0.0 ? value + 0.5 : value - 0.5); };
+
+  YuvCoefficients coefficients;
+  coefficients.y[0] = to_fixed(kr * y_scale);
+  coefficients.y[1] = to_fixed(kg * y_scale);
+  coefficients.y[2] = to_fixed(kb * y_scale);
+  coefficients.u[0] = to_fixed(-kr / (2.0 * (1.0 - kb)) * uv_scale);
+  coefficients.u[1] = to_fixed(-kg / (2.0 * (1.0 - kb)) * uv_scale);
+  coefficients.u[2] = to_fixed(0.5 * uv_scale);
+  coefficients.v[0] = to_fixed(0.5 * uv_scale);
+  coefficients.v[1] = to_fixed(-kg / (2.0 * (1.0 - kr)) * uv_scale);
+  coefficients.v[2] = to_fixed(-kb / (2.0 * (1.0 - kr)) * uv_scale);
+  coefficients.y_offset = 16 << (bit_depth - 8);
+  coefficients.uv_offset = 128 << (bit_depth - 8);
+
+  return coefficients;
+}
+
+static inline int apply_coefficients(const int32_t* coefficients, const int32_t offset, const uint16_t* rgb, const int max_value) {
+  const int32_t value = ((coefficients[0] * rgb[0] + coefficients[1] * rgb[1] + coefficients[2] * rgb[2] + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT) + offset;
+
+  return std::min(std::max(value, 0), max_value);
+}
+
+// reads every step-th of the pixels of a row span as interleaved R, G and B at the given bit depth
+static void read_rgb_span(const AVFrame* frame, const int x, const int y, const int samples, const int step, const int bit_depth, uint16_t* out) {
+  const uint8_t* row = frame->data[0] + static_cast<size_t>(y) * frame->linesize[0];
+
+  if (frame->format == AV_PIX_FMT_RGB24) {
+    const uint8_t* in = row + x * 3;
+    const int shift = bit_depth - 8;
+
+    for (int i = 0; i < samples; i++, in += step * 3) {
+      out[i * 3] = static_cast<uint16_t>(in[0] << shift);
+      out[i * 3 + 1] = static_cast<uint16_t>(in[1] << shift);
+      out[i * 3 + 2] = static_cast<uint16_t>(in[2] << shift);
+    }
+  } else if (frame->format == AV_PIX_FMT_RGB48LE) {
+    const uint16_t* in = reinterpret_cast<const uint16_t*>(row) + x * 3;
+    const int shift = 16 - bit_depth;
+
+    for (int i = 0; i < samples; i++, in += step * 3) {
+      out[i * 3] = static_cast<uint16_t>(in[0] >> shift);
+      out[i * 3 + 1] = static_cast<uint16_t>(in[1] >> shift);
+      out[i * 3 + 2] = static_cast<uint16_t>(in[2] >> shift);
+    }
+  } else {
+    const uint32_t* in = reinterpret_cast<const uint32_t*>(row) + x;
+    const int shift = 10 - bit_depth;
+
+    for (int i = 0; i < samples; i++, in += step) {
+      out[i * 3] = static_cast<uint16_t>(((in[0] >> 20) & 0x3FF) >> shift);
+      out[i * 3 + 1] = static_cast<uint16_t>(((in[0] >> 10) & 0x3FF) >> shift);
+      out[i * 3 + 2] = static_cast<uint16_t>((in[0] & 0x3FF) >> shift);
+    }
+  }
+}
+
+// differences crowd near zero, so they are laid out on a log scale
+static int difference_to_column(const float difference, const int levels, const int width) {
+  return std::min(width - 1, static_cast<int>(std::log1p(difference) / std::log1p(static_cast<float>(levels)) * width));
+}
+
+static int column_to_difference(const int column, const int levels, const int width) {
+  return static_cast<int>(std::expm1(static_cast<float>(column) / width * std::log1p(static_cast<float>(levels))));
+}
+
+NativeScope::NativeScope(const ScopeWindow::Type type, const bool use_10_bpc, const int thread_count) : type_(type), bit_depth_(use_10_bpc ? 10 : 8), row_workers_(thread_count) {}
+
+bool NativeScope::supports_format(const int format) {
+  return format == AV_PIX_FMT_RGB24 || format == AV_PIX_FMT_RGB48LE || ffmpeg::is_packed_10_bpc_rgb(format);
+}
+
+void NativeScope::accumulate(const AVFrame* frame, const ScopeWindow::Roi& roi, const int sampling_step) {
+  const size_t bin_count = static_cast<size_t>(bin_columns_) * bin_rows_;
+
+  worker_bins_.assign(bin_count * row_workers_.size(), 0u);
+  uint32_t* worker_bins_data = worker_bins_.data();
+
+  const int sampled_columns = (roi.w + sampling_step - 1) / sampling_step;
+  const int sampled_rows = (roi.h + sampling_step - 1) / sampling_step;
+
+  // waveform columns are binned by their position in the ROI
+  std::vector<int> column_bins(type_ == ScopeWindow::Type::Waveform ? sampled_columns : 0);
+
+  for (size_t i = 0; i < column_bins.size(); i++) {
+    column_bins[i] = static_cast<int>(static_cast<int64_t>(i) * sampling_step * bin_columns_ / roi.w);
+  }
+
+  const int bit_depth = bit_depth_;
+  const int max_value = (1 << bit_depth) - 1;
+  const int bin_columns = bin_columns_;
+  const int bin_rows = bin_rows_;
+  const YuvCoefficients yuv = get_yuv_coefficients(frame->colorspace, bit_depth);
+  const ScopeWindow::Type type = type_;
+  const int* column_bins_data = column_bins.data();
+
+  row_workers_.run_dynamic_indexed(
+      sampled_rows,
+      [=](const int start_row, const int end_row, const int worker_index) {
+        std::vector<uint16_t> rgb(static_cast<size_t>(sampled_columns) * 3);
+        uint32_t* bins = worker_bins_data + bin_count * worker_index;
+
+        for (int y = start_row; y < end_row; y++) {
+          read_rgb_span(frame, roi.x, roi.y + y * sampling_step, sampled_columns, sampling_step, bit_depth, rgb.data());
+
+          const uint16_t* pixel = rgb.data();
+
+          switch (type) {
+            case ScopeWindow::Type::Histogram:
+              for (int x = 0; x < sampled_columns; x++, pixel += 3) {
+                for (int component = 0; component < 3; component++) {
+                  bins[component * bin_columns + ((pixel[component] * bin_columns) >> bit_depth)]++;
+                }
+              }
+              break;
+            case ScopeWindow::Type::Waveform:
+              for (int x = 0; x < sampled_columns; x++, pixel += 3) {
+                const int luma = apply_coefficients(yuv.y, yuv.y_offset, pixel, max_value);
+
+                bins[((luma * bin_rows) >> bit_depth) * bin_columns + column_bins_data[x]]++;
+              }
+              break;
+            case ScopeWindow::Type::Vectorscope:
+              for (int x = 0; x < sampled_columns; x++, pixel += 3) {
+                const int u = apply_coefficients(yuv.u, yuv.uv_offset, pixel, max_value);
+                const int v = apply_coefficients(yuv.v, yuv.uv_offset, pixel, max_value);
+
+                bins[((v * bin_rows) >> bit_depth) * bin_columns + ((u * bin_columns) >> bit_depth)]++;
+              }
+              break;
+            case ScopeWindow::Type::Difference:
+              break;
+          }
+        }
+      },
+      suggest_block_rows_by_bytes(sampled_columns, sampled_rows, frame->format == AV_PIX_FMT_RGB24 ? 1 : 2, 3));
+
+  merge_worker_bins();
+}
+
+void NativeScope::accumulate_difference(const AVFrame* left_frame, const AVFrame* right_frame, const ScopeWindow::Roi& roi, const int sampling_step, const bool per_channel) {
+  const size_t bin_count = static_cast<size_t>(bin_columns_) * bin_rows_;
+
+  worker_bins_.assign(bin_count * row_workers_.size(), 0u);
+  uint32_t* worker_bins_data = worker_bins_.data();
+
+  const int sampled_columns = (roi.w + sampling_step - 1) / sampling_step;
+  const int sampled_rows = (roi.h + sampling_step - 1) / sampling_step;
+
+  const int bit_depth = bit_depth_;
+  const int bin_columns = bin_columns_;
+
+  row_workers_.run_dynamic_indexed(
+      sampled_rows,
+      [=](const int start_row, const int end_row, const int worker_index) {
+        std::vector<uint16_t> left_rgb(static_cast<size_t>(sampled_columns) * 3);
+        std::vector<uint16_t> right_rgb(static_cast<size_t>(sampled_columns) * 3);
+        uint32_t* bins = worker_bins_data + bin_count * worker_index;
+
+        for (int y = start_row; y < end_row; y++) {
+          read_rgb_span(left_frame, roi.x, roi.y + y * sampling_step, sampled_columns, sampling_step, bit_depth, left_rgb.data());
+          read_rgb_span(right_frame, roi.x, roi.y + y * sampling_step, sampled_columns, sampling_step, bit_depth, right_rgb.data());
+
+          const uint16_t* left_pixel = left_rgb.data();
+          const uint16_t* right_pixel = right_rgb.data();
+
+          if (per_channel) {
+            for (int x = 0; x < sampled_columns; x++, left_pixel += 3, right_pixel += 3) {
+              for (int component = 0; component < 3; component++) {
+                bins[component * bin_columns + std::abs(left_pixel[component] - right_pixel[component])]++;
+              }
+            }
+          } else {
+            // as counted for the adaptive subtraction modes
+            for (int x = 0; x < sampled_columns; x++, left_pixel += 3, right_pixel += 3) {
+              const int dr = std::abs(left_pixel[0] - right_pixel[0]);
+              const int dg = std::abs(left_pixel[1] - right_pixel[1]);
+              const int db = std::abs(left_pixel[2] - right_pixel[2]);
+
+              bins[std::max(dr, std::max(dg, db))]++;
+            }
+          }
+        }
+      },
+      suggest_block_rows_by_bytes(sampled_columns, sampled_rows, left_frame->format == AV_PIX_FMT_RGB24 ? 2 : 4, 3));
+
+  merge_worker_bins();
+}
+
+void NativeScope::merge_worker_bins() {
+  const size_t bin_count = static_cast<size_t>(bin_columns_) * bin_rows_;
+  const int bin_columns = bin_columns_;
+  const int bin_rows = bin_rows_;
+  const uint32_t* worker_bins_data = worker_bins_.data();
+
+  // a bin row each
+  bins_.resize(bin_count);
+  uint32_t* bins_data = bins_.data();
+  const int worker_count = row_workers_.size();
+
+  row_workers_.run_static(bin_rows, [=](const int start_row, const int end_row) {
+    for (size_t i = static_cast<size_t>(start_row) * bin_columns; i < static_cast<size_t>(end_row) * bin_columns; i++) {
+      uint32_t sum = 0;
+
+      for (int worker = 0; worker < worker_count; worker++) {
+        sum += worker_bins_data[bin_count * worker + i];
+      }
+
+      bins_data[i] = sum;
+    }
+  });
+}
+
+void NativeScope::draw(const AVFrame* frame, const ScopeWindow::Roi& roi, const int sampling_step, uint8_t* destination, const size_t destination_pitch, const int width, const int height) {
+  const int levels = 1 << bit_depth_;
+
+  // no finer bins than there are pixels to show them in
+  switch (type_) {
+    case ScopeWindow::Type::Histogram:
+      bin_columns_ = std::min(levels, width);
+      bin_rows_ = 3;
+      break;
+    case ScopeWindow::Type::Waveform:
+      bin_columns_ = std::min(roi.w, width);
+      bin_rows_ = std::min(levels, height);
+      break;
+    case ScopeWindow::Type::Vectorscope:
+      bin_columns_ = std::min(levels, width);
+      bin_rows_ = std::min(levels, height);
+      break;
+    case ScopeWindow::Type::Difference:
+      return;
+  }
+
+  accumulate(frame, roi, sampling_step);
+
+  // coarser bins collect the samples of several pixels of the filter output, which the scaling to
+  // the pane would average, and each sample stands for sampling_step^2 pixels
+  const float sampled_area = static_cast<float>(sampling_step * sampling_step);
+
+  switch (type_) {
+    case ScopeWindow::Type::Histogram:
+      draw_histogram(destination, destination_pitch, width, height);
+      break;
+    case ScopeWindow::Type::Waveform:
+      draw_intensity(destination, destination_pitch, width, height, 255.0F * WAVEFORM_INTENSITY * sampled_area * bin_columns_ * bin_rows_ / (static_cast<float>(roi.w) * levels));
+      break;
+    case ScopeWindow::Type::Vectorscope:
+      draw_intensity(destination, destination_pitch, width, height, 255.0F * VECTORSCOPE_INTENSITY * sampled_area * bin_columns_ * bin_rows_ / (static_cast<float>(levels) * levels));
+      break;
+    case ScopeWindow::Type::Difference:
+      break;
+  }
+}
+
+std::string NativeScope::draw_difference(const AVFrame* left_frame,
+                                         const AVFrame* right_frame,
+                                         const ScopeWindow::Roi& roi,
+                                         const int sampling_step,
+                                         const bool per_channel,
+                                         uint8_t* destination,
+                                         const size_t destination_pitch,
+                                         const int width,
+                                         const int height) {
+  // every difference gets a bin of its own, so the percentiles are exact
+  bin_columns_ = 1 << bit_depth_;
+  bin_rows_ = per_channel ? 3 : 1;
+
+  accumulate_difference(left_frame, right_frame, roi, sampling_step, per_channel);
+
+  static const char* const channel_names[] = {"R", "G", "B"};
+  std::string summary;
+
+  for (int band = 0; band < bin_rows_; band++) {
+    std::vector<float> percentiles;
+
+    for (const double fraction : DIFFERENCE_PERCENTILES) {
+      percentiles.push_back(calculate_histogram_percentile(bins_.data() + static_cast<size_t>(band) * bin_columns_, bin_columns_, fraction));
+    }
+
+    draw_difference_band(band, bin_rows_, percentiles, destination, destination_pitch, width, height);
+
+    if (per_channel) {
+      summary += string_sprintf("%s%s %.1f/%.1f/%.1f", band > 0 ? "  " : "p50/p95/p99 ", channel_names[band], percentiles[0], percentiles[1], percentiles[2]);
+    } else {
+      summary = string_sprintf("p50 %.1f  p95 %.1f  p99 %.1f", percentiles[0], percentiles[1], percentiles[2]);
+    }
+  }
+
+  return summary;
+}
+
+void NativeScope::draw_histogram(uint8_t* destination, const size_t destination_pitch, const int width, const int height) const {
+  std::vector<int> bar_heights(width);
+
+  // as the FFmpeg histogram draws gbrp: a band per plane (G, B, R from the top) with white level
+  // bars normalized to their own peak, above a scale in the color of the component
+  static constexpr int BAND_COMPONENTS[] = {1, 2, 0};
+
+  for (int band = 0; band < 3; band++) {
+    const int component = BAND_COMPONENTS[band];
+    const int band_top = band * height / 3;
+    const int band_height = (band + 1) * height / 3 - band_top;
+    const int scale_height = std::max(1, band_height * HISTOGRAM_SCALE_HEIGHT / (HISTOGRAM_LEVEL_HEIGHT + HISTOGRAM_SCALE_HEIGHT));
+    const int level_height = std::max(0, band_height - scale_height);
+
+    const uint32_t* component_bins = bins_.data() + static_cast<size_t>(component) * bin_columns_;
+    const uint32_t peak = *std::max_element(component_bins, component_bins + bin_columns_);
+
+    for (int x = 0; x < width; x++) {
+      const uint32_t count = component_bins[static_cast<int64_t>(x) * bin_columns_ / width];
+
+      bar_heights[x] = peak > 0 ? static_cast<int>(static_cast<uint64_t>(count) * level_height / peak) : 0;
+    }
+
+    for (int y = 0; y < band_height; y++) {
+      uint8_t* row = destination + static_cast<size_t>(band_top + y) * destination_pitch;
+
+      for (int x = 0; x < width; x++) {
+        if (y >= level_height) {
+          row[x * 3 + component] = static_cast<uint8_t>(width > 1 ? x * 255 / (width - 1) : 255);
+        } else if (y >= level_height - bar_heights[x]) {
+          std::memset(row + x * 3, HISTOGRAM_BAR_BRIGHTNESS, 3);
+        }
+      }
+    }
+  }
+}
+
+void NativeScope::draw_intensity(uint8_t* destination, const size_t destination_pitch, const int width, const int height, const float sample_brightness) const {
+  std::vector<int> column_bins(width);
+
+  for (int x = 0; x < width; x++) {
+    column_bins[x] = static_cast<int>(static_cast<int64_t>(x) * bin_columns_ / width);
+  }
+
+  // high levels (or V) on top
+  for (int y = 0; y < height; y++) {
+    const uint32_t* bin_row = bins_.data() + static_cast<size_t>((height - 1 - y) * static_cast<int64_t>(bin_rows_) / height) * bin_columns_;
+    uint8_t* row = destination + static_cast<size_t>(y) * destination_pitch;
+
+    for (int x = 0; x < width; x++) {
+      const uint8_t brightness = static_cast<uint8_t>(std::min(255.0F, static_cast<float>(bin_row[column_bins[x]]) * sample_brightness));
+
+      std::memset(row + x * 3, brightness, 3);
+    }
+  }
+}
+
+void NativeScope::draw_difference_band(const int band, const int band_count, const std::vector<float>& percentiles, uint8_t* destination, const size_t destination_pitch, const int width, const int height) const {
+  const int band_top = band * height / band_count;
+  const int band_height = (band + 1) * height / band_count - band_top;
+  const int scale_height = std::max(1, band_height * HISTOGRAM_SCALE_HEIGHT / (HISTOGRAM_LEVEL_HEIGHT + HISTOGRAM_SCALE_HEIGHT));
+  const int level_height = std::max(0, band_height - scale_height);
+
+  const uint32_t* band_bins = bins_.data() + static_cast<size_t>(band) * bin_columns_;
+
+  // the mean count of the differences falling into each column, with counts on a log scale too
+  std::vector<float> column_counts(width);
+
+  for (int x = 0; x < width; x++) {
+    const int first = std::min(bin_columns_ - 1, column_to_difference(x, bin_columns_, width));
+    const int last = std::max(first + 1, std::min(bin_columns_, column_to_difference(x + 1, bin_columns_, width)));
+
+    column_counts[x] = std::log1p(static_cast<float>(std::accumulate(band_bins + first, band_bins + last, uint64_t(0))) / (last - first));
+  }
+
+  const float peak = *std::max_element(column_counts.begin(), column_counts.end());
+
+  // gray for the largest channel difference, else in the color of the channel
+  auto fill = [&](uint8_t* pixel, const uint8_t value) {
+    if (band_count == 1) {
+      std::memset(pixel, value, 3);
+    } else {
+      pixel[band] = value;
+    }
+  };
+
+  for (int y = 0; y < band_height; y++) {
+    uint8_t* row = destination + static_cast<size_t>(band_top + y) * destination_pitch;
+
+    for (int x = 0; x < width; x++) {
+      if (y >= level_height) {
+        fill(row + x * 3, static_cast<uint8_t>(width > 1 ? x * 255 / (width - 1) : 255));
+      } else if (peak > 0.F && y >= level_height - static_cast<int>(column_counts[x] / peak * level_height)) {
+        fill(row + x * 3, HISTOGRAM_BAR_BRIGHTNESS);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < percentiles.size(); i++) {
+    const int x = difference_to_column(percentiles[i], bin_columns_, width);
+
+    for (int y = 0; y < level_height; y++) {
+      std::memcpy(destination + static_cast<size_t>(band_top + y) * destination_pitch + x * 3, DIFFERENCE_MARKER_COLORS[i], 3);
+    }
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "row_workers.h"
+#include "scope_window.h"
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Computes the histogram, waveform and vectorscope straight from the packed RGB frames shown in the
+// main window: the rows of the ROI are spread over the workers, each counting into its own bins,
+// which are then merged and drawn. Follows the look of the FFmpeg filters with default options.
+// The difference scope bins the absolute left/right differences the same way.
+class NativeScope {
+ public:
+  NativeScope(const ScopeWindow::Type type, const bool use_10_bpc, const int thread_count);
+
+  // True if frames in this pixel format can be computed natively
+  static bool supports_format(const int format);
+
+  // Draws the scope of the ROI of the frame into a black RGB24 area of the given size, sampling every
+  // sampling_step-th pixel of every sampling_step-th row
+  void draw(const AVFrame* frame, const ScopeWindow::Roi& roi, const int sampling_step, uint8_t* destination, const size_t destination_pitch, const int width, const int height);
+
+  // Draws the log-scaled distribution of the differences between the frames within the ROI, of the
+  // largest channel difference of each pixel or else of each channel, marking its 50th, 95th and 99th
+  // percentiles; returns the percentiles as text
+  std::string draw_difference(const AVFrame* left_frame,
+                              const AVFrame* right_frame,
+                              const ScopeWindow::Roi& roi,
+                              const int sampling_step,
+                              const bool per_channel,
+                              uint8_t* destination,
+                              const size_t destination_pitch,
+                              const int width,
+                              const int height);
+
+ private:
+  void accumulate(const AVFrame* frame, const ScopeWindow::Roi& roi, const int sampling_step);
+  void accumulate_difference(const AVFrame* left_frame, const AVFrame* right_frame, const ScopeWindow::Roi& roi, const int sampling_step, const bool per_channel);
+  void merge_worker_bins();
+
+  void draw_histogram(uint8_t* destination, const size_t destination_pitch, const int width, const int height) const;
+  void draw_intensity(uint8_t* destination, const size_t destination_pitch, const int width, const int height, const float sample_brightness) const;
+  void draw_difference_band(const int band, const int band_count, const std::vector<float>& percentiles, uint8_t* destination, const size_t destination_pitch, const int width, const int height) const;
+
+ private:
+  const ScopeWindow::Type type_;
+  const int bit_depth_;
+
+  RowWorkers row_workers_;
+
+  // bins_[row * bin_columns_ + column]: component by level for the histogram, level by ROI column
+  // for the waveform, V by U for the vectorscope and channel (or all) by difference for the difference
+  int bin_columns_{0};
+  int bin_rows_{0};
+  std::vector<uint32_t> bins_;
+  std::vector<uint32_t> worker_bins_;
+};
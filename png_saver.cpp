@@ -87,8 +87,19 @@ void PngSaver::save_with_stb(const AVFrame* frame, const std::string& filename)
   }
 }
 
+// one per saving thread, reused for as long as the frame size and formats stay the same
+struct CachedConversionContext {
+  ~CachedConversionContext() { sws_freeContext(sws_ctx); }
+
+  struct SwsContext* sws_ctx{nullptr};
+};
+
+static thread_local CachedConversionContext cached_conversion_context;
+
 AVFrame* PngSaver::convert(const AVFrame* frame, const AVPixelFormat output_format) {
-  struct SwsContext* sws_ctx = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, output_format, SWS_BILINEAR, nullptr, nullptr, nullptr);
+  struct SwsContext* sws_ctx = sws_getCachedContext(cached_conversion_context.sws_ctx, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, output_format, SWS_BILINEAR, nullptr, nullptr,
+                                                    nullptr);
+  cached_conversion_context.sws_ctx = sws_ctx;
 
   if (!sws_ctx) {
     throw EncodingException("Could not initialize the conversion context");
@@ -96,7 +107,6 @@ AVFrame* PngSaver::convert(const AVFrame* frame, const AVPixelFormat output_form
 
   AVFrame* converted_frame = av_frame_alloc();
   if (!converted_frame) {
-    sws_freeContext(sws_ctx);
     throw EncodingException("Could not allocate converted frame");
   }
 
@@ -107,6 +117,5 @@ AVFrame* PngSaver::convert(const AVFrame* frame, const AVPixelFormat output_form
 
   sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height, converted_frame->data, converted_frame->linesize);
 
-  sws_freeContext(sws_ctx);
   return converted_frame;
 }
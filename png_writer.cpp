@@ -0,0 +1,297 @@
+#include "png_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+#include "png_saver.h"
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+// filtered bytes per band; large enough for the bands to compress nearly as well as one stream
+static constexpr size_t BAND_BYTES = 1 << 20;
+
+// the deflate window, which each band is primed with from the end of the band before it
+static constexpr size_t WINDOW_SIZE = 1 << 15;
+
+static const uint8_t PNG_SIGNATURE[] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+static void append_u32(std::vector<uint8_t>& out, const uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// a complete chunk of the given type and data
+static void append_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, const size_t size) {
+  append_u32(out, static_cast<uint32_t>(size));
+
+  const size_t type_offset = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + size);
+
+  append_u32(out, static_cast<uint32_t>(crc32(0, out.data() + type_offset, static_cast<uInt>(size + 4))));
+}
+
+// Raw-deflates a band with the given preceding data as the dictionary. All but the last band end
+// with a sync flush, on a byte boundary and without a final block, so the bands concatenate.
+// Returns false if zlib fails.
+static bool deflate_band(z_stream& stream, const uint8_t* dictionary, const size_t dictionary_size, const uint8_t* data, const size_t size, const bool is_last, std::vector<uint8_t>& out) {
+  if (deflateReset(&stream) != Z_OK || (dictionary_size > 0 && deflateSetDictionary(&stream, dictionary, static_cast<uInt>(dictionary_size)) != Z_OK)) {
+    return false;
+  }
+
+  out.resize(deflateBound(&stream, size) + 16);
+
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = out.data();
+  stream.avail_out = static_cast<uInt>(out.size());
+
+  // the margin covers the flush marker, so this takes a single call unless the buffer fills up exactly
+  for (;;) {
+    const int result = deflate(&stream, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+
+    if (is_last ? result == Z_STREAM_END : (result == Z_BUF_ERROR || (result == Z_OK && stream.avail_out > 0))) {
+      break;
+    }
+    if (result != Z_OK) {
+      return false;
+    }
+
+    const size_t written = out.size() - stream.avail_out;
+
+    out.resize(out.size() * 2);
+    stream.next_out = out.data() + written;
+    stream.avail_out = static_cast<uInt>(out.size() - written);
+  }
+
+  out.resize(out.size() - stream.avail_out);
+
+  return true;
+}
+
+// the PNG filters of RFC 2083, on a row of bytes with the row above
+static void apply_filter(const int type, const uint8_t* row, const uint8_t* above, const int size, const int pixel_bytes, uint8_t* out) {
+  // the first pixel has no left neighbor, which the filters then treat as zero
+  const int first = std::min(pixel_bytes, size);
+
+  switch (type) {
+    case 1:
+      std::memcpy(out, row, first);
+      for (int i = first; i < size; i++) {
+        out[i] = static_cast<uint8_t>(row[i] - row[i - pixel_bytes]);
+      }
+      break;
+    case 2:
+      for (int i = 0; i < size; i++) {
+        out[i] = static_cast<uint8_t>(row[i] - above[i]);
+      }
+      break;
+    case 3:
+      for (int i = 0; i < first; i++) {
+        out[i] = static_cast<uint8_t>(row[i] - (above[i] >> 1));
+      }
+      for (int i = first; i < size; i++) {
+        out[i] = static_cast<uint8_t>(row[i] - ((row[i - pixel_bytes] + above[i]) >> 1));
+      }
+      break;
+    case 4:
+      // the Paeth predictor is the row above where there is no left neighbor
+      for (int i = 0; i < first; i++) {
+        out[i] = static_cast<uint8_t>(row[i] - above[i]);
+      }
+      for (int i = first; i < size; i++) {
+        const int left = row[i - pixel_bytes];
+        const int up = above[i];
+        const int up_left = above[i - pixel_bytes];
+        const int pa = std::abs(up - up_left);
+        const int pb = std::abs(left - up_left);
+        const int pc = std::abs(left + up - 2 * up_left);
+
+        out[i] = static_cast<uint8_t>(row[i] - ((pa <= pb && pa <= pc) ? left : (pb <= pc ? up : up_left)));
+      }
+      break;
+    default:
+      std::memcpy(out, row, size);
+      break;
+  }
+}
+
+// the row in PNG byte order (big-endian samples)
+static void load_row(const uint8_t* pixels, const size_t pitch, const int y, const int row_bytes, const bool is_16_bit, uint8_t* out) {
+  const uint8_t* in = pixels + static_cast<size_t>(y) * pitch;
+
+  if (is_16_bit) {
+    for (int i = 0; i < row_bytes; i += 2) {
+      out[i] = in[i + 1];
+      out[i + 1] = in[i];
+    }
+  } else {
+    std::memcpy(out, in, row_bytes);
+  }
+}
+
+PngWriter::PngWriter(const int thread_count, const int compression_level) : row_workers_(thread_count), compression_level_(std::min(std::max(compression_level, 0), MAX_COMPRESSION_LEVEL)) {}
+
+bool PngWriter::supports_format(const int format) {
+  return format == AV_PIX_FMT_RGB24 || format == AV_PIX_FMT_RGB48LE;
+}
+
+void PngWriter::write(const AVFrame* frame, const std::string& filename) {
+  const std::vector<uint8_t> png = encode(frame->data[0], frame->linesize[0], frame->width, frame->height, frame->format == AV_PIX_FMT_RGB48LE);
+
+  try {
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+      throw PngSaver::IOException("Could not open file: " + filename);
+    }
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    file.close();
+  } catch (const std::ios_base::failure& e) {
+    throw PngSaver::IOException("IO error while writing file " + filename + ": " + e.what());
+  }
+}
+
+std::vector<uint8_t> PngWriter::encode(const uint8_t* pixels, const size_t pitch, const int width, const int height, const bool is_16_bit) {
+  const int pixel_bytes = is_16_bit ? 6 : 3;
+  const int row_bytes = width * pixel_bytes;
+  const size_t filtered_row_bytes = static_cast<size_t>(row_bytes) + 1;
+  const int band_rows = static_cast<int>(std::max<size_t>(1, BAND_BYTES / filtered_row_bytes));
+  const int band_count = (height + band_rows - 1) / band_rows;
+  const int compression_level = compression_level_;
+
+  // the rows ahead of a band whose filtered data fill the window
+  const int window_rows = static_cast<int>((WINDOW_SIZE + filtered_row_bytes - 1) / filtered_row_bytes);
+
+  // each band as a complete IDAT chunk, and the checksum of its filtered data
+  std::vector<std::vector<uint8_t>> band_chunks(band_count);
+  std::vector<uint32_t> band_adlers(band_count);
+  std::vector<size_t> band_sizes(band_count);
+
+  // reported by the calling thread, as the workers cannot throw
+  std::atomic_bool failed{false};
+
+  row_workers_.run_dynamic(
+      band_count,
+      [&](const int start_band, const int end_band) {
+        std::vector<uint8_t> above(row_bytes);
+        std::vector<uint8_t> row(row_bytes);
+        std::vector<uint8_t> candidate(row_bytes);
+        std::vector<uint8_t> filtered;
+        std::vector<uint8_t> compressed;
+
+        z_stream stream{};
+
+        if (deflateInit2(&stream, compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+          failed = true;
+          return;
+        }
+
+        for (int band = start_band; band < end_band && !failed; band++) {
+          const int start_row = band * band_rows;
+          const int end_row = std::min(height, start_row + band_rows);
+
+          // the end of the band before is filtered again, as the dictionary (like pigz primes each block)
+          const int first_row = std::max(0, start_row - window_rows);
+
+          // the row above the first, or zeros for the top of the image
+          if (first_row > 0) {
+            load_row(pixels, pitch, first_row - 1, row_bytes, is_16_bit, above.data());
+          } else {
+            std::fill(above.begin(), above.end(), 0);
+          }
+
+          filtered.resize(filtered_row_bytes * (end_row - first_row));
+          uint8_t* out = filtered.data();
+
+          for (int y = first_row; y < end_row; y++, out += filtered_row_bytes) {
+            load_row(pixels, pitch, y, row_bytes, is_16_bit, row.data());
+
+            // the filter with the least sum of absolute values, as libpng chooses by default
+            int best_filter = 0;
+
+            if (compression_level > 0) {
+              uint64_t best_sum = UINT64_MAX;
+
+              for (int filter = 0; filter < 5; filter++) {
+                apply_filter(filter, row.data(), above.data(), row_bytes, pixel_bytes, candidate.data());
+
+                uint64_t sum = 0;
+                for (int i = 0; i < row_bytes; i++) {
+                  sum += std::abs(static_cast<int8_t>(candidate[i]));
+                }
+
+                if (sum < best_sum) {
+                  best_sum = sum;
+                  best_filter = filter;
+                  std::memcpy(out + 1, candidate.data(), row_bytes);
+                }
+              }
+            } else {
+              apply_filter(0, row.data(), above.data(), row_bytes, pixel_bytes, out + 1);
+            }
+
+            out[0] = static_cast<uint8_t>(best_filter);
+
+            std::swap(above, row);
+          }
+
+          const size_t band_offset = filtered_row_bytes * (start_row - first_row);
+          const size_t dictionary_size = std::min(band_offset, WINDOW_SIZE);
+          const uint8_t* band_data = filtered.data() + band_offset;
+          const size_t band_size = filtered.size() - band_offset;
+
+          if (!deflate_band(stream, band_data - dictionary_size, dictionary_size, band_data, band_size, band == band_count - 1, compressed)) {
+            failed = true;
+            break;
+          }
+
+          append_chunk(band_chunks[band], "IDAT", compressed.data(), compressed.size());
+          band_adlers[band] = static_cast<uint32_t>(adler32(1, band_data, static_cast<uInt>(band_size)));
+          band_sizes[band] = band_size;
+        }
+
+        deflateEnd(&stream);
+      },
+      1);
+
+  if (failed) {
+    throw PngSaver::EncodingException("Failed to deflate PNG image data");
+  }
+
+  std::vector<uint8_t> png(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+  std::vector<uint8_t> header;
+  append_u32(header, static_cast<uint32_t>(width));
+  append_u32(header, static_cast<uint32_t>(height));
+  header.push_back(is_16_bit ? 16 : 8);  // bit depth
+  header.push_back(2);                   // color type: RGB
+  header.push_back(0);                   // compression method
+  header.push_back(0);                   // filter method
+  header.push_back(0);                   // no interlacing
+  append_chunk(png, "IHDR", header.data(), header.size());
+
+  // the zlib header and checksum go into IDAT chunks of their own, as the bands are compressed in parallel
+  static const uint8_t zlib_level_flags[] = {0x01, 0x01, 0x5E, 0x5E, 0x5E, 0x5E, 0x9C, 0xDA, 0xDA, 0xDA};
+  const uint8_t zlib_header[] = {0x78, zlib_level_flags[compression_level]};
+  append_chunk(png, "IDAT", zlib_header, sizeof(zlib_header));
+
+  uint32_t adler = 1;
+
+  for (int band = 0; band < band_count; band++) {
+    png.insert(png.end(), band_chunks[band].begin(), band_chunks[band].end());
+    adler = static_cast<uint32_t>(adler32_combine(adler, band_adlers[band], static_cast<z_off_t>(band_sizes[band])));
+  }
+
+  std::vector<uint8_t> trailer;
+  append_u32(trailer, adler);
+  append_chunk(png, "IDAT", trailer.data(), trailer.size());
+
+  append_chunk(png, "IEND", nullptr, 0);
+
+  return png;
+}
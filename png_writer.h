@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "row_workers.h"
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Writes RGB24 and RGB48LE frames as PNG files, filtering and deflating bands of rows on the
+// workers. As pigz does, each band is a raw zlib deflate primed with the last 32 KiB of the band
+// before it, and a sync flush ends it on a byte boundary without a final block, so the bands
+// concatenate into one valid zlib stream. The IDAT chunk of each band is checksummed on its worker
+// too, leaving only the writing to the calling thread.
+class PngWriter {
+ public:
+  static constexpr int MAX_COMPRESSION_LEVEL = 9;
+
+  // Levels range from 0 (stored, fastest) to MAX_COMPRESSION_LEVEL (smallest)
+  PngWriter(const int thread_count, const int compression_level);
+
+  static bool supports_format(const int format);
+
+  // Throws PngSaver::IOException if the file cannot be written
+  void write(const AVFrame* frame, const std::string& filename);
+
+  // The PNG file contents for packed RGB pixels with 8 or 16 (little-endian) bits per component
+  std::vector<uint8_t> encode(const uint8_t* pixels, const size_t pitch, const int width, const int height, const bool is_16_bit);
+
+ private:
+  RowWorkers row_workers_;
+  const int compression_level_;
+};
@@ -0,0 +1,287 @@
+#include "quality_metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include "row_workers.h"
+#include "string_utils.h"
+extern "C" {
+#include <libavutil/common.h>
+#include <libavutil/pixdesc.h>
+}
+
+static constexpr int SSIM_WINDOW_SIZE = 8;
+static constexpr int SSIM_WINDOW_STEP = 4;
+
+namespace {
+
+struct PlaneView {
+  const uint8_t* distorted;
+  const uint8_t* reference;
+  int distorted_linesize;
+  int reference_linesize;
+  int x;
+  int width;
+  int height;
+  int shift;
+  int max_code;
+};
+
+template <typename T>
+inline int load_sample(const uint8_t* row, const int x, const int shift, const int max_code) {
+  return (reinterpret_cast<const T*>(row)[x] >> shift) & max_code;
+}
+
+template <typename T>
+uint64_t sum_squared_error(const PlaneView& view, const int start_row, const int end_row) {
+  uint64_t sse = 0;
+
+  for (int y = start_row; y < end_row; y++) {
+    const uint8_t* distorted_row = view.distorted + static_cast<ptrdiff_t>(y) * view.distorted_linesize;
+    const uint8_t* reference_row = view.reference + static_cast<ptrdiff_t>(y) * view.reference_linesize;
+
+    uint64_t row_sse = 0;
+
+    for (int x = view.x; x < (view.x + view.width); x++) {
+      const int64_t diff = load_sample<T>(distorted_row, x, view.shift, view.max_code) - load_sample<T>(reference_row, x, view.shift, view.max_code);
+      row_sse += static_cast<uint64_t>(diff * diff);
+    }
+
+    sse += row_sse;
+  }
+
+  return sse;
+}
+
+// classic 8x8 windows with 4 samples of overlap (same layout as ffmpeg's ssim filter)
+template <typename T>
+double sum_ssim_windows(const PlaneView& view, const int start_window_row, const int end_window_row) {
+  const double c1 = (0.01 * view.max_code) * (0.01 * view.max_code);
+  const double c2 = (0.03 * view.max_code) * (0.03 * view.max_code);
+  const double inv_n = 1.0 / (SSIM_WINDOW_SIZE * SSIM_WINDOW_SIZE);
+
+  double ssim_sum = 0.0;
+
+  for (int window_row = start_window_row; window_row < end_window_row; window_row++) {
+    const int y_offset = window_row * SSIM_WINDOW_STEP;
+
+    for (int x_offset = view.x; x_offset <= (view.x + view.width - SSIM_WINDOW_SIZE); x_offset += SSIM_WINDOW_STEP) {
+      int64_t sum1 = 0, sum2 = 0;
+      uint64_t sum_sq1 = 0, sum_sq2 = 0, sum_12 = 0;
+
+      for (int y = y_offset; y < (y_offset + SSIM_WINDOW_SIZE); y++) {
+        const uint8_t* distorted_row = view.distorted + static_cast<ptrdiff_t>(y) * view.distorted_linesize;
+        const uint8_t* reference_row = view.reference + static_cast<ptrdiff_t>(y) * view.reference_linesize;
+
+        for (int x = x_offset; x < (x_offset + SSIM_WINDOW_SIZE); x++) {
+          const uint64_t a = load_sample<T>(distorted_row, x, view.shift, view.max_code);
+          const uint64_t b = load_sample<T>(reference_row, x, view.shift, view.max_code);
+
+          sum1 += a;
+          sum2 += b;
+          sum_sq1 += a * a;
+          sum_sq2 += b * b;
+          sum_12 += a * b;
+        }
+      }
+
+      const double mean1 = sum1 * inv_n;
+      const double mean2 = sum2 * inv_n;
+      const double variance1 = sum_sq1 * inv_n - mean1 * mean1;
+      const double variance2 = sum_sq2 * inv_n - mean2 * mean2;
+      const double covariance = sum_12 * inv_n - mean1 * mean2;
+
+      ssim_sum += ((2.0 * mean1 * mean2 + c1) * (2.0 * covariance + c2)) / ((mean1 * mean1 + mean2 * mean2 + c1) * (variance1 + variance2 + c2));
+    }
+  }
+
+  return ssim_sum;
+}
+
+template <typename T>
+void compute_plane_metrics(const PlaneView& view, const RowWorkers& row_workers, PlaneQualityMetrics& plane_metrics) {
+  std::vector<uint64_t> sse_per_worker(row_workers.size(), 0);
+
+  row_workers.run_dynamic_indexed(view.height, [&](const int start_row, const int end_row, const int worker_index) { sse_per_worker[worker_index] += sum_squared_error<T>(view, start_row, end_row); }, 64);
+
+  uint64_t sse = 0;
+  for (const uint64_t worker_sse : sse_per_worker) {
+    sse += worker_sse;
+  }
+
+  plane_metrics.mse = static_cast<double>(sse) / (static_cast<double>(view.width) * static_cast<double>(view.height));
+
+  const int windows_x = view.width >= SSIM_WINDOW_SIZE ? (view.width - SSIM_WINDOW_SIZE) / SSIM_WINDOW_STEP + 1 : 0;
+  const int windows_y = view.height >= SSIM_WINDOW_SIZE ? (view.height - SSIM_WINDOW_SIZE) / SSIM_WINDOW_STEP + 1 : 0;
+
+  plane_metrics.has_ssim = windows_x > 0 && windows_y > 0;
+
+  if (plane_metrics.has_ssim) {
+    std::vector<double> ssim_sum_per_worker(row_workers.size(), 0.0);
+
+    row_workers.run_dynamic_indexed(windows_y, [&](const int start_row, const int end_row, const int worker_index) { ssim_sum_per_worker[worker_index] += sum_ssim_windows<T>(view, start_row, end_row); }, 8);
+
+    double ssim_sum = 0.0;
+    for (const double worker_ssim_sum : ssim_sum_per_worker) {
+      ssim_sum += worker_ssim_sum;
+    }
+
+    plane_metrics.ssim = ssim_sum / (static_cast<double>(windows_x) * static_cast<double>(windows_y));
+  }
+}
+
+double mse_to_psnr(const double mse, const int max_code) {
+  return 10.0 * log10(static_cast<double>(max_code) * max_code / mse);
+}
+
+std::string format_psnr_value(const double mse, const double psnr) {
+  return mse == 0.0 ? "inf" : string_sprintf("%.3f", psnr);
+}
+
+}  // namespace
+
+bool supports_native_quality_metrics(const AVPixelFormat pixel_format) {
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pixel_format);
+
+  if (desc == nullptr || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_FLOAT | AV_PIX_FMT_FLAG_BE)) != 0) {
+    return false;
+  }
+
+  const int num_color_components = (desc->flags & AV_PIX_FMT_FLAG_ALPHA) ? desc->nb_components - 1 : desc->nb_components;
+
+  if (num_color_components != 1 && num_color_components != 3) {
+    return false;
+  }
+
+  for (int c = 0; c < num_color_components; c++) {
+    const AVComponentDescriptor& comp = desc->comp[c];
+    const int bytes_per_sample = (comp.depth + comp.shift) > 8 ? 2 : 1;
+
+    if (comp.depth > 16 || comp.step != bytes_per_sample || comp.offset != 0) {
+      return false;
+    }
+    for (int other = 0; other < c; other++) {
+      if (desc->comp[other].plane == comp.plane) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool can_compute_native_quality_metrics(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
+  if (distorted_frame->format != reference_frame->format || distorted_frame->width != reference_frame->width || distorted_frame->height != reference_frame->height) {
+    return false;
+  }
+
+  return supports_native_quality_metrics(static_cast<AVPixelFormat>(distorted_frame->format));
+}
+
+bool compute_native_quality_metrics(const AVFrame* distorted_frame, const AVFrame* reference_frame, const QualityMetricsRoi& roi, const RowWorkers& row_workers, QualityMetrics& metrics) {
+  if (!can_compute_native_quality_metrics(distorted_frame, reference_frame)) {
+    return false;
+  }
+
+  const AVPixelFormat pixel_format = static_cast<AVPixelFormat>(distorted_frame->format);
+
+  const int x0 = std::max(0, std::min(roi.x, distorted_frame->width - 1));
+  const int y0 = std::max(0, std::min(roi.y, distorted_frame->height - 1));
+  const int x1 = std::max(x0 + 1, std::min(roi.x + roi.w, distorted_frame->width));
+  const int y1 = std::max(y0 + 1, std::min(roi.y + roi.h, distorted_frame->height));
+
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pixel_format);
+  const bool is_rgb = (desc->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+  const int num_color_components = (desc->flags & AV_PIX_FMT_FLAG_ALPHA) ? desc->nb_components - 1 : desc->nb_components;
+
+  metrics = QualityMetrics();
+  metrics.pixel_format_name = av_get_pix_fmt_name(pixel_format);
+  metrics.bit_depth = desc->comp[0].depth;
+  metrics.has_ssim = true;
+
+  double total_samples = 0.0;
+  double weighted_mse = 0.0;
+  double weighted_ssim = 0.0;
+
+  for (int c = 0; c < num_color_components; c++) {
+    const AVComponentDescriptor& comp = desc->comp[c];
+    const bool is_chroma = !is_rgb && (c == 1 || c == 2);
+    const int log2_w = is_chroma ? desc->log2_chroma_w : 0;
+    const int log2_h = is_chroma ? desc->log2_chroma_h : 0;
+
+    // chroma windows cover every chroma sample touched by the luma ROI
+    const int plane_x0 = x0 >> log2_w;
+    const int plane_y0 = y0 >> log2_h;
+    const int plane_x1 = AV_CEIL_RSHIFT(x1, log2_w);
+    const int plane_y1 = AV_CEIL_RSHIFT(y1, log2_h);
+
+    PlaneView view;
+    view.distorted = distorted_frame->data[comp.plane] + static_cast<ptrdiff_t>(plane_y0) * distorted_frame->linesize[comp.plane];
+    view.reference = reference_frame->data[comp.plane] + static_cast<ptrdiff_t>(plane_y0) * reference_frame->linesize[comp.plane];
+    view.distorted_linesize = distorted_frame->linesize[comp.plane];
+    view.reference_linesize = reference_frame->linesize[comp.plane];
+    view.x = plane_x0;
+    view.width = plane_x1 - plane_x0;
+    view.height = plane_y1 - plane_y0;
+    view.shift = comp.shift;
+    view.max_code = (1 << comp.depth) - 1;
+
+    PlaneQualityMetrics plane_metrics{};
+    plane_metrics.label = num_color_components == 1 ? 'y' : (is_rgb ? "rgb"[c] : "yuv"[c]);
+    plane_metrics.width = view.width;
+    plane_metrics.height = view.height;
+
+    if (comp.step == 2) {
+      compute_plane_metrics<uint16_t>(view, row_workers, plane_metrics);
+    } else {
+      compute_plane_metrics<uint8_t>(view, row_workers, plane_metrics);
+    }
+
+    plane_metrics.psnr = mse_to_psnr(plane_metrics.mse, view.max_code);
+
+    const double num_samples = static_cast<double>(view.width) * static_cast<double>(view.height);
+    total_samples += num_samples;
+    weighted_mse += plane_metrics.mse * num_samples;
+    weighted_ssim += plane_metrics.ssim * num_samples;
+    metrics.has_ssim = metrics.has_ssim && plane_metrics.has_ssim;
+
+    metrics.planes.push_back(plane_metrics);
+  }
+
+  metrics.mse_average = weighted_mse / total_samples;
+  metrics.psnr_average = mse_to_psnr(metrics.mse_average, (1 << metrics.bit_depth) - 1);
+  metrics.ssim_average = weighted_ssim / total_samples;
+
+  return true;
+}
+
+std::string QualityMetrics::format_psnr() const {
+  if (planes.size() == 1) {
+    return format_psnr_value(planes[0].mse, planes[0].psnr);
+  }
+
+  std::string result;
+
+  for (const auto& plane : planes) {
+    result += string_sprintf("%c:%s ", plane.label, format_psnr_value(plane.mse, plane.psnr).c_str());
+  }
+
+  return result + "avg:" + format_psnr_value(mse_average, psnr_average);
+}
+
+std::string QualityMetrics::format_ssim() const {
+  if (!has_ssim) {
+    return "n/a";
+  }
+  if (planes.size() == 1) {
+    return string_sprintf("%.5f", planes[0].ssim);
+  }
+
+  std::string result;
+
+  for (const auto& plane : planes) {
+    result += string_sprintf("%c:%.5f ", std::toupper(plane.label), plane.ssim);
+  }
+
+  return result + string_sprintf("All:%.5f", ssim_average);
+}
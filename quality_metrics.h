@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+class RowWorkers;
+
+struct QualityMetricsRoi {
+  int x;
+  int y;
+  int w;
+  int h;
+};
+
+struct PlaneQualityMetrics {
+  char label;
+  int width;
+  int height;
+  double mse;
+  double psnr;
+  double ssim;
+  bool has_ssim;
+};
+
+// PSNR/SSIM per plane at native bit depth, reported the same way as ffmpeg's psnr/ssim filters
+// (the combined value weights each plane by its sample count)
+struct QualityMetrics {
+  std::string pixel_format_name;
+  int bit_depth{0};
+  std::vector<PlaneQualityMetrics> planes;
+  double mse_average{0.0};
+  double psnr_average{0.0};
+  double ssim_average{0.0};
+  bool has_ssim{false};
+
+  std::string format_psnr() const;
+  std::string format_ssim() const;
+};
+
+// True for integer formats that store every (non-alpha) component in its own plane
+bool supports_native_quality_metrics(const AVPixelFormat pixel_format);
+
+// True if both frames share dimensions and a supported pixel format
+bool can_compute_native_quality_metrics(const AVFrame* distorted_frame, const AVFrame* reference_frame);
+
+// Compares the region of interest (in frame coordinates, luma samples) of two frames that share
+// dimensions and pixel format. Returns false if the frames cannot be compared natively.
+bool compute_native_quality_metrics(const AVFrame* distorted_frame, const AVFrame* reference_frame, const QualityMetricsRoi& roi, const RowWorkers& row_workers, QualityMetrics& metrics);
@@ -1,6 +1,7 @@
 #include "scope_manager.h"
 #include <SDL2/SDL.h>
 #include <algorithm>
+#include <stdexcept>
 #include <utility>
 #include "scope_window.h"
 #include "sdl_event_info.h"
@@ -13,12 +14,19 @@ static const std::string& get_scope_filter_options(const ScopesConfig& config, c
       return config.vectorscope_options;
     case ScopeWindow::Type::Waveform:
       return config.waveform_options;
+    case ScopeWindow::Type::Difference: {
+      static const std::string no_options;
+      return no_options;
+    }
   }
   return config.histogram_options;
 }
 
+// each job already spreads its rows over the scope's own workers, so a couple of jobs in flight are enough
+static constexpr size_t EXECUTOR_THREAD_COUNT = 2;
+
 static std::unique_ptr<ScopeWindow> make_scope_window(const ScopesConfig& config, bool use_10_bpc, int display_number, ScopeWindow::Type type) {
-  return std::make_unique<ScopeWindow>(type, config.width / 2, config.height, config.always_on_top, display_number, use_10_bpc, get_scope_filter_options(config, type));
+  return std::make_unique<ScopeWindow>(type, config.width / 2, config.height, config.always_on_top, display_number, use_10_bpc, get_scope_filter_options(config, type), config.max_samples, config.difference_per_channel);
 }
 
 ScopeManager::ScopeManager(const ScopesConfig& config, const bool use_10_bpc, const int display_number) : use_10_bpc_(use_10_bpc), display_number_(display_number), config_(config) {
@@ -28,19 +36,34 @@ ScopeManager::ScopeManager(const ScopesConfig& config, const bool use_10_bpc, co
     }
     const size_t idx = ScopeWindow::index(type);
     create_window(idx);
-    start_worker(idx);
+    open_slot(idx);
   };
 
+  for (size_t i = 0; i < EXECUTOR_THREAD_COUNT; ++i) {
+    executor_threads_.emplace_back(&ScopeManager::run_executor, this);
+  }
+
   maybe_add(config.histogram, ScopeWindow::Type::Histogram);
   maybe_add(config.vectorscope, ScopeWindow::Type::Vectorscope);
   maybe_add(config.waveform, ScopeWindow::Type::Waveform);
+  maybe_add(config.difference, ScopeWindow::Type::Difference);
 }
 
 ScopeManager::~ScopeManager() {
   for (size_t idx = 0; idx < ScopeWindow::kNumScopes; ++idx) {
-    stop_worker(idx);
+    close_slot(idx);
     destroy_window(idx);
   }
+
+  {
+    std::lock_guard<std::mutex> lk(jobs_mutex_);
+    stop_executor_ = true;
+  }
+  job_available_cv_.notify_all();
+
+  for (auto& thread : executor_threads_) {
+    thread.join();
+  }
 }
 
 std::string ScopeManager::fatal_error_message() const {
@@ -76,20 +99,20 @@ bool ScopeManager::request_toggle(ScopeWindow::Type type) {
   const size_t idx = ScopeWindow::index(type);
   if (windows_[idx]) {
     // Close existing
-    stop_worker(idx);
+    close_slot(idx);
     destroy_window(idx);
     return false;
   } else {
     create_window(idx);
-    start_worker(idx);
+    open_slot(idx);
     return true;
   }
 }
 
-void ScopeManager::set_roi(const ScopeWindow::Roi& roi) {
+void ScopeManager::set_roi(const ScopeWindow::Roi& roi, const int video_width, const int video_height) {
   for (auto& window : windows_) {
     if (window) {
-      window->set_roi(roi);
+      window->set_roi(roi, video_width, video_height);
     }
   }
 }
@@ -97,52 +120,46 @@ void ScopeManager::set_roi(const ScopeWindow::Roi& roi) {
 void ScopeManager::reconcile() {
   for (size_t idx = 0; idx < windows_.size(); ++idx) {
     auto& window = windows_[idx];
-    auto& worker = workers_[idx];
     if (window && window->close_requested()) {
-      stop_worker(idx);
+      close_slot(idx);
       destroy_window(idx);
-      continue;
-    }
-    if (window && !worker) {
-      start_worker(idx);
-    } else if (!window && worker) {
-      stop_worker(idx);
     }
   }
 }
 
-void ScopeManager::submit_jobs(const AVFrame* left_frame, const AVFrame* right_frame) {
+void ScopeManager::submit_jobs(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key) {
   for (size_t idx = 0; idx < windows_.size(); ++idx) {
-    auto& window = windows_[idx];
-    auto& worker = workers_[idx];
-    if (window && worker) {
-      std::lock_guard<std::mutex> lk(worker->mutex_);
-      worker->left_frame_ = left_frame;
-      worker->right_frame_ = right_frame;
-      worker->job_seq_++;
-      worker->has_job_ = true;
-      last_submitted_seq_[idx] = worker->job_seq_;
-      worker->cv_.notify_all();
-    } else {
-      last_submitted_seq_[idx] = 0;
+    if (!windows_[idx]) {
+      continue;
     }
-  }
-}
 
-void ScopeManager::wait_all() {
-  for (size_t idx = 0; idx < workers_.size(); ++idx) {
-    auto& worker = workers_[idx];
-    const uint64_t target_seq = last_submitted_seq_[idx];
-    if (worker && target_seq != 0) {
-      std::unique_lock<std::mutex> lk(worker->mutex_);
-      worker->cv_.wait(lk, [&]() { return worker->done_seq_ >= target_seq || worker->stop_; });
+    Job job;
+    job.left_frame_ = av_frame_clone(left_frame);
+    job.right_frame_ = av_frame_clone(right_frame);
+    job.sources_key_ = sources_key;
+
+    if (job.left_frame_ == nullptr || job.right_frame_ == nullptr) {
+      free_job(job);
+      throw std::runtime_error("av_frame_clone failed (scope job)");
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(jobs_mutex_);
+      JobSlot& slot = slots_[idx];
+
+      // latest wins: a pair superseded before its job started is never computed
+      std::swap(slot.job_, job);
+      slot.has_job_ = true;
     }
+    free_job(job);
   }
+
+  job_available_cv_.notify_all();
 }
 
-void ScopeManager::render_all() {
+void ScopeManager::render_ready() {
   for (auto& window : windows_) {
-    if (window) {
+    if (window && window->has_update()) {
       window->render();
     }
   }
@@ -175,65 +192,82 @@ void ScopeManager::destroy_window(const size_t idx) {
   windows_[idx].reset();
 }
 
-void ScopeManager::start_worker(const size_t idx) {
-  if (workers_[idx]) {
-    return;
+void ScopeManager::free_job(Job& job) {
+  av_frame_free(&job.left_frame_);
+  av_frame_free(&job.right_frame_);
+  job.sources_key_.clear();
+}
+
+void ScopeManager::open_slot(const size_t idx) {
+  std::lock_guard<std::mutex> lk(jobs_mutex_);
+  slots_[idx].open_ = true;
+}
+
+void ScopeManager::close_slot(const size_t idx) {
+  std::unique_lock<std::mutex> lk(jobs_mutex_);
+  JobSlot& slot = slots_[idx];
+
+  slot.open_ = false;
+  if (slot.has_job_) {
+    free_job(slot.job_);
+    slot.has_job_ = false;
   }
-  workers_[idx] = std::make_unique<WorkerState>();
-  auto* worker_state = workers_[idx].get();
-  worker_state->thread_ = std::thread([this, idx, worker_state]() {
-    while (true) {
-      const AVFrame* left_frame_local = nullptr;
-      const AVFrame* right_frame_local = nullptr;
-      uint64_t seq = 0;
-      {
-        std::unique_lock<std::mutex> lk(worker_state->mutex_);
-        worker_state->cv_.wait(lk, [&]() { return worker_state->has_job_ || worker_state->stop_; });
-        if (worker_state->stop_) {
-          break;
-        }
-        left_frame_local = worker_state->left_frame_;
-        right_frame_local = worker_state->right_frame_;
-        seq = worker_state->job_seq_;
-        worker_state->has_job_ = false;
-      }
-      auto& win = windows_[idx];
-      if (win) {
-        try {
-          if (!win->close_requested()) {
-            win->prepare(left_frame_local, right_frame_local);
-          }
-        } catch (const std::exception& e) {
-          set_fatal_error(std::string("Scope filtergraph error (") + ScopeWindow::type_to_string(win->get_type()) + "): " + e.what());
-          {
-            std::lock_guard<std::mutex> lk(worker_state->mutex_);
-            worker_state->done_seq_ = seq;
-          }
-          worker_state->cv_.notify_all();
-          break;
-        }
+
+  // the window must outlive a job already running on it
+  job_done_cv_.wait(lk, [&]() { return !slot.running_; });
+}
+
+bool ScopeManager::take_job(size_t& idx, Job& job) {
+  // round-robin, so that no window starves the others
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    const size_t candidate = (next_slot_ + i) % slots_.size();
+    JobSlot& slot = slots_[candidate];
+
+    if (slot.open_ && slot.has_job_ && !slot.running_) {
+      std::swap(job, slot.job_);
+      slot.has_job_ = false;
+      slot.running_ = true;
+
+      idx = candidate;
+      next_slot_ = candidate + 1;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ScopeManager::run_executor() {
+  while (true) {
+    size_t idx = 0;
+    Job job;
+    {
+      std::unique_lock<std::mutex> lk(jobs_mutex_);
+      job_available_cv_.wait(lk, [&]() { return stop_executor_ || take_job(idx, job); });
+      if (stop_executor_) {
+        break;
       }
-      {
-        std::lock_guard<std::mutex> lk(worker_state->mutex_);
-        worker_state->done_seq_ = seq;
+    }
+
+    // windows_[idx] is only replaced once its slot is closed and no longer running
+    ScopeWindow* window = windows_[idx].get();
+
+    try {
+      if (!window->close_requested()) {
+        window->prepare(job.left_frame_, job.right_frame_, job.sources_key_);
       }
-      worker_state->cv_.notify_all();
+    } catch (const std::exception& e) {
+      set_fatal_error(std::string("Scope filtergraph error (") + ScopeWindow::type_to_string(window->get_type()) + "): " + e.what());
     }
-  });
-}
 
-void ScopeManager::stop_worker(const size_t idx) {
-  auto& worker_state_ptr = workers_[idx];
-  if (!worker_state_ptr) {
-    return;
-  }
-  {
-    std::lock_guard<std::mutex> lk(worker_state_ptr->mutex_);
-    worker_state_ptr->stop_ = true;
-    worker_state_ptr->cv_.notify_all();
-  }
-  if (worker_state_ptr->thread_.joinable()) {
-    worker_state_ptr->thread_.join();
+    free_job(job);
+
+    {
+      std::lock_guard<std::mutex> lk(jobs_mutex_);
+      slots_[idx].running_ = false;
+    }
+    job_done_cv_.notify_all();
+    // a job for this window may have arrived while it was busy
+    job_available_cv_.notify_one();
   }
-  workers_[idx].reset();
 }
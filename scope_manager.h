@@ -7,6 +7,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 #include "config.h"
 #include "scope_window.h"
 extern "C" {
@@ -25,18 +26,18 @@ class ScopeManager {
   // Request toggle; returns true if a window was opened (so caller can refocus main window)
   bool request_toggle(ScopeWindow::Type type);
 
-  // Update ROI for all open scope windows
-  void set_roi(const ScopeWindow::Roi& roi);
+  // Update ROI (in video coordinates) for all open scope windows
+  void set_roi(const ScopeWindow::Roi& roi, const int video_width, const int video_height);
 
-  // Start/stop workers to match windows and destroy windows that requested close
+  // Destroy windows that requested close
   void reconcile();
 
-  // Submit current pair of frames to all active scope workers
-  void submit_jobs(const AVFrame* left_frame, const AVFrame* right_frame);
-  // Wait for all submitted jobs to complete
-  void wait_all();
-  // Render all open scope windows (main thread)
-  void render_all();
+  // Queue the current pair of frames for all open scope windows without waiting on them; a job not yet
+  // started is replaced by the newer pair. The sources key identifies the inputs the frames come from
+  // (see ScopeWindow::prepare)
+  void submit_jobs(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key);
+  // Render the scope windows whose jobs have completed since their last render (main thread)
+  void render_ready();
   // Returns true if any scope window requested a refresh (e.g., resize)
   bool consume_refresh_request();
 
@@ -48,22 +49,29 @@ class ScopeManager {
   std::string fatal_error_message() const;
 
  private:
-  struct WorkerState {
-    std::thread thread_;
-    std::mutex mutex_;
-    std::condition_variable cv_;
-    const AVFrame* left_frame_{nullptr};
-    const AVFrame* right_frame_{nullptr};
+  // Frames are referenced by the job, so the caller may move on to the next pair right away
+  struct Job {
+    AVFrame* left_frame_{nullptr};
+    AVFrame* right_frame_{nullptr};
+    std::string sources_key_;
+  };
+
+  // Per window; a window is never computed by more than one executor thread at a time
+  struct JobSlot {
+    bool open_{false};
     bool has_job_{false};
-    bool stop_{false};
-    uint64_t job_seq_{0};
-    uint64_t done_seq_{0};
+    bool running_{false};
+    Job job_;
   };
 
+  static void free_job(Job& job);
+
   void create_window(size_t idx);
   void destroy_window(size_t idx);
-  void start_worker(size_t idx);
-  void stop_worker(size_t idx);
+  void open_slot(size_t idx);
+  void close_slot(size_t idx);
+  bool take_job(size_t& idx, Job& job);
+  void run_executor();
   void set_fatal_error(const std::string& message);
 
  private:
@@ -72,8 +80,15 @@ class ScopeManager {
   const ScopesConfig config_;
 
   std::array<std::unique_ptr<ScopeWindow>, ScopeWindow::kNumScopes> windows_;
-  std::array<std::unique_ptr<WorkerState>, ScopeWindow::kNumScopes> workers_;
-  std::array<uint64_t, ScopeWindow::kNumScopes> last_submitted_seq_{};
+
+  // Shared by all windows; guarded by jobs_mutex_
+  std::mutex jobs_mutex_;
+  std::condition_variable job_available_cv_;
+  std::condition_variable job_done_cv_;
+  std::array<JobSlot, ScopeWindow::kNumScopes> slots_;
+  size_t next_slot_{0};
+  bool stop_executor_{false};
+  std::vector<std::thread> executor_threads_;
 
   std::atomic_bool fatal_error_{false};
   mutable std::mutex fatal_error_mutex_;
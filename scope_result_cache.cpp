@@ -0,0 +1,66 @@
+#include "scope_result_cache.h"
+#include <stdexcept>
+
+ScopeResultCache::ScopeResultCache(const size_t max_bytes) : max_bytes_(max_bytes) {}
+
+ScopeResultCache::~ScopeResultCache() {
+  clear();
+}
+
+size_t ScopeResultCache::get_size(const AVFrame* frame) {
+  return static_cast<size_t>(frame->linesize[0]) * frame->height;
+}
+
+AVFrame* ScopeResultCache::get(const std::string& key) {
+  const auto it = index_.find(key);
+
+  if (it == index_.end()) {
+    return nullptr;
+  }
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+
+  AVFrame* frame = av_frame_clone(it->second->second);
+  if (frame == nullptr) {
+    throw std::runtime_error("av_frame_clone failed (scope cache)");
+  }
+
+  return frame;
+}
+
+void ScopeResultCache::put(const std::string& key, const AVFrame* frame) {
+  const size_t size = get_size(frame);
+
+  if (size > max_bytes_ || index_.find(key) != index_.end()) {
+    return;
+  }
+
+  while (bytes_ + size > max_bytes_) {
+    evict_last();
+  }
+
+  AVFrame* frame_ref = av_frame_clone(frame);
+  if (frame_ref == nullptr) {
+    throw std::runtime_error("av_frame_clone failed (scope cache)");
+  }
+
+  entries_.emplace_front(key, frame_ref);
+  index_[key] = entries_.begin();
+  bytes_ += size;
+}
+
+void ScopeResultCache::clear() {
+  while (!entries_.empty()) {
+    evict_last();
+  }
+}
+
+void ScopeResultCache::evict_last() {
+  Entry& entry = entries_.back();
+
+  bytes_ -= get_size(entry.second);
+  index_.erase(entry.first);
+  av_frame_free(&entry.second);
+
+  entries_.pop_back();
+}
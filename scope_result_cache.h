@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Keeps the most recently used scope images within a byte budget, so that frames shown over and
+// over (as when looping) are not computed anew. Entries reference the images rather than copy them.
+class ScopeResultCache {
+ public:
+  explicit ScopeResultCache(const size_t max_bytes);
+  ~ScopeResultCache();
+
+  ScopeResultCache(const ScopeResultCache&) = delete;
+  ScopeResultCache& operator=(const ScopeResultCache&) = delete;
+
+  // Returns a new reference to the image cached under the key, or nullptr
+  AVFrame* get(const std::string& key);
+
+  // Images larger than the whole budget are not cached
+  void put(const std::string& key, const AVFrame* frame);
+
+  void clear();
+
+ private:
+  using Entry = std::pair<std::string, AVFrame*>;
+
+  static size_t get_size(const AVFrame* frame);
+
+  void evict_last();
+
+ private:
+  const size_t max_bytes_;
+  size_t bytes_{0};
+
+  std::list<Entry> entries_;  // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
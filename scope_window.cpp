@@ -3,7 +3,10 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
+#include "core_types.h"
+#include "native_scope.h"
 #include "sdl_event_info.h"
 #include "string_utils.h"
 extern "C" {
@@ -20,6 +23,9 @@ constexpr int kHalfDividerThickness = kDividerThickness / 2;
 constexpr int kHalfOuterPad = kOuterPad / 2;
 constexpr int kDividerGap = kOuterPad * 2;  // total empty gap between panes
 
+// holds a loop through the default frame buffer at the default scope size
+constexpr size_t kResultCacheBytes = 64 * 1024 * 1024;
+
 struct ScopeInfoEntry {
   ScopeWindow::Type type;
   const char* title;
@@ -31,6 +37,7 @@ static constexpr ScopeInfoEntry kScopeInfos[] = {
     {ScopeWindow::Type::Histogram, "Histogram", "histogram", "histogram"},
     {ScopeWindow::Type::Vectorscope, "Vectorscope", "vectorscope", "vectorscope"},
     {ScopeWindow::Type::Waveform, "Waveform", "waveform", "waveform"},
+    {ScopeWindow::Type::Difference, "Difference", nullptr, "difference"},
 };
 
 inline const ScopeInfoEntry* find_scope_info(const ScopeWindow::Type type) {
@@ -61,6 +68,18 @@ inline ScopeWindow::Roi clamp_roi_to_frame(const ScopeWindow::Roi& roi, const in
   return {x, y, w, h};
 }
 
+// reduced (adaptive preview) frames cover the video area on a coarser grid
+inline ScopeWindow::Roi scale_roi_to_frame(const ScopeWindow::Roi& roi, const int video_w, const int video_h, const int frame_w, const int frame_h) {
+  if (video_w <= 0 || video_h <= 0 || (frame_w == video_w && frame_h == video_h)) {
+    return roi;
+  }
+  const int x0 = static_cast<int>(static_cast<int64_t>(roi.x) * frame_w / video_w);
+  const int y0 = static_cast<int>(static_cast<int64_t>(roi.y) * frame_h / video_h);
+  const int x1 = static_cast<int>((static_cast<int64_t>(roi.x + roi.w) * frame_w + video_w - 1) / video_w);
+  const int y1 = static_cast<int>((static_cast<int64_t>(roi.y + roi.h) * frame_h + video_h - 1) / video_h);
+  return {x0, y0, x1 - x0, y1 - y0};
+}
+
 static void draw_rect_thickness(SDL_Renderer* renderer, const SDL_Rect& rect, const int thickness) {
   if (!renderer || thickness <= 0) {
     return;
@@ -111,8 +130,39 @@ static void draw_left_right_overlay(SDL_Renderer* renderer, const int w, const i
     }
   }
 }
+
+// the difference scope compares the sides rather than showing each, so it gets a neutral frame
+static void draw_single_overlay(SDL_Renderer* renderer, const int w, const int h) {
+  if (!renderer || w <= 1 || h <= 1) {
+    return;
+  }
+
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer, 192, 192, 192, 255);
+
+  const SDL_Rect rect{0, 0, w, h};
+  draw_rect_thickness(renderer, rect, kFrameThickness);
+}
 }  // namespace
 
+// the scope windows compute concurrently, so they share the cores between them
+static int get_scope_thread_count() {
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency() / ScopeWindow::kNumScopes));
+}
+
+// the smallest grid step for which the samples taken stay within the budget
+static int get_sampling_step(const int width, const int height, const int max_samples) {
+  int step = 1;
+
+  if (max_samples > 0) {
+    while (static_cast<int64_t>((width + step - 1) / step) * ((height + step - 1) / step) > max_samples) {
+      step++;
+    }
+  }
+
+  return step;
+}
+
 static void sdl_check_bool(const bool ok, const char* what) {
   if (!ok) {
     throw std::runtime_error(std::string("SDL error in ") + what + ": " + SDL_GetError());
@@ -132,8 +182,25 @@ static void ffmpeg_check(const int error_code, const char* what) {
   }
 }
 
-ScopeWindow::ScopeWindow(const Type type, const int pane_width, const int pane_height, const bool always_on_top, const int display_number, const bool use_10_bpc, const std::string& filter_options)
-    : type_(type), pane_width_(pane_width), pane_height_(pane_height), always_on_top_(always_on_top), display_number_(display_number), use_10_bpc_(use_10_bpc), filter_options_(filter_options) {
+ScopeWindow::ScopeWindow(const Type type,
+                         const int pane_width,
+                         const int pane_height,
+                         const bool always_on_top,
+                         const int display_number,
+                         const bool use_10_bpc,
+                         const std::string& filter_options,
+                         const int max_samples,
+                         const bool difference_per_channel)
+    : type_(type),
+      pane_width_(pane_width),
+      pane_height_(pane_height),
+      always_on_top_(always_on_top),
+      display_number_(display_number),
+      use_10_bpc_(use_10_bpc),
+      filter_options_(filter_options),
+      max_samples_(max_samples),
+      difference_per_channel_(difference_per_channel),
+      result_cache_(kResultCacheBytes) {
   const int window_width = pane_width_ * 2;
   const int window_height = pane_height_;
 
@@ -161,6 +228,11 @@ ScopeWindow::ScopeWindow(const Type type, const int pane_width, const int pane_h
     initial_position_y = std::min(std::max(proposed_y, usable_bounds.y + margin_pixels), max_y);
   }
 
+  // options are passed on to the FFmpeg filter, which is then used instead
+  if (filter_options_.empty() || type_ == Type::Difference) {
+    native_scope_ = std::make_unique<NativeScope>(type_, use_10_bpc_, get_scope_thread_count());
+  }
+
   const auto& scope_info_title = get_scope_info(type_);
   const char* window_title = scope_info_title.title;
   base_title_ = window_title;
@@ -233,8 +305,15 @@ std::string ScopeWindow::format_filter_args(const AVFrame* frame) {
 #endif
 }
 
-std::string ScopeWindow::build_filter_description(const int pane_width, const int pane_height, const int left_colorspace, const int left_range, const int right_colorspace, const int right_range, const bool roi_enabled, const Roi& roi)
-    const {
+std::string ScopeWindow::build_filter_description(const int pane_width,
+                                                  const int pane_height,
+                                                  const int left_colorspace,
+                                                  const int left_range,
+                                                  const int right_colorspace,
+                                                  const int right_range,
+                                                  const bool roi_enabled,
+                                                  const Roi& roi,
+                                                  const int sampling_step) const {
   const std::string setparams_left = string_sprintf("setparams=colorspace=%d:range=%d", left_colorspace, left_range);
   const std::string setparams_right = string_sprintf("setparams=colorspace=%d:range=%d", right_colorspace, right_range);
 
@@ -249,6 +328,9 @@ std::string ScopeWindow::build_filter_description(const int pane_width, const in
   const std::string crop_left = roi_enabled ? string_sprintf("crop=%d:%d:%d:%d,", roi.w, roi.h, roi.x, roi.y) : "";
   const std::string crop_right = crop_left;
 
+  // point sampling on the same grid as the native computation
+  const std::string subsample = sampling_step > 1 ? string_sprintf("scale=iw/%d:ih/%d:flags=neighbor,", sampling_step, sampling_step) : "";
+
   const char* pre_format_filter;
   if (type_ == Type::Histogram) {
     pre_format_filter = use_10_bpc_ ? "format=gbrp10" : "format=gbrp";
@@ -260,11 +342,11 @@ std::string ScopeWindow::build_filter_description(const int pane_width, const in
   const std::string tool_spec = filter_options_.empty() ? std::string(tool_name) : string_sprintf("%s=%s", tool_name, filter_options_.c_str());
 
   std::string filter_description = string_sprintf(
-      "[in_left]%s,%s%s,%s,%s,%s[left_scope];"
-      "[in_right]%s,%s%s,%s,%s,%s[right_scope];"
+      "[in_left]%s,%s%s%s,%s,%s,%s[left_scope];"
+      "[in_right]%s,%s%s%s,%s,%s,%s[right_scope];"
       "[left_scope][right_scope]hstack=inputs=2,%s[out]",
-      setparams_left.c_str(), crop_left.c_str(), pre_format_filter, tool_spec.c_str(), left_scale.c_str(), left_pad.c_str(), setparams_right.c_str(), crop_right.c_str(), pre_format_filter, tool_spec.c_str(), right_scale.c_str(),
-      right_pad.c_str(), "format=rgb24");
+      setparams_left.c_str(), crop_left.c_str(), subsample.c_str(), pre_format_filter, tool_spec.c_str(), left_scale.c_str(), left_pad.c_str(), setparams_right.c_str(), crop_right.c_str(), subsample.c_str(), pre_format_filter,
+      tool_spec.c_str(), right_scale.c_str(), right_pad.c_str(), "format=rgb24");
 
   return filter_description;
 }
@@ -284,7 +366,7 @@ void ScopeWindow::ensure_graph(const AVFrame* left_frame, const AVFrame* right_f
   bool roi_enabled_local = false;
   {
     std::lock_guard<std::mutex> lock(state_mutex_);
-    roi_local = roi_;
+    roi_local = scale_roi_to_frame(roi_, video_width_, video_height_, left_frame->width, left_frame->height);
     roi_enabled_local = roi_enabled_;
   }
 
@@ -320,11 +402,9 @@ void ScopeWindow::ensure_graph(const AVFrame* left_frame, const AVFrame* right_f
   right_input_.colorspace = right_frame->colorspace;
   right_input_.range = right_frame->color_range;
   prev_roi_ = roi_enabled_local ? roi_effective : Roi{-1, -1, -1, -1};
-  {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    source_width_ = left_frame->width;
-    source_height_ = left_frame->height;
-  }
+
+  // derived from the ROI and frame sizes, so it only changes along with the graph
+  const int sampling_step = roi_enabled_local ? get_sampling_step(roi_effective.w, roi_effective.h, max_samples_) : get_sampling_step(left_frame->width, left_frame->height, max_samples_);
 
   const AVFilter* buffersrc = avfilter_get_by_name("buffer");
   const AVFilter* buffersink = avfilter_get_by_name("buffersink");
@@ -337,7 +417,7 @@ void ScopeWindow::ensure_graph(const AVFrame* left_frame, const AVFrame* right_f
   ffmpeg_check(avfilter_graph_create_filter(&buffersrc_right_ctx_, buffersrc, "in_right", format_filter_args(right_frame).c_str(), nullptr, filter_graph_), "create right buffer");
   ffmpeg_check(avfilter_graph_create_filter(&buffersink_ctx_, buffersink, "out", nullptr, nullptr, filter_graph_), "create sink");
 
-  std::string filter_description = build_filter_description(pane_width_, pane_height_, left_input_.colorspace, left_input_.range, right_input_.colorspace, right_input_.range, roi_enabled_local, roi_effective);
+  std::string filter_description = build_filter_description(pane_width_, pane_height_, left_input_.colorspace, left_input_.range, right_input_.colorspace, right_input_.range, roi_enabled_local, roi_effective, sampling_step);
 
   AVFilterInOut* inputs = avfilter_inout_alloc();
   AVFilterInOut* outputs_left = avfilter_inout_alloc();
@@ -388,12 +468,16 @@ void ScopeWindow::present_frame(const AVFrame* filtered_frame, const bool allow_
     sdl_check_bool(SDL_RenderCopy(renderer_, texture_, nullptr, nullptr) == 0, "SDL_RenderCopy");
   }
 
-  draw_left_right_overlay(renderer_, window_width_, window_height_, window_width_ / 2);
+  if (type_ == Type::Difference) {
+    draw_single_overlay(renderer_, window_width_, window_height_);
+  } else {
+    draw_left_right_overlay(renderer_, window_width_, window_height_, window_width_ / 2);
+  }
 
   SDL_RenderPresent(renderer_);
 }
 
-bool ScopeWindow::prepare(const AVFrame* left_frame, const AVFrame* right_frame) {
+bool ScopeWindow::prepare(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key) {
   if (!left_frame || !right_frame) {
     return false;
   }
@@ -416,9 +500,65 @@ bool ScopeWindow::prepare(const AVFrame* left_frame, const AVFrame* right_frame)
       av_frame_free(&pending_frame_);
       pending_frame_ = nullptr;
     }
+    update_ready_.store(true);
     return true;
   }
 
+  Roi roi_local;
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    roi_local = scale_roi_to_frame(roi_, video_width_, video_height_, left_frame->width, left_frame->height);
+  }
+
+  // both sides are sampled on the same grid, sized by the left ROI
+  const Roi left_roi = clamp_roi_to_frame(roi_local, left_frame->width, left_frame->height);
+  const int sampling_step = get_sampling_step(left_roi.w, left_roi.h, max_samples_);
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    sampling_step_ = sampling_step;
+  }
+
+  // everything the image depends on besides the type and options of this window
+  const std::string cache_key = string_sprintf("%s|%s:%dx%d:%d|%s:%dx%d:%d|%d,%d,%d,%d|%dx%d", sources_key.c_str(), get_frame_key(left_frame).c_str(), left_frame->width, left_frame->height, left_frame->format,
+                                               get_frame_key(right_frame).c_str(), right_frame->width, right_frame->height, right_frame->format, roi_local.x, roi_local.y, roi_local.w, roi_local.h, pane_width_, pane_height_);
+
+  AVFrame* scope_frame = result_cache_.get(cache_key);
+
+  if (scope_frame == nullptr) {
+    const bool native_format = NativeScope::supports_format(left_frame->format) && NativeScope::supports_format(right_frame->format);
+
+    if (type_ == Type::Difference) {
+      if (!native_format) {
+        throw std::runtime_error("unsupported frame format for the difference scope");
+      }
+      scope_frame = prepare_difference(left_frame, right_frame, roi_local, sampling_step);
+    } else if (native_scope_ != nullptr && native_format) {
+      scope_frame = prepare_native(left_frame, right_frame, roi_local, sampling_step);
+    } else {
+      scope_frame = filter_frames(left_frame, right_frame);
+    }
+
+    if (scope_frame == nullptr) {
+      return false;
+    }
+
+    result_cache_.put(cache_key, scope_frame);
+  }
+
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (pending_frame_ != nullptr) {
+    av_frame_free(&pending_frame_);
+  }
+  pending_frame_ = scope_frame;
+  frame_counter_++;
+  last_pts_left_ = left_frame->pts;
+  last_pts_right_ = right_frame->pts;
+  update_ready_.store(true);
+
+  return true;
+}
+
+AVFrame* ScopeWindow::filter_frames(const AVFrame* left_frame, const AVFrame* right_frame) {
   ensure_graph(left_frame, right_frame);
 
   // Drain any pending frames to prevent lag and ensure one-to-one updates
@@ -474,43 +614,109 @@ bool ScopeWindow::prepare(const AVFrame* left_frame, const AVFrame* right_frame)
     latest_frame = candidate;
   }
 
-  if (latest_frame != nullptr) {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    if (pending_frame_ != nullptr) {
-      av_frame_free(&pending_frame_);
-      pending_frame_ = nullptr;
+  return latest_frame;
+}
+
+using ScopeFramePtr = std::unique_ptr<AVFrame, void (*)(AVFrame*)>;
+
+static ScopeFramePtr make_black_scope_frame(const int width, const int height) {
+  ScopeFramePtr scope_frame(av_frame_alloc(), [](AVFrame* frame) { av_frame_free(&frame); });
+  if (!scope_frame) {
+    throw std::runtime_error("av_frame_alloc failed (native scope)");
+  }
+
+  scope_frame->format = AV_PIX_FMT_RGB24;
+  scope_frame->width = width;
+  scope_frame->height = height;
+  ffmpeg_check(av_frame_get_buffer(scope_frame.get(), 0), "allocate native scope frame");
+
+  for (int y = 0; y < height; y++) {
+    std::memset(scope_frame->data[0] + static_cast<size_t>(y) * scope_frame->linesize[0], 0, static_cast<size_t>(width) * 3);
+  }
+
+  return scope_frame;
+}
+
+AVFrame* ScopeWindow::prepare_native(const AVFrame* left_frame, const AVFrame* right_frame, const Roi& roi_local, const int sampling_step) {
+  const int pane_width = pane_width_;
+  const int pane_height = pane_height_;
+
+  // same layout as the filter graph produces: each scope scaled into a pane and padded, side by side
+  ScopeFramePtr scope_frame = make_black_scope_frame(pane_width * 2, pane_height);
+
+  if (pane_width > kDividerGap && pane_height > kDividerGap) {
+    const int content_w = pane_width - kDividerGap;
+    const int content_h = pane_height - kDividerGap;
+    const AVFrame* frames[] = {left_frame, right_frame};
+
+    for (int pane = 0; pane < 2; pane++) {
+      const Roi roi = clamp_roi_to_frame(roi_local, frames[pane]->width, frames[pane]->height);
+      uint8_t* destination = scope_frame->data[0] + static_cast<size_t>(kOuterPad) * scope_frame->linesize[0] + static_cast<size_t>(pane * pane_width + kOuterPad) * 3;
+
+      native_scope_->draw(frames[pane], roi, sampling_step, destination, scope_frame->linesize[0], content_w, content_h);
     }
-    pending_frame_ = latest_frame;
-    frame_counter_++;
-    last_pts_left_ = left_frame->pts;
-    last_pts_right_ = right_frame->pts;
-    return true;
   }
 
-  return false;
+  return scope_frame.release();
+}
+
+AVFrame* ScopeWindow::prepare_difference(const AVFrame* left_frame, const AVFrame* right_frame, const Roi& roi_local, const int sampling_step) {
+  const int width = pane_width_ * 2;
+  const int height = pane_height_;
+
+  // a single pane spanning the window, padded like the others
+  ScopeFramePtr scope_frame = make_black_scope_frame(width, height);
+
+  if (width > kDividerGap && height > kDividerGap) {
+    const Roi left_roi = clamp_roi_to_frame(roi_local, left_frame->width, left_frame->height);
+    const Roi roi = clamp_roi_to_frame(left_roi, right_frame->width, right_frame->height);
+    uint8_t* destination = scope_frame->data[0] + static_cast<size_t>(kOuterPad) * scope_frame->linesize[0] + static_cast<size_t>(kOuterPad) * 3;
+
+    const std::string summary = native_scope_->draw_difference(left_frame, right_frame, roi, sampling_step, difference_per_channel_, destination, scope_frame->linesize[0], width - kDividerGap, height - kDividerGap);
+
+    // travels with the frame, so that cached frames keep it too
+    av_dict_set(&scope_frame->metadata, "summary", summary.c_str(), 0);
+  }
+
+  return scope_frame.release();
 }
 
 void ScopeWindow::render() {
+  update_ready_.store(false);
+
   Roi roi_local;
   bool roi_enabled_local = false;
-  int source_width = 0;
-  int source_height = 0;
+  int video_width = 0;
+  int video_height = 0;
+  int sampling_step = 1;
   {
     std::lock_guard<std::mutex> lock(state_mutex_);
     roi_local = roi_;
     roi_enabled_local = roi_enabled_;
-    source_width = source_width_;
-    source_height = source_height_;
+    video_width = video_width_;
+    video_height = video_height_;
+    sampling_step = sampling_step_;
+
+    if (pending_frame_ != nullptr) {
+      const AVDictionaryEntry* summary_entry = av_dict_get(pending_frame_->metadata, "summary", nullptr, 0);
+      summary_ = summary_entry != nullptr ? summary_entry->value : "";
+    }
   }
 
   // Update title (main thread only) when ROI is smaller than the full frame.
   std::string title = base_title_;
-  if (roi_enabled_local && source_width > 0 && source_height > 0) {
-    const Roi effective_roi = clamp_roi_to_frame(roi_local, source_width, source_height);
-    const bool is_full = (effective_roi.w == source_width && effective_roi.h == source_height);
+  if (roi_enabled_local && video_width > 0 && video_height > 0) {
+    const Roi effective_roi = clamp_roi_to_frame(roi_local, video_width, video_height);
+    const bool is_full = (effective_roi.w == video_width && effective_roi.h == video_height);
     if (!is_full) {
       title += string_sprintf("   (%d,%d)-(%d,%d)", effective_roi.x, effective_roi.y, effective_roi.x + effective_roi.w - 1, effective_roi.y + effective_roi.h - 1);
     }
+    if (sampling_step > 1) {
+      title += string_sprintf("   [%.1f%% sampled]", 100.0 / (sampling_step * sampling_step));
+    }
+    if (!summary_.empty()) {
+      title += "   " + summary_;
+    }
   }
   if (title != last_window_title_) {
     SDL_SetWindowTitle(window_, title.c_str());
@@ -553,8 +759,8 @@ void ScopeWindow::render() {
   }
 }
 
-bool ScopeWindow::update(const AVFrame* left_frame, const AVFrame* right_frame) {
-  const bool prepared = prepare(left_frame, right_frame);
+bool ScopeWindow::update(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key) {
+  const bool prepared = prepare(left_frame, right_frame, sources_key);
   render();
   return prepared;
 }
@@ -608,9 +814,11 @@ bool ScopeWindow::consume_refresh_request() {
   return refresh_requested_.exchange(false, std::memory_order_relaxed);
 }
 
-void ScopeWindow::set_roi(const Roi& roi) {
+void ScopeWindow::set_roi(const Roi& roi, const int video_width, const int video_height) {
   std::lock_guard<std::mutex> lock(state_mutex_);
   roi_ = roi;
+  video_width_ = video_width;
+  video_height_ = video_height;
   roi_enabled_ = roi.w > 0 && roi.h > 0;
   graph_reset_pending_ = true;
 }
@@ -6,6 +6,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include "scope_result_cache.h"
 extern "C" {
 #include <libavfilter/avfilter.h>
 #include <libavfilter/buffersink.h>
@@ -18,24 +19,30 @@ struct SDL_Renderer;
 struct SDL_Texture;
 union SDL_Event;
 
+class NativeScope;
+
 class ScopeWindow {
  public:
-  enum class Type { Histogram, Vectorscope, Waveform };
-  static constexpr size_t kNumScopes = 3;
+  enum class Type { Histogram, Vectorscope, Waveform, Difference };
+  static constexpr size_t kNumScopes = 4;
   static const char* type_to_string(Type t);
   static size_t index(Type t);
   static Type type_for_index(size_t idx);
   static std::array<Type, kNumScopes> all_types();
 
-  ScopeWindow(Type type, const int pane_width, const int pane_height, const bool always_on_top, const int display_number, const bool use_10_bpc, const std::string& filter_options);
+  ScopeWindow(Type type, const int pane_width, const int pane_height, const bool always_on_top, const int display_number, const bool use_10_bpc, const std::string& filter_options, const int max_samples, const bool difference_per_channel);
   ~ScopeWindow();
 
   // Feed the current frames and update the scope window if an output is produced.
-  bool update(const AVFrame* left_frame, const AVFrame* right_frame);
-  // Compute-only phase: run FFmpeg filter graph and store the freshest frame for later rendering.
-  bool prepare(const AVFrame* left_frame, const AVFrame* right_frame);
+  bool update(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key);
+  // Compute-only phase: compute the scopes natively (or by FFmpeg filter graph if the frame formats or
+  // filter options require it) and store the freshest frame for later rendering. The sources key tells
+  // apart inputs whose frames share frame keys; results are cached by it, the frame keys and the ROI.
+  bool prepare(const AVFrame* left_frame, const AVFrame* right_frame, const std::string& sources_key);
   // Render phase: must run on the main thread; uploads the pending frame (if any) and presents.
   void render();
+  // True if prepare() produced something to render since the last render()
+  bool has_update() const { return update_ready_.load(); }
 
   // Accessor for this window's type
   Type get_type() const { return type_; }
@@ -50,7 +57,8 @@ class ScopeWindow {
     int w;
     int h;
   };
-  void set_roi(const Roi& roi);
+  // The video size maps the ROI onto frames of a reduced (adaptive preview) resolution
+  void set_roi(const Roi& roi, const int video_width, const int video_height);
 
   uint32_t window_id() const { return window_id_; }
 
@@ -63,11 +71,24 @@ class ScopeWindow {
   void ensure_texture();
   void destroy_graph();
 
-  std::string build_filter_description(const int pane_width, const int pane_height, const int left_colorspace, const int left_range, const int right_colorspace, const int right_range, const bool roi_enabled, const Roi& roi) const;
+  std::string build_filter_description(const int pane_width,
+                                       const int pane_height,
+                                       const int left_colorspace,
+                                       const int left_range,
+                                       const int right_colorspace,
+                                       const int right_range,
+                                       const bool roi_enabled,
+                                       const Roi& roi,
+                                       const int sampling_step) const;
   static std::string format_filter_args(const AVFrame* frame);
 
   void present_frame(const AVFrame* filtered_frame, bool allow_cached);
 
+  // Both return a new scope frame, or nullptr if the filter graph has not produced one yet
+  AVFrame* filter_frames(const AVFrame* left_frame, const AVFrame* right_frame);
+  AVFrame* prepare_native(const AVFrame* left_frame, const AVFrame* right_frame, const Roi& roi_local, const int sampling_step);
+  AVFrame* prepare_difference(const AVFrame* left_frame, const AVFrame* right_frame, const Roi& roi_local, const int sampling_step);
+
  private:
   // SDL
   SDL_Window* window_{nullptr};
@@ -84,6 +105,10 @@ class ScopeWindow {
   AVFilterContext* buffersrc_right_ctx_{nullptr};
   AVFilterContext* buffersink_ctx_{nullptr};
 
+  // Native computation; null if the filter options call for the FFmpeg filters (the difference scope
+  // has no filter)
+  std::unique_ptr<NativeScope> native_scope_;
+
   // Input tracking for reinitialization
   struct InputState {
     int width;
@@ -103,8 +128,14 @@ class ScopeWindow {
   int display_number_;
   bool use_10_bpc_;
   std::string filter_options_;
+  int max_samples_;
+  bool difference_per_channel_;
   std::string base_title_;
   std::string last_window_title_;
+  std::string summary_;  // of the last rendered scope frame, if it has one (main thread only)
+
+  // Recently computed scope frames (compute thread only)
+  ScopeResultCache result_cache_;
 
   // PTS tracking to detect non-monotonic browsing and reset the graph
   int64_t last_pts_left_{INT64_MIN};
@@ -115,8 +146,9 @@ class ScopeWindow {
   bool roi_enabled_{false};
   Roi roi_{0, 0, 0, 0};
   Roi prev_roi_{-1, -1, -1, -1};
-  int source_width_{0};
-  int source_height_{0};
+  int video_width_{0};
+  int video_height_{0};
+  int sampling_step_{1};  // every sampling_step_-th pixel of every sampling_step_-th row
 
   // Cross-thread coordination
   std::mutex state_mutex_;
@@ -125,4 +157,5 @@ class ScopeWindow {
   bool graph_reset_pending_{false};
   bool has_valid_texture_{false};
   std::atomic<bool> refresh_requested_{false};
+  std::atomic<bool> update_ready_{false};
 };
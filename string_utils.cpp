@@ -1,6 +1,8 @@
 #include "string_utils.h"
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cmath>
 #include <iostream>
 #include <numeric>
@@ -175,6 +177,23 @@ double parse_strict_double(const std::string& s) {
   return val;
 }
 
+int parse_strict_int(const std::string& s) {
+  if (s.empty()) {
+    throw std::invalid_argument("Empty string is not a valid integer");
+  }
+
+  char* end = nullptr;
+  const char* str = s.c_str();
+  errno = 0;
+  const long val = std::strtol(str, &end, 10);
+
+  if (end != (str + s.size()) || errno == ERANGE || val < INT_MIN || val > INT_MAX) {
+    throw std::invalid_argument("Invalid integer string: " + s);
+  }
+
+  return static_cast<int>(val);
+}
+
 double parse_timestamps_to_seconds(const std::string& timestamp) {
   std::istringstream ss(timestamp);
   std::string token;
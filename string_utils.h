@@ -64,6 +64,8 @@ std::string format_duration(const float duration);
 
 double parse_strict_double(const std::string& s);
 
+int parse_strict_int(const std::string& s);
+
 double parse_timestamps_to_seconds(const std::string& timestamp);
 
 std::string to_lower_case(const std::string& str);
@@ -0,0 +1,156 @@
+#include "tiled_texture.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// small enough for uploads to follow the visible area closely when zoomed in
+static constexpr int MAX_TILE_SIZE = 1024;
+
+// texels held by a tile beyond each of its borders, for filtered sampling across them
+static constexpr int TILE_OVERLAP = 1;
+
+TiledTexture::TiledTexture(SDL_Renderer* renderer, const Uint32 format, const int width, const int height)
+    : renderer_(renderer), format_(format), width_(width), height_(height), visible_rect_({0, 0, width, height}) {
+  int tile_width = MAX_TILE_SIZE;
+  int tile_height = MAX_TILE_SIZE;
+
+  // a maximum of 0 means no limit
+  SDL_RendererInfo info;
+
+  if (SDL_GetRendererInfo(renderer_, &info) == 0) {
+    if (info.max_texture_width > 0) {
+      tile_width = std::max(1, std::min(tile_width, info.max_texture_width - 2 * TILE_OVERLAP));
+    }
+    if (info.max_texture_height > 0) {
+      tile_height = std::max(1, std::min(tile_height, info.max_texture_height - 2 * TILE_OVERLAP));
+    }
+  }
+
+  for (int y = 0; y < height_; y += tile_height) {
+    for (int x = 0; x < width_; x += tile_width) {
+      const SDL_Rect inner = {x, y, std::min(tile_width, width_ - x), std::min(tile_height, height_ - y)};
+
+      const int outer_x = std::max(0, x - TILE_OVERLAP);
+      const int outer_y = std::max(0, y - TILE_OVERLAP);
+      const SDL_Rect outer = {outer_x, outer_y, std::min(width_, inner.x + inner.w + TILE_OVERLAP) - outer_x, std::min(height_, inner.y + inner.h + TILE_OVERLAP) - outer_y};
+
+      SDL_Texture* texture = SDL_CreateTexture(renderer_, format_, SDL_TEXTUREACCESS_STREAMING, outer.w, outer.h);
+
+      if (texture == nullptr) {
+        const std::string error = SDL_GetError();
+
+        for (auto& tile : tiles_) {
+          SDL_DestroyTexture(tile.texture);
+        }
+
+        throw std::runtime_error("SDL error in SDL_CreateTexture (tile): " + error);
+      }
+
+      tiles_.push_back({texture, inner, outer, false});
+    }
+  }
+}
+
+TiledTexture::~TiledTexture() {
+  for (auto& tile : tiles_) {
+    SDL_DestroyTexture(tile.texture);
+  }
+}
+
+void TiledTexture::set_visible_rect(const SDL_Rect& rect) {
+  visible_rect_ = rect;
+}
+
+bool TiledTexture::consume_stale_visible_tiles() {
+  bool has_stale_visible_tiles = false;
+
+  for (auto& tile : tiles_) {
+    if (tile.stale && SDL_HasIntersection(&tile.outer, &visible_rect_)) {
+      tile.stale = false;
+      has_stale_visible_tiles = true;
+    }
+  }
+
+  return has_stale_visible_tiles;
+}
+
+template <typename F>
+bool TiledTexture::for_each_visible_tile(const SDL_Rect& rect, F&& function) {
+  for (auto& tile : tiles_) {
+    SDL_Rect part;
+
+    if (!SDL_IntersectRect(&tile.outer, &rect, &part)) {
+      continue;
+    }
+    if (!SDL_HasIntersection(&tile.outer, &visible_rect_)) {
+      tile.stale = true;
+      continue;
+    }
+    if (!function(tile, part)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TiledTexture::update(const SDL_Rect& rect, const void* pixels, const int pitch) {
+  const int bytes_per_pixel = SDL_BYTESPERPIXEL(format_);
+
+  return for_each_visible_tile(rect, [&](const Tile& tile, const SDL_Rect& part) {
+    const SDL_Rect tile_rect = {part.x - tile.outer.x, part.y - tile.outer.y, part.w, part.h};
+    const uint8_t* part_pixels = static_cast<const uint8_t*>(pixels) + static_cast<ptrdiff_t>(part.y - rect.y) * pitch + static_cast<ptrdiff_t>(part.x - rect.x) * bytes_per_pixel;
+
+    return SDL_UpdateTexture(tile.texture, &tile_rect, part_pixels, pitch) == 0;
+  });
+}
+
+bool TiledTexture::update_locked(const SDL_Rect& rect, const Writer& writer) {
+  return for_each_visible_tile(rect, [&](const Tile& tile, const SDL_Rect& part) {
+    const SDL_Rect tile_rect = {part.x - tile.outer.x, part.y - tile.outer.y, part.w, part.h};
+    void* pixels;
+    int pitch;
+
+    if (SDL_LockTexture(tile.texture, &tile_rect, &pixels, &pitch) != 0) {
+      return false;
+    }
+
+    writer(part, pixels, pitch);
+
+    SDL_UnlockTexture(tile.texture);
+
+    return true;
+  });
+}
+
+bool TiledTexture::render_copy(const SDL_Rect& source_rect, const SDL_FRect& destination_rect) const {
+  if (source_rect.w <= 0 || source_rect.h <= 0) {
+    return true;
+  }
+
+  const float x_scale = destination_rect.w / static_cast<float>(source_rect.w);
+  const float y_scale = destination_rect.h / static_cast<float>(source_rect.h);
+
+  for (const auto& tile : tiles_) {
+    SDL_Rect part;
+
+    if (!SDL_HasIntersection(&tile.outer, &visible_rect_) || !SDL_IntersectRect(&tile.inner, &source_rect, &part)) {
+      continue;
+    }
+
+    const SDL_Rect tile_rect = {part.x - tile.outer.x, part.y - tile.outer.y, part.w, part.h};
+
+    // neighboring parts share their edges exactly, whatever the scale
+    const float x0 = destination_rect.x + static_cast<float>(part.x - source_rect.x) * x_scale;
+    const float y0 = destination_rect.y + static_cast<float>(part.y - source_rect.y) * y_scale;
+    const float x1 = destination_rect.x + static_cast<float>(part.x + part.w - source_rect.x) * x_scale;
+    const float y1 = destination_rect.y + static_cast<float>(part.y + part.h - source_rect.y) * y_scale;
+    const SDL_FRect part_destination = {x0, y0, x1 - x0, y1 - y0};
+
+    if (SDL_RenderCopyF(renderer_, tile.texture, &tile_rect, &part_destination) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// A streaming texture split into a grid of tiles, so that frames beyond the renderer's maximum
+// texture size can be shown, and so that uploads may skip the tiles outside the visible area.
+// Neighboring tiles overlap by a texel, so that filtered sampling shows no seams between them.
+class TiledTexture {
+ public:
+  // Locked texture memory for the given part of an update, in texture coordinates
+  using Writer = std::function<void(const SDL_Rect& rect, void* pixels, const int pitch)>;
+
+  // Uses the scale quality hint in effect, as SDL_CreateTexture does
+  TiledTexture(SDL_Renderer* renderer, const Uint32 format, const int width, const int height);
+  ~TiledTexture();
+
+  TiledTexture(const TiledTexture&) = delete;
+  TiledTexture& operator=(const TiledTexture&) = delete;
+
+  Uint32 get_format() const { return format_; }
+
+  size_t get_tile_count() const { return tiles_.size(); }
+
+  // Updates and render copies leave out the tiles outside this rectangle; tiles which miss an
+  // update because of it are stale until consume_stale_visible_tiles() reports them
+  void set_visible_rect(const SDL_Rect& rect);
+
+  // True if any tile now visible missed an update, in which case the caller must upload the
+  // visible area anew. The tiles concerned are no longer regarded as stale.
+  bool consume_stale_visible_tiles();
+
+  // Both return false on the first failing tile, with the cause in SDL_GetError()
+  bool update(const SDL_Rect& rect, const void* pixels, const int pitch);
+  bool update_locked(const SDL_Rect& rect, const Writer& writer);
+
+  // Draws the source rectangle (in texture coordinates) to the destination, one part per tile
+  bool render_copy(const SDL_Rect& source_rect, const SDL_FRect& destination_rect) const;
+
+ private:
+  struct Tile {
+    SDL_Texture* texture;
+    SDL_Rect inner;  // drawn from this tile
+    SDL_Rect outer;  // held by this tile, i.e. inner plus the overlap
+    bool stale;
+  };
+
+  // Calls the function with each visible tile holding part of the rectangle, and that part;
+  // invisible tiles holding part of it are marked stale instead
+  template <typename F>
+  bool for_each_visible_tile(const SDL_Rect& rect, F&& function);
+
+ private:
+  SDL_Renderer* renderer_;
+  const Uint32 format_;
+  const int width_;
+  const int height_;
+
+  std::vector<Tile> tiles_;
+
+  SDL_Rect visible_rect_;
+};
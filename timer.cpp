@@ -2,6 +2,13 @@
 #include <algorithm>
 #include <iostream>
 #include <thread>
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#endif
+
+// coarse sleeps may overshoot by a scheduler tick, so this much before the deadline is spun
+static const std::chrono::microseconds SPIN_PERIOD{1500};
 
 Timer::Timer() {
   reset();
@@ -16,11 +23,11 @@ void Timer::reset() {
 }
 
 void Timer::update() {
-  target_time_ = std::chrono::high_resolution_clock::now();
+  target_time_ = Clock::now();
 }
 
 int64_t Timer::us_until_target() {
-  return std::chrono::duration_cast<std::chrono::microseconds>(target_time_ - std::chrono::high_resolution_clock::now()).count();
+  return std::chrono::duration_cast<std::chrono::microseconds>(target_time_ - Clock::now()).count();
 }
 
 void Timer::shift_target(int64_t period) {
@@ -28,11 +35,17 @@ void Timer::shift_target(int64_t period) {
 }
 
 void Timer::wait(const int64_t period) {
-  const auto lag = std::chrono::microseconds{period} + std::chrono::microseconds{adjust()};
+  wait(period, [](const int64_t lag) { return lag; });
+}
+
+void Timer::wait(const int64_t period, const std::function<int64_t(const int64_t)>& align) {
+  const int64_t adjusted_lag = period + adjust();
+  const int64_t aligned_lag = align(adjusted_lag);
 
-  std::this_thread::sleep_for(lag);
+  sleep_until(Clock::now() + std::chrono::microseconds{aligned_lag});
 
-  const int64_t error = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - target_time_).count();
+  // the deliberate shift onto the aligned deadline is not an error
+  const int64_t error = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - target_time_).count() - (aligned_lag - adjusted_lag);
   derivative_ = error - proportional_;
   integral_ += error;
   proportional_ = error;
@@ -41,3 +54,28 @@ void Timer::wait(const int64_t period) {
 int64_t Timer::adjust() const {
   return P * proportional_ + I * integral_ + D * derivative_;
 }
+
+void Timer::sleep_until(const Clock::time_point& deadline) {
+  const auto coarse_period = deadline - Clock::now() - SPIN_PERIOD;
+
+  if (coarse_period > Clock::duration::zero()) {
+#ifdef __linux__
+    // an absolute monotonic deadline is immune to interruptions and clock adjustments
+    timespec wake_up;
+    clock_gettime(CLOCK_MONOTONIC, &wake_up);
+
+    const int64_t wake_up_ns = wake_up.tv_nsec + std::chrono::duration_cast<std::chrono::nanoseconds>(coarse_period).count();
+    wake_up.tv_sec += wake_up_ns / 1000000000;
+    wake_up.tv_nsec = wake_up_ns % 1000000000;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_up, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_for(coarse_period);
+#endif
+  }
+
+  while (Clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
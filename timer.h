@@ -1,10 +1,15 @@
 #pragma once
 #include <chrono>
 #include <cstdint>
+#include <functional>
 
 class Timer {
+ public:
+  // monotonic, unlike high_resolution_clock on some platforms
+  using Clock = std::chrono::steady_clock;
+
  private:
-  std::chrono::time_point<std::chrono::high_resolution_clock> target_time_;
+  Clock::time_point target_time_;
 
   int64_t proportional_{};
   int64_t integral_{};
@@ -24,8 +29,17 @@ class Timer {
 
   void shift_target(int64_t period);
   void wait(const int64_t period);
+
+  // As wait(), but the controller-adjusted wait (microseconds) is first mapped through align,
+  // e.g. onto a vsync deadline. The error terms keep being updated, less the shift align made.
+  void wait(const int64_t period, const std::function<int64_t(const int64_t)>& align);
+
   void update_error();
 
  private:
   int64_t adjust() const;
+
+  // Sleeps until the deadline with sub-millisecond accuracy: a coarse OS sleep for all but the
+  // last stretch, which is spun out
+  static void sleep_until(const Clock::time_point& deadline);
 };
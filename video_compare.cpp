@@ -8,6 +8,7 @@
 #include <limits>
 #include <thread>
 #include "ffmpeg.h"
+#include "frame_sync.h"
 #include "scope_manager.h"
 #include "scope_window.h"
 #include "sdl_event_info.h"
@@ -29,6 +30,13 @@ static constexpr uint32_t ONE_SECOND_US = 1000 * 1000;
 static constexpr uint32_t RESYNC_UPDATE_RATE_US = ONE_SECOND_US / 10;
 static constexpr uint32_t NOMINAL_FPS_UPDATE_RATE_US = 1 * ONE_SECOND_US;
 
+// number of lowest-scoring frames the worst frame search keeps
+static constexpr size_t WORST_FRAME_COUNT = 20;
+
+// newest buffered frames which keep their filtered (pre-conversion) frame for the quality metrics;
+// older ones fall back to the display frames, unless still needed to restore a reduced preview
+static constexpr size_t SOURCE_FRAME_HISTORY = 8;
+
 static bool env_flag_enabled(const char* name) {
   const char* v = std::getenv(name);
   if (v == nullptr) {
@@ -44,32 +52,6 @@ static auto avpacket_deleter = [](AVPacket* packet) {
 
 static auto avframe_deleter = [](AVFrame* frame) { av_frame_free(&frame); };
 
-static auto avframe_and_data_deleter = [](AVFrame* frame) {
-  av_freep(&frame->data[0]);
-  avframe_deleter(frame);
-};
-
-static inline bool is_behind(int64_t frame1_pts, int64_t frame2_pts, int64_t delta_pts) {
-  const float t1 = static_cast<float>(frame1_pts) * AV_TIME_TO_SEC;
-  const float t2 = static_cast<float>(frame2_pts) * AV_TIME_TO_SEC;
-  const float delta_s = static_cast<float>(delta_pts) * AV_TIME_TO_SEC - 1e-5F;
-
-  const float diff = t1 - t2;
-  const float tolerance = std::max(delta_s, 1.0F / 480.0F);
-
-  return diff < -tolerance;
-}
-
-static inline int64_t compute_min_delta(const int64_t delta_left_pts, const int64_t delta_right_pts) {
-  return std::min(delta_left_pts, delta_right_pts) * 8 / 10;
-};
-
-static inline bool is_in_sync(const int64_t left_pts, const int64_t right_pts, const int64_t delta_left_pts, const int64_t delta_right_pts) {
-  const int64_t min_delta = compute_min_delta(delta_left_pts, delta_right_pts);
-
-  return !is_behind(left_pts, right_pts, min_delta) && !is_behind(right_pts, left_pts, min_delta);
-};
-
 static inline int64_t compute_frame_delay(const int64_t left_pts, const int64_t right_pts) {
   return std::max(left_pts, right_pts);
 }
@@ -78,14 +60,6 @@ static inline int64_t time_ms_to_av_time(const double time_ms) {
   return time_ms * MILLISEC_TO_AV_TIME;
 }
 
-static inline int64_t calculate_dynamic_time_shift(const AVRational& multiplier, const int64_t original_pts, const bool inverse) {
-  // Calculate the time shift as the difference between original and scaled PTS
-  const int64_t time_shift =
-      inverse ? (original_pts - av_rescale_q(original_pts, AVRational{multiplier.den, multiplier.num}, AVRational{1, 1})) : (av_rescale_q(original_pts, AVRational{multiplier.num, multiplier.den}, AVRational{1, 1}) - original_pts);
-
-  return time_shift;
-}
-
 static inline std::pair<size_t, size_t> calculate_max_dest_dimensions(const std::map<Side, std::unique_ptr<VideoFilterer>>& video_filterers) {
   size_t max_w = 0;
   size_t max_h = 0;
@@ -142,13 +116,28 @@ static bool produces_same_decoded_video(const VideoCompareConfig& config) {
 }
 
 static inline AVPixelFormat determine_pixel_format(const VideoCompareConfig& config) {
-  return config.use_10_bpc ? AV_PIX_FMT_RGB48LE : AV_PIX_FMT_RGB24;
+  if (!config.use_10_bpc) {
+    return AV_PIX_FMT_RGB24;
+  }
+
+  // convert straight to the texture format if swscale can, so the display needs no packing pass
+#ifdef AV_PIX_FMT_X2RGB10
+  if (sws_isSupportedOutput(AV_PIX_FMT_X2RGB10LE) > 0) {
+    return AV_PIX_FMT_X2RGB10LE;
+  }
+#endif
+
+  return AV_PIX_FMT_RGB48LE;
 }
 
 static inline int determine_sws_flags(const bool fast) {
   return fast ? SWS_FAST_BILINEAR : (SWS_BICUBIC | SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND);
 }
 
+static inline size_t reduce_dimension(const size_t dimension, const int divisor) {
+  return (dimension + divisor - 1) / divisor;
+}
+
 static inline bool use_fast_input_alignment(const VideoCompareConfig& config) {
   return config.fast_input_alignment;
 }
@@ -177,6 +166,13 @@ VideoCompare::VideoCompare(const VideoCompareConfig& config)
     throw std::logic_error{"At least one right video must be supplied"};
   }
 
+  // Copy the input settings before the option dictionaries are consumed below
+  scan_inputs_[LEFT] = std::make_unique<ScanInput>(config.left);
+
+  for (size_t i = 0; i < config.right_videos.size(); ++i) {
+    scan_inputs_[Side::Right(i)] = std::make_unique<ScanInput>(config.right_videos[i]);
+  }
+
   // Initialize left video demuxer and decoder
   install_processor(demuxers_, ReadyToSeek::ProcessorThread::Demultiplexer, LEFT, std::make_unique<Demuxer>(LEFT, config.left.demuxer, config.left.file_name, config.left.demuxer_options, config.left.decoder_options));
   install_processor(
@@ -198,19 +194,18 @@ VideoCompare::VideoCompare(const VideoCompareConfig& config)
   }
 
   // Create VideoFilterContext to manage all videos for consistent auto-filter determination
-  VideoFilterContext video_filter_context;
-  video_filter_context.add(LEFT, demuxers_[LEFT].get(), video_decoders_[LEFT].get(), config.left.color_trc);
+  video_filter_context_.add(LEFT, demuxers_[LEFT].get(), video_decoders_[LEFT].get(), config.left.color_trc);
 
   for (size_t i = 0; i < config.right_videos.size(); ++i) {
     const auto& right_config = config.right_videos[i];
     Side right_side = Side::Right(i);
-    video_filter_context.add(right_side, demuxers_[right_side].get(), video_decoders_[right_side].get(), right_config.color_trc);
+    video_filter_context_.add(right_side, demuxers_[right_side].get(), video_decoders_[right_side].get(), right_config.color_trc);
   }
 
   // Initialize filterers using VideoFilterContext for consistent auto-filter determination
   install_processor(video_filterers_, ReadyToSeek::ProcessorThread::Filterer, LEFT,
                     std::make_unique<VideoFilterer>(LEFT, demuxers_[LEFT].get(), video_decoders_[LEFT].get(), config.left.tone_mapping_mode, config.left.boost_tone, config.left.video_filters, config.left.color_space,
-                                                    config.left.color_range, config.left.color_primaries, config.left.color_trc, &video_filter_context, config.disable_auto_filters));
+                                                    config.left.color_range, config.left.color_primaries, config.left.color_trc, &video_filter_context_, config.disable_auto_filters));
 
   // For each right video, use VideoFilterContext for auto-filter determination
   for (size_t i = 0; i < config.right_videos.size(); ++i) {
@@ -219,7 +214,7 @@ VideoCompare::VideoCompare(const VideoCompareConfig& config)
 
     install_processor(video_filterers_, ReadyToSeek::ProcessorThread::Filterer, right_side,
                       std::make_unique<VideoFilterer>(right_side, demuxers_[right_side].get(), video_decoders_[right_side].get(), right_config.tone_mapping_mode, right_config.boost_tone, right_config.video_filters, right_config.color_space,
-                                                      right_config.color_range, right_config.color_primaries, right_config.color_trc, &video_filter_context, config.disable_auto_filters));
+                                                      right_config.color_range, right_config.color_primaries, right_config.color_trc, &video_filter_context_, config.disable_auto_filters));
   }
 
   // Calculate max dimensions from all videos
@@ -231,12 +226,13 @@ VideoCompare::VideoCompare(const VideoCompareConfig& config)
 
   // Initialize format converters
   const bool initial_fast_input_alignment = use_fast_input_alignment(config_);
-  recreate_format_converters(determine_sws_flags(initial_fast_input_alignment));
+  recreate_format_converters(determine_format_conversion_sws_flags(initial_fast_input_alignment));
 
   // Calculate shortest duration
   shortest_duration_ = calculate_shortest_duration_seconds(demuxers_);
 
   timer_ = std::make_unique<Timer>();
+  frame_pacer_ = std::make_unique<FramePacer>();
 
   // Initialize queues for all videos
   for (const auto& pair : demuxers_) {
@@ -343,24 +339,71 @@ VideoCompare::VideoCompare(const VideoCompareConfig& config)
                                        config_.use_10_bpc, use_fast_input_alignment(config_), config_.bilinear_texture_filtering, config_.window_size, max_width_, max_height_, shortest_duration_, config_.wheel_sensitivity,
                                        config_.start_in_subtraction_mode, config_.start_in_fullscreen, config_.left.file_name, right_file_name);
   display_->set_num_right_videos(right_video_info_.size());
+  display_->set_png_compression_level(config_.png_compression_level);
   display_->set_active_right_index(active_right_index_);
+
+  frame_pacer_->set_refresh_rate(display_->get_refresh_rate());
   display_->update_metadata(left_video_metadata_, right_video_info_[active_right].metadata);
 
   scope_manager_ = std::make_unique<ScopeManager>(config.scopes, config.use_10_bpc, config.display_number);
 
+  metrics_timeline_ = std::make_unique<MetricsTimeline>([this](const Side& right_side, const int64_t right_time_shift) { return create_clip_scanner(right_side, right_time_shift); }, shortest_duration_, config.scopes.width,
+                                                        config.scopes.height, config.scopes.always_on_top, config.display_number);
+
+  worst_frame_finder_ = std::make_unique<WorstFrameFinder>(*metrics_timeline_, WORST_FRAME_COUNT);
+
   // Move focus to main window if any scope windows are enabled
   if (config.scopes.histogram || config.scopes.vectorscope || config.scopes.waveform) {
     display_->focus_main_window();
   }
 }
 
+std::unique_ptr<ClipScanner> VideoCompare::create_clip_scanner(const Side& right_side, const int64_t right_time_shift) const {
+  return std::make_unique<ClipScanner>(*scan_inputs_.at(LEFT), *scan_inputs_.at(right_side), &video_filter_context_, config_.disable_auto_filters, time_shift_.multiplier, right_time_shift);
+}
+
 void VideoCompare::recreate_format_converter_for_side(const Side& side, const int sws_flags) {
   const AVPixelFormat output_pixel_format = determine_pixel_format(config_);
 
   const auto& filterer = video_filterers_.at(side);
   ready_to_seek_.init(ReadyToSeek::ProcessorThread::Converter, side);
-  format_converters_[side] = std::make_unique<FormatConverter>(filterer->dest_width(), filterer->dest_height(), max_width_, max_height_, filterer->dest_pixel_format(), output_pixel_format, video_decoders_[side]->color_space(),
-                                                               video_decoders_[side]->color_range(), side, sws_flags);
+  format_converters_[side] = std::make_unique<FormatConverter>(filterer->dest_width(), filterer->dest_height(), reduce_dimension(max_width_, preview_scale_divisor_), reduce_dimension(max_height_, preview_scale_divisor_),
+                                                               filterer->dest_pixel_format(), output_pixel_format, video_decoders_[side]->color_space(), video_decoders_[side]->color_range(), side, sws_flags);
+}
+
+void VideoCompare::restore_full_resolution(const Side& side, AVFrameUniquePtr& frame) const {
+  const AVFrame* source_frame = get_source_frame(frame.get());
+
+  if (source_frame == nullptr || (static_cast<size_t>(frame->width) == max_width_ && static_cast<size_t>(frame->height) == max_height_)) {
+    return;
+  }
+
+  // a one-off converter, since each converter thread owns its own
+  FormatConverter format_converter(source_frame->width, source_frame->height, max_width_, max_height_, static_cast<AVPixelFormat>(source_frame->format), determine_pixel_format(config_), source_frame->colorspace,
+                                   source_frame->color_range, side, determine_sws_flags(display_->get_fast_input_alignment()));
+
+  // the properties include the source frame reference
+  AVFrameUniquePtr frame_converted{av_frame_alloc(), avframe_deleter};
+
+  if (av_frame_copy_props(frame_converted.get(), frame.get()) < 0) {
+    throw std::runtime_error("Copying converted frame properties");
+  }
+
+  frame_converted->format = format_converter.dest_pixel_format();
+  frame_converted->width = static_cast<int>(format_converter.dest_width());
+  frame_converted->height = static_cast<int>(format_converter.dest_height());
+
+  if (av_frame_get_buffer(frame_converted.get(), 64) < 0) {
+    throw std::runtime_error("Allocating converted picture");
+  }
+  format_converter(source_frame, frame_converted.get());
+
+  frame = std::move(frame_converted);
+}
+
+int VideoCompare::determine_format_conversion_sws_flags(const bool fast_input_alignment) const {
+  // area averaging keeps reduced previews cheap without the aliasing of fast bilinear
+  return preview_scale_divisor_ > 1 ? SWS_AREA : determine_sws_flags(fast_input_alignment);
 }
 
 void VideoCompare::recreate_format_converters(const int sws_flags) {
@@ -606,16 +649,29 @@ void VideoCompare::format_convert_video(const Side& side) {
 
       if (filtered_frame_queues_[side]->pop(frame_filtered)) {
         // scale and convert pixel format before pushing to frame queue for displaying
-        AVFrameUniquePtr frame_converted{av_frame_alloc(), avframe_and_data_deleter};
+        AVFrameUniquePtr frame_converted{av_frame_alloc(), avframe_deleter};
 
         if (av_frame_copy_props(frame_converted.get(), frame_filtered.get()) < 0) {
           throw std::runtime_error("Copying filtered frame properties");
         }
-        if (av_image_alloc(frame_converted->data, frame_converted->linesize, format_converters_[side]->dest_width(), format_converters_[side]->dest_height(), format_converters_[side]->dest_pixel_format(), 64) < 0) {
+
+        // a new preview resolution takes effect from this frame on
+        format_converters_[side]->apply_pending_changes();
+
+        // reference-counted, so that the display's difference worker can hold on to it cheaply
+        frame_converted->format = format_converters_[side]->dest_pixel_format();
+        frame_converted->width = static_cast<int>(format_converters_[side]->dest_width());
+        frame_converted->height = static_cast<int>(format_converters_[side]->dest_height());
+
+        if (av_frame_get_buffer(frame_converted.get(), 64) < 0) {
           throw std::runtime_error("Allocating converted picture");
         }
         (*format_converters_[side])(frame_filtered.get(), frame_converted.get());
 
+        if (!attach_source_frame(frame_converted.get(), frame_filtered.get())) {
+          throw std::runtime_error("Referencing filtered frame");
+        }
+
         converted_frame_queues_[side]->push(std::move(frame_converted));
       } else if (filtered_frame_queues_[side]->is_stopped() || seeking_) {
         // Stop filtering
@@ -895,6 +951,15 @@ void VideoCompare::compare() {
 
     const bool log_event_routing = env_flag_enabled("VIDEO_COMPARE_LOG_EVENT_ROUTING");
 
+    // the right videos tiled in mosaic mode
+    std::vector<size_t> mosaic_right_indices = config_.mosaic_right_indices;
+
+    if (mosaic_right_indices.empty()) {
+      for (size_t i = 0; i < right_video_info_.size(); i++) {
+        mosaic_right_indices.push_back(i);
+      }
+    }
+
     for (uint64_t frame_number = 0;; ++frame_number) {
       // Set FPS message if needed
       if (display_->get_show_fps()) {
@@ -914,13 +979,14 @@ void VideoCompare::compare() {
 
         const uint32_t wid = SDLEventInfo::window_id(event);
         const bool consumed_by_scope = scope_manager_->handle_event(event);
-        if (!consumed_by_scope) {
+        const bool consumed_by_timeline = !consumed_by_scope && metrics_timeline_->handle_event(event);
+        if (!consumed_by_scope && !consumed_by_timeline) {
           display_->handle_event(event);
         }
 
         if (log_event_routing) {
           std::cerr << "[event] type=" << SDLEventInfo::type_name(event.type) << " (" << event.type << ")"
-                    << " windowID=" << wid << " -> " << (consumed_by_scope ? "scope" : "display") << std::endl;
+                    << " windowID=" << wid << " -> " << (consumed_by_scope ? "scope" : (consumed_by_timeline ? "timeline" : "display")) << std::endl;
         }
       }
 
@@ -939,7 +1005,7 @@ void VideoCompare::compare() {
         }
       }
 
-      scope_manager_->set_roi(scope_window_roi);
+      scope_manager_->set_roi(scope_window_roi, static_cast<int>(max_width_), static_cast<int>(max_height_));
       scope_manager_->reconcile();
       if (scope_manager_->has_fatal_error()) {
         throw std::runtime_error(scope_manager_->fatal_error_message());
@@ -947,6 +1013,8 @@ void VideoCompare::compare() {
       if (scope_manager_->consume_refresh_request()) {
         scope_update_state_.reset();
       }
+      // present whichever scopes have finished; playback never waits on them
+      scope_manager_->render_ready();
 
       if (!keep_running()) {
         break;
@@ -958,7 +1026,7 @@ void VideoCompare::compare() {
       }
 #endif
 
-      const int format_conversion_sws_flags = determine_sws_flags(display_->get_fast_input_alignment());
+      const int format_conversion_sws_flags = determine_format_conversion_sws_flags(display_->get_fast_input_alignment());
       // Update active right video index from display and switch if changed
       size_t new_active_index = display_->get_active_right_index();
       if (new_active_index != active_right_index_) {
@@ -969,6 +1037,41 @@ void VideoCompare::compare() {
         display_->update_right_video(right_video_info_[active_right].file_name, right_video_info_[active_right].metadata);
         scope_update_state_.reset();
       }
+
+      // Handle the metrics timeline window; a click in it seeks like the main window would
+      if (display_->get_toggle_metrics_timeline_requested() && metrics_timeline_->request_toggle()) {
+        display_->focus_main_window();
+      }
+
+      metrics_timeline_->set_pair(active_right, total_right_time_shifted, static_right_time_shift);
+      metrics_timeline_->reconcile();
+
+      float timeline_seek_position;
+      if (metrics_timeline_->consume_seek_request(timeline_seek_position)) {
+        display_->seek_to(timeline_seek_position);
+      }
+
+      // Step through the worst frames found so far by the timeline's background scan
+      worst_frame_finder_->set_pair(active_right, total_right_time_shifted);
+
+      const int worst_frame_step = display_->get_worst_frame_step();
+
+      if (worst_frame_step != 0) {
+        WorstFrameSelection selection;
+
+        if (worst_frame_finder_->step(worst_frame_step, selection)) {
+          const float position = selection.frame.pts * AV_TIME_TO_SEC;
+          const std::string psnr_str = selection.frame.psnr_is_infinite ? "inf" : string_sprintf("%.2f dB", selection.frame.psnr);
+          const std::string progress_str = selection.complete ? "" : string_sprintf(" (searched %s so far)", format_position(selection.scanned_pts * AV_TIME_TO_SEC, true).c_str());
+
+          display_->seek_to(position);
+          display_->notify_user(string_sprintf("Worst frame %d/%d at %s: PSNR %s%s", selection.rank + 1, selection.count, format_position(position, true).c_str(), psnr_str.c_str(), progress_str.c_str()));
+        } else if (worst_frame_finder_->has_failed()) {
+          display_->notify_user("Worst frame search found no comparable frames");
+        } else {
+          display_->notify_user("Searching for the worst frames...");
+        }
+      }
       // Update format converter flags for all videos
       for (auto& pair : format_converters_) {
         pair.second->set_pending_flags(format_conversion_sws_flags);
@@ -1002,6 +1105,28 @@ void VideoCompare::compare() {
 
       bool skip_update = false;
 
+      // adaptive preview: during playback, convert at about the on-screen resolution; looping the frame
+      // buffer keeps its frames, and anything else (pause, zoom, saving) calls for full resolution
+      int target_preview_scale_divisor = 1;
+
+      if (config_.adaptive_preview && !display_->get_full_resolution_requested()) {
+        if (display_->get_buffer_play_loop_mode() != Display::Loop::Off) {
+          target_preview_scale_divisor = preview_scale_divisor_;
+        } else if (display_->get_play()) {
+          target_preview_scale_divisor = display_->get_preview_scale_divisor();
+        }
+      }
+
+      // applies to the frames converted from now on; those already converted keep their resolution
+      if (target_preview_scale_divisor != preview_scale_divisor_) {
+        preview_scale_divisor_ = target_preview_scale_divisor;
+
+        for (auto& pair : format_converters_) {
+          pair.second->set_pending_flags(determine_format_conversion_sws_flags(display_->get_fast_input_alignment()));
+          pair.second->set_pending_dest_size(reduce_dimension(max_width_, preview_scale_divisor_), reduce_dimension(max_height_, preview_scale_divisor_));
+        }
+      }
+
       // handle pending crop request
       const bool force_seek_current_position = handle_pending_crop_request(active_right);
 
@@ -1020,6 +1145,8 @@ void VideoCompare::compare() {
         ready_to_seek_.reset_all();
         seeking_ = true;
 
+        frame_pacer_->restart();
+
         // drain packet and frame queues
         for (auto& pair : packet_queues_) {
           pair.second->stop();
@@ -1068,7 +1195,7 @@ void VideoCompare::compare() {
 
         // if dimensions changed, recreate format converters and reinitialize video dimensions
         if (dims_changed) {
-          recreate_format_converters(format_conversion_sws_flags);
+          recreate_format_converters(determine_format_conversion_sws_flags(display_->get_fast_input_alignment()));
           display_->reinitialize_video_dimensions(static_cast<unsigned>(max_width_), static_cast<unsigned>(max_height_));
         }
 
@@ -1387,6 +1514,14 @@ void VideoCompare::compare() {
             frames.pop_back();
           }
           frames.push_front(std::move(frame));
+
+          if (frames.size() > SOURCE_FRAME_HISTORY) {
+            AVFrame* older_frame = frames[SOURCE_FRAME_HISTORY].get();
+
+            if (static_cast<size_t>(older_frame->width) == max_width_ && static_cast<size_t>(older_frame->height) == max_height_) {
+              release_source_frame(older_frame);
+            }
+          }
         } else if (frame != nullptr) {
           if (!frames.empty()) {
             frames.front() = std::move(frame);
@@ -1429,6 +1564,15 @@ void VideoCompare::compare() {
       bool ui_refresh_performed = false;
 
       if (frame_offset >= 0 && !left.frames_.empty() && !right_ptr->frames_.empty()) {
+        // once stopped at a preview frame, convert it again at full resolution from its source frame
+        if (preview_scale_divisor_ == 1 && !display_->get_play()) {
+          for (auto& pair : side_states) {
+            if (frame_offset < static_cast<int>(pair.second.frames_.size())) {
+              restore_full_resolution(pair.first, pair.second.frames_[frame_offset]);
+            }
+          }
+        }
+
         const bool is_playback_in_sync = is_in_sync(left.pts_, right_ptr->pts_, left.delta_pts_, right_ptr->delta_pts_);
 
         // reduce refresh rate to 10 Hz for faster re-syncing
@@ -1440,6 +1584,17 @@ void VideoCompare::compare() {
 
           const auto left_display_frame = left_frames_ref[frame_offset].get();
           const auto right_display_frame = right_frames_ref[frame_offset].get();
+
+          if (display_->get_print_windowed_vmaf()) {
+            std::vector<std::pair<const AVFrame*, const AVFrame*>> frame_pairs;
+
+            // the buffers hold the newest frame first, whereas VMAF must see them in display order
+            for (int i = last_common_frame_index; i >= 0; i--) {
+              frame_pairs.emplace_back(left_frames_ref[i].get(), right_frames_ref[i].get());
+            }
+
+            display_->print_windowed_vmaf(frame_pairs);
+          }
           const auto left_state_frame = left.frames_[frame_offset].get();
           const auto right_state_frame = right_ptr->frames_[frame_offset].get();
 
@@ -1497,6 +1652,19 @@ void VideoCompare::compare() {
 
             const std::string current_total_browsable = string_sprintf(frame_offset_format_str.c_str(), prefix_str.c_str(), frame_offset + 1, last_common_frame_index + 1, suffix_str.c_str());
 
+            // every right video is synced to the left one, so the frames at the same buffer offset line up
+            if (display_->get_mosaic_mode()) {
+              std::vector<std::pair<size_t, const AVFrame*>> mosaic_right_frames;
+
+              for (const size_t right_index : mosaic_right_indices) {
+                const auto& right_frames = side_states.at(Side::Right(right_index)).frames_;
+
+                mosaic_right_frames.emplace_back(right_index, frame_offset < static_cast<int>(right_frames.size()) ? right_frames[frame_offset].get() : nullptr);
+              }
+
+              display_->set_mosaic_right_frames(mosaic_right_frames);
+            }
+
             // conditionally update the display; otherwise, sleep to conserve resources
             display_refresh_timer.update();
 
@@ -1506,22 +1674,27 @@ void VideoCompare::compare() {
               const bool scope_state_changed = scope_update_state_.has_changed(scope_sample);
 
               if (scope_state_changed) {
-                scope_manager_->submit_jobs(left_display_frame, right_display_frame);
-                scope_manager_->wait_all();
+                // the frame keys alone do not tell the right inputs apart
+                scope_manager_->submit_jobs(left_display_frame, right_display_frame, string_sprintf("%zu|%d", right_ptr->side_.right_index(), display_->get_swap_left_right()));
 
                 scope_update_state_.update(scope_sample);
-
-                if (scope_manager_->has_fatal_error()) {
-                  throw std::runtime_error(scope_manager_->fatal_error_message());
-                }
-                scope_manager_->render_all();
               }
 
               refresh_time_deque.push_back(-display_refresh_timer.us_until_target());
+
+              // account for how the playback frames land on the display refreshes
+              if (display_->get_play() && is_playback_in_sync) {
+                frame_pacer_->on_present(left_display_frame->pts, ffmpeg::frame_duration(left_display_frame), display_->get_playback_speed_factor());
+              } else {
+                frame_pacer_->restart();
+              }
             } else {
               sleep_for_ms(refresh_time_deque.average() / 1000);
             }
 
+            metrics_timeline_->set_position(left.frames_[frame_offset]->pts);
+            metrics_timeline_->render();
+
             ui_refresh_performed = true;
 
             // calculate next refresh time dynamically based on target playback speed and current refresh timing
@@ -1535,7 +1708,14 @@ void VideoCompare::compare() {
           const int64_t time_until_final_refresh = timer_->us_until_target();
 
           if (!adjusting && time_until_final_refresh > 0 && time_until_final_refresh < refresh_time_deque.average()) {
-            timer_->wait(time_until_final_refresh);
+            // once the vsync phase is known, aim the present at the vsync nearest to when the frame is due
+            if (frame_pacer_->can_align_to_vsync()) {
+              const int64_t refresh_time = refresh_time_deque.average();
+
+              timer_->wait(time_until_final_refresh, [&](const int64_t lag) { return frame_pacer_->us_until_refresh(lag, refresh_time); });
+            } else {
+              timer_->wait(time_until_final_refresh);
+            }
           } else if (time_until_final_refresh <= 0 && display_->get_buffer_play_loop_mode() != Display::Loop::Off) {
             // auto-adjust current frame during in-buffer playback
             switch (display_->get_buffer_play_loop_mode()) {
@@ -1583,6 +1763,25 @@ void VideoCompare::compare() {
 
           fps_message = string_sprintf("Video/UI FPS: %.1f/%.1f", video_fps, ui_fps);
 
+          const PresentStats present_stats = display_->consume_present_stats();
+
+          if (present_stats.input_latency_samples > 0) {
+            fps_message += string_sprintf(", input latency: %.0f ms", present_stats.average_input_latency_ms());
+          }
+          if (present_stats.interval_samples > 1) {
+            fps_message += string_sprintf(", present jitter: %.1f ms", present_stats.interval_jitter_ms());
+          }
+
+          const FramePacingStats pacing_stats = frame_pacer_->consume_interval_stats();
+
+          if (pacing_stats.presented_frames > 0) {
+            fps_message += string_sprintf(", dropped/duplicated/late: %llu/%llu/%llu", static_cast<unsigned long long>(pacing_stats.dropped_frames), static_cast<unsigned long long>(pacing_stats.duplicated_refreshes),
+                                          static_cast<unsigned long long>(pacing_stats.late_presents));
+          }
+
+          // the window may have moved to another display
+          frame_pacer_->set_refresh_rate(display_->get_refresh_rate());
+
           full_cycle_time_deque.clear();
           unique_frame_combo_tags_processed = 0;
         }
@@ -1592,6 +1791,15 @@ void VideoCompare::compare() {
     exception_holder_.store_current_exception();
   }
 
+  const FramePacingStats& pacing_stats = frame_pacer_->get_total_stats();
+
+  if (pacing_stats.presented_frames > 0) {
+    std::cout << string_sprintf("Playback pacing: %llu frames presented, %llu dropped, %llu duplicated refreshes, %llu late presents (display at %d Hz)", static_cast<unsigned long long>(pacing_stats.presented_frames),
+                                static_cast<unsigned long long>(pacing_stats.dropped_frames), static_cast<unsigned long long>(pacing_stats.duplicated_refreshes), static_cast<unsigned long long>(pacing_stats.late_presents),
+                                frame_pacer_->get_refresh_rate())
+              << std::endl;
+  }
+
   // Quit queues for all videos (left and all right videos)
   quit_all_queues();
 }
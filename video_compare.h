@@ -8,16 +8,20 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include "clip_scanner.h"
 #include "config.h"
 #include "core_types.h"
 #include "demuxer.h"
 #include "display.h"
 #include "format_converter.h"
+#include "frame_pacer.h"
+#include "metrics_timeline.h"
 #include "queue.h"
 #include "scope_manager.h"
 #include "timer.h"
 #include "video_decoder.h"
 #include "video_filterer.h"
+#include "worst_frame_finder.h"
 extern "C" {
 #include <libavcodec/avcodec.h>
 }
@@ -130,6 +134,11 @@ class VideoCompare {
   void recreate_format_converter_for_side(const Side& side, const int sws_flags);
   void recreate_format_converters(const int sws_flags);
 
+  int determine_format_conversion_sws_flags(const bool fast_input_alignment) const;
+
+  // Converts a frame of a reduced preview resolution again from its source frame, at full resolution
+  void restore_full_resolution(const Side& side, AVFrameUniquePtr& frame) const;
+
   void demultiplex(const Side& side);
 
   void decode_video(const Side& side);
@@ -154,6 +163,8 @@ class VideoCompare {
 
   void dump_debug_info(const int frame_number, const int64_t effective_right_time_shift, const int average_refresh_time);
 
+  std::unique_ptr<ClipScanner> create_clip_scanner(const Side& right_side, const int64_t right_time_shift) const;
+
   void compare();
 
  private:
@@ -207,9 +218,13 @@ class VideoCompare {
   const TimeShiftConfig time_shift_;
   const int64_t time_shift_offset_av_time_;
 
+  // copies of the input settings for the background clip scanners
+  std::map<Side, std::unique_ptr<ScanInput>> scan_inputs_;
+
   std::map<Side, std::unique_ptr<Demuxer>> demuxers_;
   std::map<Side, std::unique_ptr<VideoDecoder>> video_decoders_;
   std::map<Side, std::unique_ptr<VideoFilterer>> video_filterers_;
+  VideoFilterContext video_filter_context_;
   std::map<Side, std::unique_ptr<FormatConverter>> format_converters_;
 
   std::map<Side, std::unique_ptr<PacketQueue>> packet_queues_;
@@ -221,10 +236,14 @@ class VideoCompare {
 
   size_t max_width_;
   size_t max_height_;
+
+  // the format converters output max_width_ x max_height_ reduced by this (adaptive preview)
+  int preview_scale_divisor_{1};
   double shortest_duration_;
 
   std::unique_ptr<Display> display_;
   std::unique_ptr<Timer> timer_;
+  std::unique_ptr<FramePacer> frame_pacer_;
 
   size_t active_right_index_{0};
   std::map<Side, RightVideoInfo> right_video_info_;
@@ -235,6 +254,9 @@ class VideoCompare {
   std::unique_ptr<ScopeManager> scope_manager_;
   ScopeUpdateState scope_update_state_;
 
+  std::unique_ptr<MetricsTimeline> metrics_timeline_;
+  std::unique_ptr<WorstFrameFinder> worst_frame_finder_;
+
   std::vector<std::thread> stages_;
 
   ExceptionHolder exception_holder_;
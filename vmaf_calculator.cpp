@@ -1,14 +1,40 @@
 #include "vmaf_calculator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include "ffmpeg.h"
 #include "filtered_logger.h"
 #include "string_utils.h"
 extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
+#include <libavutil/opt.h>
 }
 
 static const std::string VMAF_SCORE_STRING("VMAF score:");
 static const std::regex VMAF_REGEX(VMAF_SCORE_STRING + "\\s(\\d+\\.\\d+)");
+static const char* VMAF_METADATA_PREFIX = "lavfi.vmaf";
+
+// every session logs its pooled scores into the same FFmpeg log as its graph is freed
+static std::mutex vmaf_log_mutex;
+
+// only a missing filter disables VMAF; a failed computation is reported and the next one tried afresh
+static bool is_libvmaf_available() {
+  static const bool available = []() {
+    if (avfilter_get_by_name("libvmaf") == nullptr) {
+      std::cerr << "libvmaf FFmpeg filter not found, disabling VMAF computation." << std::endl;
+      return false;
+    }
+    return true;
+  }();
+
+  return available;
+}
 
 VMAFCalculator& VMAFCalculator::instance() {
   static VMAFCalculator instance;
@@ -20,62 +46,147 @@ VMAFCalculator::VMAFCalculator() {
   FilteredLogger::instance().install(VMAF_SCORE_STRING);
 }
 
+VMAFCalculator::~VMAFCalculator() = default;
+
+std::mutex VMAFCalculator::libvmaf_options_mutex_;
+std::string VMAFCalculator::libvmaf_options_;
+
 void VMAFCalculator::set_libvmaf_options(const std::string& options) {
+  std::lock_guard<std::mutex> lock(libvmaf_options_mutex_);
+
   libvmaf_options_ = options;
 }
 
-std::string VMAFCalculator::compute(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
-  std::string result = "n/a";
-
-  if (!disabled_) {
-    // libvmaf (via FFmpeg filter) errors out on very small frames and our catch path
-    // would permanently disable VMAF until restart. Avoid running it in that case.
-    static constexpr int kMinDim = 32;
-
-    if (distorted_frame->width < kMinDim || distorted_frame->height < kMinDim || reference_frame->width < kMinDim || reference_frame->height < kMinDim) {
-      const int dw = distorted_frame->width;
-      const int dh = distorted_frame->height;
-      const int rw = reference_frame->width;
-      const int rh = reference_frame->height;
-      std::cerr << "Warning: skipping VMAF computation for small frame(s). "
-                << "distorted=" << dw << "x" << dh << ", reference=" << rw << "x" << rh << " (minimum " << kMinDim << "x" << kMinDim << ")." << std::endl;
-      return result;
-    }
+bool VMAFCalculator::is_too_small(const AVFrame* distorted_frame, const AVFrame* reference_frame) const {
+  // libvmaf (via FFmpeg filter) errors out on very small frames, so avoid running it in that case
+  static constexpr int kMinDim = 32;
+
+  if (distorted_frame->width < kMinDim || distorted_frame->height < kMinDim || reference_frame->width < kMinDim || reference_frame->height < kMinDim) {
+    const int dw = distorted_frame->width;
+    const int dh = distorted_frame->height;
+    const int rw = reference_frame->width;
+    const int rh = reference_frame->height;
+    std::cerr << "Warning: skipping VMAF computation for small frame(s). "
+              << "distorted=" << dw << "x" << dh << ", reference=" << rw << "x" << rh << " (minimum " << kMinDim << "x" << kMinDim << ")." << std::endl;
+    return true;
+  }
 
-    try {
-      FilteredLogger::instance().reset();
+  return false;
+}
 
-      run_libvmaf_filter(distorted_frame, reference_frame);
+const std::string& VMAFCalculator::get_libvmaf_filter_options() {
+  std::string options;
+  {
+    std::lock_guard<std::mutex> lock(libvmaf_options_mutex_);
+    options = libvmaf_options_;
+  }
 
-      std::vector<std::string> vmaf_scores;
+  if (!libvmaf_filter_options_resolved_ || options != resolved_libvmaf_options_) {
+    resolved_libvmaf_options_ = options;
 
-      std::string buffered_logs = FilteredLogger::instance().get_buffered_logs();
+    // let libvmaf use all cores unless told otherwise (older FFmpeg builds lack the option)
+    const AVFilter* libvmaf_filter = avfilter_get_by_name("libvmaf");
 
-      std::string::const_iterator search_start(buffered_logs.cbegin());
-      std::smatch match;
+    if (libvmaf_filter != nullptr && libvmaf_filter->priv_class != nullptr && options.find("n_threads") == std::string::npos) {
+      const AVClass* priv_class = libvmaf_filter->priv_class;
 
-      while (std::regex_search(search_start, buffered_logs.cend(), match, VMAF_REGEX)) {
-        vmaf_scores.push_back(match[1].str());
+      if (av_opt_find(&priv_class, "n_threads", nullptr, 0, AV_OPT_SEARCH_FAKE_OBJ) != nullptr) {
+        const unsigned int hardware_concurrency = std::thread::hardware_concurrency();
+        const std::string n_threads_option = string_sprintf("n_threads=%u", hardware_concurrency > 0 ? hardware_concurrency : 1);
 
-        search_start = match.suffix().first;
+        options = options.empty() ? n_threads_option : options + ":" + n_threads_option;
       }
+    }
+
+    libvmaf_filter_options_ = options.empty() ? "" : string_sprintf("=%s", options.c_str());
+    libvmaf_filter_options_resolved_ = true;
+  }
+
+  return libvmaf_filter_options_;
+}
 
-      if (!vmaf_scores.empty()) {
-        result = string_join(vmaf_scores, "|");
-      } else {
-        std::cerr << "Failed to extract at least one VMAF score, disabling VMAF computation." << std::endl;
-        disabled_ = true;
+std::string VMAFCalculator::compute(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!is_libvmaf_available() || is_too_small(distorted_frame, reference_frame)) {
+    return "n/a";
+  }
+
+  try {
+    // libvmaf only reports its scores as the graph is torn down, so a lone pair gets a session of its own
+    Session session(distorted_frame, reference_frame, get_libvmaf_filter_options());
+    session.add(distorted_frame, reference_frame);
+
+    const std::vector<std::string> vmaf_scores = session.finish().pooled;
+
+    if (!vmaf_scores.empty()) {
+      return string_join(vmaf_scores, "|");
+    }
+
+    std::cerr << "Failed to extract at least one VMAF score." << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to run libvmaf FFmpeg filter: " << e.what() << std::endl;
+  }
+
+  return "n/a";
+}
+
+bool VMAFCalculator::compute_window(const std::vector<std::pair<const AVFrame*, const AVFrame*>>& frame_pairs, VMAFWindowScores& scores) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!is_libvmaf_available() || frame_pairs.empty() || is_too_small(frame_pairs.front().first, frame_pairs.front().second)) {
+    return false;
+  }
+
+  try {
+    Session session(frame_pairs.front().first, frame_pairs.front().second, get_libvmaf_filter_options());
+
+    // a mid-window change of dimensions or pixel format (e.g. after a filter change) cannot be
+    // streamed through the same graph, so refuse rather than scoring a partial window
+    for (const auto& frame_pair : frame_pairs) {
+      if (!session.accepts(frame_pair.first, frame_pair.second, get_libvmaf_filter_options())) {
+        std::cerr << "Frame dimensions or pixel format vary across the buffered window, skipping windowed VMAF computation." << std::endl;
+        return false;
       }
-    } catch (const std::exception& e) {
-      std::cerr << "Failed to run libvmaf FFmpeg filter, disabling VMAF computation." << std::endl;
-      disabled_ = true;
     }
+
+    const bool frame_scores_enabled = session.enable_frame_scores();
+
+    for (const auto& frame_pair : frame_pairs) {
+      session.add(frame_pair.first, frame_pair.second);
+    }
+
+    scores = session.finish();
+
+    if (scores.pooled.empty()) {
+      std::cerr << "Failed to extract at least one VMAF score." << std::endl;
+      return false;
+    }
+    if (scores.per_frame.empty()) {
+      // said once, however many calculators stream windows
+      static std::once_flag warned;
+
+      std::call_once(warned, [frame_scores_enabled]() {
+        std::cerr << (frame_scores_enabled ? "Warning: failed to read per-frame VMAF scores from the libvmaf log, only the pooled score is reported."
+                                           : "Warning: libvmaf cannot log per-frame scores, only the pooled score is reported.")
+                  << std::endl;
+      });
+    }
+
+    return true;
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to run libvmaf FFmpeg filter: " << e.what() << std::endl;
   }
 
-  return result;
+  return false;
+}
+
+VMAFCalculator::Session::Key VMAFCalculator::Session::make_key(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options) {
+  return Key{distorted_frame->width, distorted_frame->height, distorted_frame->format, reference_frame->width, reference_frame->height, reference_frame->format, libvmaf_filter_options};
 }
 
-void VMAFCalculator::run_libvmaf_filter(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
+VMAFCalculator::Session::Session(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options)
+    : key_(make_key(distorted_frame, reference_frame, libvmaf_filter_options)) {
   if (!avfilter_get_by_name("libvmaf")) {
     throw std::runtime_error("libvmaf filter not found");
   }
@@ -89,66 +200,264 @@ void VMAFCalculator::run_libvmaf_filter(const AVFrame* distorted_frame, const AV
 #endif
   };
 
+  // packed RGB display frames must be converted to YUV for libvmaf, whereas native YUV frames
+  // are left for the filter graph to negotiate so no needless conversion is inserted
+  auto format_input_filters = [](const AVFrame* frame) {
+    const AVPixelFormat pixel_format = static_cast<AVPixelFormat>(frame->format);
+
+    if (pixel_format == AV_PIX_FMT_RGB24 || pixel_format == AV_PIX_FMT_RGB48LE || ffmpeg::is_packed_10_bpc_rgb(pixel_format)) {
+      return string_sprintf("setparams=colorspace=%d:range=%d,format=%s", frame->colorspace, frame->color_range, pixel_format == AV_PIX_FMT_RGB24 ? "yuv444p" : "yuv444p16le");
+    }
+
+    return std::string("null");
+  };
+
   const AVFilter* buffersrc = avfilter_get_by_name("buffer");
   const AVFilter* buffersink = avfilter_get_by_name("buffersink");
 
-  AVFilterGraphRAII filter_graph;
-  AVFilterContext* buffersrc_ctx_dist;
-
-  if (avfilter_graph_create_filter(&buffersrc_ctx_dist, buffersrc, "in_dist", format_filter_args(distorted_frame).c_str(), nullptr, filter_graph.get()) < 0) {
+  if (avfilter_graph_create_filter(&buffersrc_ctx_dist_, buffersrc, "in_dist", format_filter_args(distorted_frame).c_str(), nullptr, filter_graph_.get()) < 0) {
     throw std::runtime_error("Cannot create buffer source for distorted frame");
   }
 
-  AVFilterContext* buffersrc_ctx_ref;
-
-  if (avfilter_graph_create_filter(&buffersrc_ctx_ref, buffersrc, "in_ref", format_filter_args(reference_frame).c_str(), nullptr, filter_graph.get()) < 0) {
+  if (avfilter_graph_create_filter(&buffersrc_ctx_ref_, buffersrc, "in_ref", format_filter_args(reference_frame).c_str(), nullptr, filter_graph_.get()) < 0) {
     throw std::runtime_error("Cannot create buffer source for reference frame");
   }
 
-  AVFilterContext* buffersink_ctx;
-
-  if (avfilter_graph_create_filter(&buffersink_ctx, buffersink, "out", nullptr, nullptr, filter_graph.get()) < 0) {
+  if (avfilter_graph_create_filter(&buffersink_ctx_, buffersink, "out", nullptr, nullptr, filter_graph_.get()) < 0) {
     throw std::runtime_error("Cannot create buffer sink");
   }
 
-  std::string yuv_pixel_format = distorted_frame->format == AV_PIX_FMT_RGB24 ? "yuv444p" : "yuv444p16le";
-  std::string libvmaf_filter_options = libvmaf_options_.empty() ? "" : string_sprintf("=%s", libvmaf_options_.c_str());
-
-  std::string filter_description =
-      string_sprintf("[in_dist]setparams=colorspace=%d:range=%d,format=%s[in_dist_yuv],[in_ref]setparams=colorspace=%d:range=%d,format=%s[in_ref_yuv],[in_dist_yuv][in_ref_yuv]libvmaf%s[out]", distorted_frame->colorspace,
-                     distorted_frame->color_range, yuv_pixel_format.c_str(), reference_frame->colorspace, reference_frame->color_range, yuv_pixel_format.c_str(), libvmaf_filter_options.c_str());
+  std::string filter_description = string_sprintf("[in_dist]%s[in_dist_yuv],[in_ref]%s[in_ref_yuv],[in_dist_yuv][in_ref_yuv]libvmaf%s[out]", format_input_filters(distorted_frame).c_str(), format_input_filters(reference_frame).c_str(),
+                                                  libvmaf_filter_options.c_str());
 
-  AVFilterInOutRAII outputs_ref(av_strdup("in_ref"), buffersrc_ctx_ref, nullptr, false);
-  AVFilterInOutRAII outputs_dist(av_strdup("in_dist"), buffersrc_ctx_dist, outputs_ref.get());
-  AVFilterInOutRAII inputs(av_strdup("out"), buffersink_ctx, nullptr);
+  AVFilterInOutRAII outputs_ref(av_strdup("in_ref"), buffersrc_ctx_ref_, nullptr, false);
+  AVFilterInOutRAII outputs_dist(av_strdup("in_dist"), buffersrc_ctx_dist_, outputs_ref.get());
+  AVFilterInOutRAII inputs(av_strdup("out"), buffersink_ctx_, nullptr);
 
-  if (avfilter_graph_parse_ptr(filter_graph.get(), filter_description.c_str(), inputs.get_pointer(), outputs_dist.get_pointer(), nullptr) < 0) {
+  if (avfilter_graph_parse_ptr(filter_graph_.get(), filter_description.c_str(), inputs.get_pointer(), outputs_dist.get_pointer(), nullptr) < 0) {
     throw std::runtime_error("Error parsing graph");
   }
 
-  if (avfilter_graph_config(filter_graph.get(), nullptr) < 0) {
+  if (avfilter_graph_config(filter_graph_.get(), nullptr) < 0) {
     throw std::runtime_error("Error configuring graph");
   }
 
-  if (av_buffersrc_add_frame(buffersrc_ctx_dist, const_cast<AVFrame*>(distorted_frame)) < 0) {
-    throw std::runtime_error("Error feeding distorted frame");
+  for (unsigned i = 0; i < filter_graph_.get()->nb_filters; i++) {
+    AVFilterContext* filter_ctx = filter_graph_.get()->filters[i];
+
+    if (strcmp(filter_ctx->filter->name, "libvmaf") == 0) {
+      libvmaf_ctx_ = filter_ctx;
+    }
+  }
+}
+
+VMAFCalculator::Session::~Session() {
+  // libvmaf writes its log while being uninitialized, so tear the graph down first
+  free_graph();
+
+  if (!frame_log_path_.empty()) {
+    std::remove(frame_log_path_.c_str());
+  }
+}
+
+bool VMAFCalculator::Session::enable_frame_scores() {
+  if (libvmaf_ctx_ == nullptr) {
+    return false;
+  }
+
+  const char* temp_dir = std::getenv("TMPDIR");
+  temp_dir = temp_dir != nullptr ? temp_dir : std::getenv("TEMP");
+  temp_dir = temp_dir != nullptr ? temp_dir : "/tmp";
+
+  const std::string log_path = string_sprintf("%s/video-compare-vmaf-%llx-%llx.csv", temp_dir, static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(this)),
+                                              static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count()));
+
+  // set directly on the filter (rather than in the graph description) to avoid escaping the path
+  if (av_opt_set(libvmaf_ctx_, "log_path", log_path.c_str(), AV_OPT_SEARCH_CHILDREN) < 0 || av_opt_set(libvmaf_ctx_, "log_fmt", "csv", AV_OPT_SEARCH_CHILDREN) < 0) {
+    return false;
+  }
+
+  frame_log_path_ = log_path;
+
+  return true;
+}
+
+std::vector<std::vector<double>> VMAFCalculator::Session::read_frame_scores(const size_t num_models) const {
+  std::vector<std::vector<double>> frame_scores;
+
+  std::ifstream log_file(frame_log_path_);
+  std::string line;
+
+  if (num_models == 0 || !std::getline(log_file, line)) {
+    return frame_scores;
+  }
+
+  auto split_columns = [](const std::string& csv_line) {
+    std::vector<std::string> columns = string_split(csv_line, ',');
+
+    // every value is followed by a comma
+    while (!columns.empty() && columns.back().empty()) {
+      columns.pop_back();
+    }
+    return columns;
+  };
+
+  // "Frame,<features...>,<models...>": the model predictions are appended after the features
+  const size_t num_columns = split_columns(line).size();
+
+  if (num_columns < num_models + 1) {
+    return frame_scores;
+  }
+
+  try {
+    while (std::getline(log_file, line)) {
+      const std::vector<std::string> columns = split_columns(line);
+
+      if (columns.size() != num_columns) {
+        continue;
+      }
+
+      const size_t frame_index = std::stoul(columns[0]);
+
+      if (frame_index >= static_cast<size_t>(next_pts_)) {
+        continue;
+      }
+
+      frame_scores.resize(std::max(frame_scores.size(), frame_index + 1));
+
+      for (size_t column = num_columns - num_models; column < num_columns; column++) {
+        frame_scores[frame_index].push_back(std::stod(columns[column]));
+      }
+    }
+  } catch (const std::logic_error& e) {
+    std::cerr << "Failed to parse per-frame VMAF scores: " << e.what() << std::endl;
+    frame_scores.clear();
+  }
+
+  return frame_scores;
+}
+
+bool VMAFCalculator::Session::accepts(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options) const {
+  return make_key(distorted_frame, reference_frame, libvmaf_filter_options) == key_;
+}
+
+void VMAFCalculator::Session::read_frame_metadata(const AVFrame* filtered_frame) {
+  if (filtered_frame->pts < 0 || filtered_frame->pts >= next_pts_) {
+    return;
+  }
+
+  std::vector<double> scores;
+  const AVDictionaryEntry* entry = nullptr;
+
+  while ((entry = av_dict_get(filtered_frame->metadata, VMAF_METADATA_PREFIX, entry, AV_DICT_IGNORE_SUFFIX)) != nullptr) {
+    char* end = nullptr;
+    const double score = std::strtod(entry->value, &end);
+
+    if (end != entry->value) {
+      scores.push_back(score);
+    }
+  }
+
+  if (!scores.empty()) {
+    const size_t frame_index = static_cast<size_t>(filtered_frame->pts);
+
+    frame_metadata_scores_.resize(std::max(frame_metadata_scores_.size(), frame_index + 1));
+    frame_metadata_scores_[frame_index] = scores;
+  }
+}
+
+bool VMAFCalculator::Session::has_all_frame_scores(const std::vector<std::vector<double>>& frame_scores) const {
+  return frame_scores.size() == static_cast<size_t>(next_pts_) && std::none_of(frame_scores.cbegin(), frame_scores.cend(), [](const std::vector<double>& scores) { return scores.empty(); });
+}
+
+void VMAFCalculator::Session::free_graph() {
+  std::lock_guard<std::mutex> lock(vmaf_log_mutex);
+
+  filter_graph_.free();
+}
+
+void VMAFCalculator::Session::push(AVFilterContext* buffersrc_ctx, const AVFrame* frame) {
+  // buffer sources take over the references of the frame they are fed, so feed a
+  // (reference-counted) clone stamped with the session's own monotonic timestamps
+  AVFrame* frame_ref = av_frame_clone(frame);
+
+  if (!frame_ref) {
+    throw std::runtime_error("Failed to clone frame");
+  }
+
+  frame_ref->pts = next_pts_;
+
+  const int result = av_buffersrc_add_frame(buffersrc_ctx, frame_ref);
+  av_frame_free(&frame_ref);
+
+  if (result < 0) {
+    throw std::runtime_error("Error feeding frame");
   }
+}
 
-  if (av_buffersrc_add_frame(buffersrc_ctx_ref, const_cast<AVFrame*>(reference_frame)) < 0) {
-    throw std::runtime_error("Error feeding reference frame");
+void VMAFCalculator::Session::drain() {
+  AVFrameRAII filtered_frame;
+
+  while (av_buffersink_get_frame(buffersink_ctx_, filtered_frame.get()) >= 0) {
+    read_frame_metadata(filtered_frame.get());
+    av_frame_unref(filtered_frame.get());
   }
+}
 
-  if (av_buffersrc_close(buffersrc_ctx_dist, 0, AV_BUFFERSRC_FLAG_PUSH) < 0) {
+void VMAFCalculator::Session::add(const AVFrame* distorted_frame, const AVFrame* reference_frame) {
+  if (!accepts(distorted_frame, reference_frame, key_.libvmaf_filter_options)) {
+    throw std::runtime_error("Frame pair does not match the VMAF session");
+  }
+
+  push(buffersrc_ctx_dist_, distorted_frame);
+  push(buffersrc_ctx_ref_, reference_frame);
+  next_pts_++;
+
+  drain();
+}
+
+VMAFWindowScores VMAFCalculator::Session::finish() {
+  if (av_buffersrc_close(buffersrc_ctx_dist_, next_pts_, AV_BUFFERSRC_FLAG_PUSH) < 0) {
     throw std::runtime_error("Error closing distorted buffer source");
   }
 
-  if (av_buffersrc_close(buffersrc_ctx_ref, 0, AV_BUFFERSRC_FLAG_PUSH) < 0) {
+  if (av_buffersrc_close(buffersrc_ctx_ref_, next_pts_, AV_BUFFERSRC_FLAG_PUSH) < 0) {
     throw std::runtime_error("Error closing reference buffer source");
   }
 
-  AVFrameRAII filtered_frame;
+  drain();
 
-  if (av_buffersink_get_frame(buffersink_ctx, filtered_frame.get()) < 0) {
-    throw std::runtime_error("Error getting filtered frame");
+  std::string buffered_logs;
+
+  // the pooled score(s) are logged by libvmaf while the filter is uninitialized
+  {
+    std::lock_guard<std::mutex> lock(vmaf_log_mutex);
+
+    FilteredLogger::instance().reset();
+    filter_graph_.free();
+    buffered_logs = FilteredLogger::instance().get_buffered_logs();
   }
+
+  VMAFWindowScores scores;
+
+  std::string::const_iterator search_start(buffered_logs.cbegin());
+  std::smatch match;
+
+  while (std::regex_search(search_start, buffered_logs.cend(), match, VMAF_REGEX)) {
+    scores.pooled.push_back(match[1].str());
+
+    search_start = match.suffix().first;
+  }
+
+  // only a score for every frame makes a usable series; the metadata spares parsing the log
+  std::vector<std::vector<double>> frame_scores = frame_metadata_scores_;
+
+  if (!has_all_frame_scores(frame_scores) && !frame_log_path_.empty()) {
+    frame_scores = read_frame_scores(scores.pooled.size());
+  }
+  if (next_pts_ > 0 && has_all_frame_scores(frame_scores)) {
+    scores.per_frame = std::move(frame_scores);
+  }
+
+  return scores;
 }
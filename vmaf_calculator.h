@@ -1,31 +1,60 @@
 #pragma once
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 extern "C" {
 #include <libavfilter/avfilter.h>
 #include <libavutil/frame.h>
 }
 
+struct VMAFWindowScores {
+  // one pooled score per libvmaf model
+  std::vector<std::string> pooled;
+  // per frame (in streaming order), one score per model; empty if libvmaf cannot report them
+  std::vector<std::vector<double>> per_frame;
+};
+
 class VMAFCalculator {
  private:
-  bool disabled_{false};
-  std::string libvmaf_options_;
+  // shared by every calculator
+  static std::mutex libvmaf_options_mutex_;
+  static std::string libvmaf_options_;
+
+  std::string resolved_libvmaf_options_;  // those libvmaf_filter_options_ was resolved from
+  std::string libvmaf_filter_options_;
+  bool libvmaf_filter_options_resolved_{false};
+
+  // a calculator may be used from several threads
+  std::mutex mutex_;
 
  public:
+  // Background workers own calculators of their own, so that they never wait on (or for) the
+  // interactive commands
+  VMAFCalculator();
+  ~VMAFCalculator();
+
   VMAFCalculator(const VMAFCalculator&) = delete;
   VMAFCalculator& operator=(const VMAFCalculator&) = delete;
 
+  // The calculator of the interactive commands
   static VMAFCalculator& instance();
 
-  void set_libvmaf_options(const std::string& options);
+  // Applies to every calculator, from its next computation on
+  static void set_libvmaf_options(const std::string& options);
 
   std::string compute(const AVFrame* distorted_frame, const AVFrame* reference_frame);
 
+  // Streams consecutive frame pairs (oldest first) through a single libvmaf graph so that the
+  // temporal (motion) features see real neighbors. Returns false if no score could be computed.
+  bool compute_window(const std::vector<std::pair<const AVFrame*, const AVFrame*>>& frame_pairs, VMAFWindowScores& scores);
+
  private:
-  VMAFCalculator();
+  bool is_too_small(const AVFrame* distorted_frame, const AVFrame* reference_frame) const;
 
-  void run_libvmaf_filter(const AVFrame* distorted_frame, const AVFrame* reference_frame);
+  const std::string& get_libvmaf_filter_options();
 
  private:
   class AVFilterGraphRAII {
@@ -37,6 +66,7 @@ class VMAFCalculator {
     }
     ~AVFilterGraphRAII() { avfilter_graph_free(&graph_); }
     AVFilterGraph* get() { return graph_; }
+    void free() { avfilter_graph_free(&graph_); }
 
    private:
     AVFilterGraph* graph_;
@@ -80,4 +110,64 @@ class VMAFCalculator {
    private:
     AVFrame* frame_;
   };
+
+  // A libvmaf filter graph configured once for the dimensions, pixel formats and options of its
+  // first frame pair, into which any number of matching pairs are streamed in order. libvmaf
+  // pools the per-frame scores when the graph is torn down, so finish() ends the session.
+  // Per-frame scores come from the log libvmaf writes at that point, or directly from the
+  // lavfi.vmaf metadata of FFmpeg builds whose filter attaches it.
+  class Session {
+   public:
+    Session(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options);
+    ~Session();
+
+    bool accepts(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options) const;
+
+    void add(const AVFrame* distorted_frame, const AVFrame* reference_frame);
+
+    // asks libvmaf to log per-frame scores, which finish() then picks up
+    bool enable_frame_scores();
+
+    VMAFWindowScores finish();
+
+   private:
+    struct Key {
+      int distorted_width;
+      int distorted_height;
+      int distorted_format;
+      int reference_width;
+      int reference_height;
+      int reference_format;
+      std::string libvmaf_filter_options;
+
+      bool operator==(const Key& other) const {
+        return distorted_width == other.distorted_width && distorted_height == other.distorted_height && distorted_format == other.distorted_format && reference_width == other.reference_width &&
+               reference_height == other.reference_height && reference_format == other.reference_format && libvmaf_filter_options == other.libvmaf_filter_options;
+      }
+    };
+
+    static Key make_key(const AVFrame* distorted_frame, const AVFrame* reference_frame, const std::string& libvmaf_filter_options);
+
+    void push(AVFilterContext* buffersrc_ctx, const AVFrame* frame);
+    void drain();
+
+    void read_frame_metadata(const AVFrame* filtered_frame);
+    bool has_all_frame_scores(const std::vector<std::vector<double>>& frame_scores) const;
+
+    std::vector<std::vector<double>> read_frame_scores(const size_t num_models) const;
+
+    // the graph logs the pooled scores as it is freed
+    void free_graph();
+
+   private:
+    Key key_;
+    AVFilterGraphRAII filter_graph_;
+    AVFilterContext* buffersrc_ctx_dist_{nullptr};
+    AVFilterContext* buffersrc_ctx_ref_{nullptr};
+    AVFilterContext* buffersink_ctx_{nullptr};
+    AVFilterContext* libvmaf_ctx_{nullptr};
+    std::string frame_log_path_;
+    std::vector<std::vector<double>> frame_metadata_scores_;  // by frame index
+    int64_t next_pts_{0};
+  };
 };
\ No newline at end of file
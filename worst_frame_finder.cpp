@@ -0,0 +1,111 @@
+#include "worst_frame_finder.h"
+#include <algorithm>
+#include <vector>
+
+// identical frames (infinite PSNR) rank last, and ties go to the earlier frame
+static bool is_more_distorted(const WorstFrame& a, const WorstFrame& b) {
+  if (a.psnr_is_infinite != b.psnr_is_infinite) {
+    return b.psnr_is_infinite;
+  }
+  if (!a.psnr_is_infinite && a.psnr != b.psnr) {
+    return a.psnr < b.psnr;
+  }
+  return a.pts < b.pts;
+}
+
+WorstFrameFinder::WorstFrameFinder(MetricsTimeline& metrics_timeline, const size_t max_frames) : metrics_timeline_(metrics_timeline), max_frames_(std::max<size_t>(1, max_frames)) {}
+
+void WorstFrameFinder::set_pair(const Side& right_side, const int right_frame_shift) {
+  const std::pair<Side, int> key{right_side, right_frame_shift};
+
+  if (has_selection_ && key == selected_key_) {
+    return;
+  }
+
+  selected_key_ = key;
+  has_selection_ = true;
+
+  worst_frames_heap_.clear();
+  scanned_points_ = 0;
+  scanned_pts_ = 0;
+  scan_complete_ = false;
+  scan_failed_ = false;
+  has_cursor_ = false;
+}
+
+void WorstFrameFinder::add_candidate(const WorstFrame& frame) {
+  if (worst_frames_heap_.size() < max_frames_) {
+    worst_frames_heap_.push_back(frame);
+    std::push_heap(worst_frames_heap_.begin(), worst_frames_heap_.end(), is_more_distorted);
+  } else if (is_more_distorted(frame, worst_frames_heap_.front())) {
+    std::pop_heap(worst_frames_heap_.begin(), worst_frames_heap_.end(), is_more_distorted);
+    worst_frames_heap_.back() = frame;
+    std::push_heap(worst_frames_heap_.begin(), worst_frames_heap_.end(), is_more_distorted);
+  }
+}
+
+void WorstFrameFinder::update() {
+  MetricsTimelineSnapshot snapshot;
+
+  if (!metrics_timeline_.get_snapshot(snapshot, scanned_points_)) {
+    return;
+  }
+
+  for (const MetricsTimelinePoint& point : snapshot.points) {
+    if (point.valid) {
+      add_candidate(WorstFrame{point.pts, point.psnr, point.psnr_is_infinite});
+    }
+  }
+
+  scanned_points_ += snapshot.points.size();
+
+  if (!snapshot.points.empty()) {
+    scanned_pts_ = snapshot.points.back().pts;
+  }
+
+  scan_complete_ = snapshot.complete;
+  scan_failed_ = snapshot.failed;
+}
+
+bool WorstFrameFinder::step(const int delta, WorstFrameSelection& selection) {
+  if (!has_selection_) {
+    return false;
+  }
+
+  metrics_timeline_.request_scan();
+  update();
+
+  selection.complete = scan_complete_;
+  selection.scanned_pts = scanned_pts_;
+
+  if (worst_frames_heap_.empty()) {
+    return false;
+  }
+
+  std::vector<WorstFrame> ranked(worst_frames_heap_);
+  std::sort(ranked.begin(), ranked.end(), is_more_distorted);
+
+  int rank = 0;
+
+  // the first step lands on the worst frame whatever the direction
+  if (has_cursor_) {
+    // the cursor is ranked between these unless it has been pushed out of the heap
+    const int ranked_before = static_cast<int>(std::lower_bound(ranked.cbegin(), ranked.cend(), cursor_, is_more_distorted) - ranked.cbegin());
+    const int ranked_after = static_cast<int>(std::upper_bound(ranked.cbegin(), ranked.cend(), cursor_, is_more_distorted) - ranked.cbegin());
+
+    rank = std::min(std::max(delta > 0 ? ranked_after + delta - 1 : ranked_before + delta, 0), static_cast<int>(ranked.size()) - 1);
+  }
+
+  cursor_ = ranked[rank];
+  has_cursor_ = true;
+
+  selection.frame = cursor_;
+  selection.rank = rank;
+  selection.count = static_cast<int>(ranked.size());
+
+  return true;
+}
+
+bool WorstFrameFinder::has_failed() const {
+  return has_selection_ && (scan_failed_ || (scan_complete_ && worst_frames_heap_.empty()));
+}
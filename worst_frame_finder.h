@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "core_types.h"
+#include "metrics_timeline.h"
+
+struct WorstFrame {
+  int64_t pts;  // left side, microseconds from the start
+  float psnr;
+  bool psnr_is_infinite;
+};
+
+struct WorstFrameSelection {
+  WorstFrame frame;
+  int rank;   // 0 is the worst
+  int count;  // frames ranked so far
+  bool complete;
+  int64_t scanned_pts;  // scan progress, left side
+};
+
+// Keeps the lowest-PSNR frames of the left input and a right input in a bounded heap, fed with the
+// points of the metrics timeline's background scan as they arrive, so that the clip is decoded
+// once for both. The first step starts that scan (whether or not the timeline window is open).
+// Must be used from the main thread only.
+class WorstFrameFinder {
+ public:
+  WorstFrameFinder(MetricsTimeline& metrics_timeline, const size_t max_frames);
+
+  // Selects the pair to search, which must be the one selected in the metrics timeline. Stepping
+  // starts over from the worst frame when it changes.
+  void set_pair(const Side& right_side, const int right_frame_shift);
+
+  // Moves delta ranks through the worst frames found so far (starting with the worst) and returns
+  // true with the selected frame, or false if none has been found yet. Steps are relative to the
+  // frame last stepped to, so frames found in between neither get it revisited nor skipped.
+  bool step(const int delta, WorstFrameSelection& selection);
+
+  // True if the scan of the selected pair failed or found no comparable frames
+  bool has_failed() const;
+
+ private:
+  // takes in the points scanned since the last update
+  void update();
+
+  void add_candidate(const WorstFrame& frame);
+
+ private:
+  MetricsTimeline& metrics_timeline_;
+  const size_t max_frames_;
+
+  std::pair<Side, int> selected_key_{LEFT, 0};
+  bool has_selection_{false};
+
+  // the least distorted of the worst frames so far on top
+  std::vector<WorstFrame> worst_frames_heap_;
+
+  size_t scanned_points_{0};
+  int64_t scanned_pts_{0};
+  bool scan_complete_{false};
+  bool scan_failed_{false};
+
+  // frame last stepped to; kept by pts and score, since its rank changes as the scan goes on
+  WorstFrame cursor_{0, 0.0F, false};
+  bool has_cursor_{false};
+};